@@ -0,0 +1,616 @@
+#include "b_plus_tree.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if B_PLUS_TREE_INNER_KEYS % 8 != 0 || B_PLUS_TREE_LEAF_SIZE % 4 != 0
+#error "B_PLUS_TREE_INNER_KEYS must be a multiple of 8 and B_PLUS_TREE_LEAF_SIZE a multiple of 4"
+#endif
+
+// A node below these counts borrows from a sibling or merges with it; merging two such nodes always fits in one.
+#define B_PLUS_TREE_INNER_MIN (B_PLUS_TREE_INNER_KEYS / 2)
+#define B_PLUS_TREE_LEAF_MIN (B_PLUS_TREE_LEAF_SIZE / 2)
+
+#if defined(__GNUC__)
+#define B_PLUS_TREE_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+#define B_PLUS_TREE_PREFETCH(ptr) ((void)(ptr))
+#endif
+
+static int b_plus_tree_key_compare(const b_plus_tree_key_type *, const b_plus_tree_key_type *);
+static void b_plus_tree_key_copy(b_plus_tree_key_type *, const b_plus_tree_key_type *);
+static void b_plus_tree_val_copy(b_plus_tree_val_type *, const b_plus_tree_val_type *);
+static void b_plus_tree_data_copy(b_plus_tree_data_type *, const b_plus_tree_data_type *);
+static unsigned int trailing_zeros(unsigned int);
+static void b_plus_tree_pool_init(b_plus_tree_pool *, unsigned long);
+static void *b_plus_tree_pool_alloc(b_plus_tree_pool *);
+static void b_plus_tree_pool_free(b_plus_tree_pool *, void *);
+static void b_plus_tree_pool_release(b_plus_tree_pool *);
+static b_plus_tree_inner_node *create_b_plus_tree_inner_node(b_plus_tree *);
+static b_plus_tree_leaf_node *create_b_plus_tree_leaf_node(b_plus_tree *);
+static unsigned int b_plus_tree_inner_search(const b_plus_tree_inner_node *, const b_plus_tree_key_type *);
+static unsigned int b_plus_tree_leaf_search(const b_plus_tree_leaf_node *, const b_plus_tree_key_type *);
+static b_plus_tree_leaf_node *b_plus_tree_find_leaf(const b_plus_tree *, const b_plus_tree_key_type *);
+static void b_plus_tree_inner_insert_at(b_plus_tree_inner_node *, unsigned int, const b_plus_tree_key_type *, void *);
+static void b_plus_tree_inner_erase_at(b_plus_tree_inner_node *, unsigned int);
+static void *b_plus_tree_leaf_insert(b_plus_tree *, b_plus_tree_leaf_node *, const b_plus_tree_data_type *, b_plus_tree_key_type *);
+static void *b_plus_tree_inner_split(b_plus_tree *, b_plus_tree_inner_node *, unsigned int, const b_plus_tree_key_type *, void *, b_plus_tree_key_type *);
+static void *b_plus_tree_node_insert(b_plus_tree *, void *, unsigned int, const b_plus_tree_data_type *, b_plus_tree_key_type *);
+static void b_plus_tree_leaf_merge(b_plus_tree *, b_plus_tree_inner_node *, unsigned int);
+static void b_plus_tree_inner_merge(b_plus_tree *, b_plus_tree_inner_node *, unsigned int);
+static void b_plus_tree_leaf_rebalance(b_plus_tree *, b_plus_tree_inner_node *, unsigned int);
+static void b_plus_tree_inner_rebalance(b_plus_tree *, b_plus_tree_inner_node *, unsigned int);
+static int b_plus_tree_node_delete(b_plus_tree *, void *, unsigned int, const b_plus_tree_key_type *);
+
+static inline int b_plus_tree_key_compare(const b_plus_tree_key_type *lhs, const b_plus_tree_key_type *rhs)
+{
+    assert(lhs != NULL);
+    assert(rhs != NULL);
+    if (*lhs < *rhs)
+        return -1;
+    if (*lhs > *rhs)
+        return 1;
+    return 0;
+}
+
+static inline void b_plus_tree_key_copy(b_plus_tree_key_type *dest, const b_plus_tree_key_type *source)
+{
+    assert(dest != NULL);
+    assert(source != NULL);
+    *dest = *source;
+}
+
+static inline void b_plus_tree_val_copy(b_plus_tree_val_type *dest, const b_plus_tree_val_type *source)
+{
+    assert(dest != NULL);
+    assert(source != NULL);
+    *dest = *source;
+}
+
+static inline void b_plus_tree_data_copy(b_plus_tree_data_type *dest, const b_plus_tree_data_type *source)
+{
+    assert(dest != NULL);
+    assert(source != NULL);
+    b_plus_tree_key_copy(&dest->key, &source->key);
+    b_plus_tree_val_copy(&dest->val, &source->val);
+}
+
+static inline unsigned int trailing_zeros(unsigned int bits)
+{
+    assert(bits != 0);
+#if defined(__GNUC__)
+    return (unsigned int)__builtin_ctz(bits);
+#else
+    unsigned int ret = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        ++ret;
+    }
+    return ret;
+#endif
+}
+
+static void b_plus_tree_pool_init(b_plus_tree_pool *pool, unsigned long node_size)
+{
+    assert(pool != NULL);
+    pool->chunk = NULL;
+    pool->free_list = NULL;
+    pool->node_size = (node_size + B_PLUS_TREE_CACHE_LINE - 1) & ~(unsigned long)(B_PLUS_TREE_CACHE_LINE - 1);
+}
+
+// A chunk starts with the link to the previous chunk; its nodes follow at the next cache line boundary.
+// Free nodes are linked through their first word.
+static void *b_plus_tree_pool_alloc(b_plus_tree_pool *pool)
+{
+    unsigned long i;
+    char *memory = NULL;
+    char *base = NULL;
+    void *ret = NULL;
+    assert(pool != NULL);
+    if (pool->free_list == NULL) {
+        memory = (char *)malloc(sizeof(void *) + B_PLUS_TREE_CACHE_LINE - 1 + B_PLUS_TREE_CHUNK_NODES * pool->node_size);
+        assert(memory != NULL);
+        *(void **)memory = pool->chunk;
+        pool->chunk = memory;
+        base = (char *)(((size_t)memory + sizeof(void *) + B_PLUS_TREE_CACHE_LINE - 1) & ~(size_t)(B_PLUS_TREE_CACHE_LINE - 1));
+        for (i = B_PLUS_TREE_CHUNK_NODES; i-- > 0;) {
+            *(void **)(base + i * pool->node_size) = pool->free_list;
+            pool->free_list = base + i * pool->node_size;
+        }
+    }
+    ret = pool->free_list;
+    pool->free_list = *(void **)ret;
+    memset(ret, 0, pool->node_size);
+    return ret;
+}
+
+static inline void b_plus_tree_pool_free(b_plus_tree_pool *pool, void *node)
+{
+    assert(pool != NULL);
+    assert(node != NULL);
+    *(void **)node = pool->free_list;
+    pool->free_list = node;
+}
+
+static void b_plus_tree_pool_release(b_plus_tree_pool *pool)
+{
+    void *next = NULL;
+    assert(pool != NULL);
+    while (pool->chunk != NULL) {
+        next = *(void **)pool->chunk;
+        free(pool->chunk);
+        pool->chunk = next;
+    }
+    pool->free_list = NULL;
+}
+
+static inline b_plus_tree_inner_node *create_b_plus_tree_inner_node(b_plus_tree *tree)
+{
+    assert(tree != NULL);
+    return (b_plus_tree_inner_node *)b_plus_tree_pool_alloc(&tree->inner_pool);
+}
+
+static inline b_plus_tree_leaf_node *create_b_plus_tree_leaf_node(b_plus_tree *tree)
+{
+    assert(tree != NULL);
+    return (b_plus_tree_leaf_node *)b_plus_tree_pool_alloc(&tree->leaf_pool);
+}
+
+inline void b_plus_tree_init(b_plus_tree *tree)
+{
+    assert(tree != NULL);
+    tree->root = NULL;
+    tree->first = tree->last = NULL;
+    tree->height = 0;
+    tree->size = 0;
+    b_plus_tree_pool_init(&tree->inner_pool, sizeof(b_plus_tree_inner_node));
+    b_plus_tree_pool_init(&tree->leaf_pool, sizeof(b_plus_tree_leaf_node));
+}
+
+inline int b_plus_tree_empty(const b_plus_tree *tree)
+{
+    assert(tree != NULL);
+    return tree->root == NULL;
+}
+
+inline unsigned long b_plus_tree_size(const b_plus_tree *tree)
+{
+    assert(tree != NULL);
+    return tree->size;
+}
+
+// Returns the number of separators not greater than the key, which is the index of the child to descend into.
+static inline unsigned int b_plus_tree_inner_search(const b_plus_tree_inner_node *node, const b_plus_tree_key_type *key_ptr)
+{
+#if defined(__AVX2__)
+    unsigned int i;
+    unsigned int mask;
+    __m256i needle;
+    assert(node != NULL);
+    assert(key_ptr != NULL);
+    needle = _mm256_set1_epi32(*key_ptr);
+    for (i = 0; i < node->count; i += 8) {
+        mask = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_load_si256((const __m256i *)&node->key[i]), needle)));
+        if (mask != 0) {
+            i += trailing_zeros(mask);
+            return i < node->count ? i : node->count;
+        }
+    }
+    return node->count;
+#else
+    unsigned int low = 0;
+    unsigned int high;
+    unsigned int mid;
+    assert(node != NULL);
+    assert(key_ptr != NULL);
+    high = node->count;
+    while (low < high) {
+        mid = (low + high) >> 1;
+        if (b_plus_tree_key_compare(&node->key[mid], key_ptr) <= 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+#endif
+}
+
+// Returns the number of entries less than the key, which is where the key is or would be inserted.
+static inline unsigned int b_plus_tree_leaf_search(const b_plus_tree_leaf_node *leaf, const b_plus_tree_key_type *key_ptr)
+{
+#if defined(__AVX2__)
+    unsigned int i;
+    unsigned int mask;
+    __m256i needle;
+    assert(leaf != NULL);
+    assert(key_ptr != NULL);
+    needle = _mm256_set1_epi32(*key_ptr);
+    for (i = 0; i < leaf->count; i += 4) {
+        // Entries interleave keys and values, so only the even lanes hold keys.
+        mask = ~(unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(needle, _mm256_load_si256((const __m256i *)&leaf->data[i])))) & 0x55;
+        if (mask != 0) {
+            i += trailing_zeros(mask) >> 1;
+            return i < leaf->count ? i : leaf->count;
+        }
+    }
+    return leaf->count;
+#else
+    unsigned int low = 0;
+    unsigned int high;
+    unsigned int mid;
+    assert(leaf != NULL);
+    assert(key_ptr != NULL);
+    high = leaf->count;
+    while (low < high) {
+        mid = (low + high) >> 1;
+        if (b_plus_tree_key_compare(&leaf->data[mid].key, key_ptr) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+#endif
+}
+
+static b_plus_tree_leaf_node *b_plus_tree_find_leaf(const b_plus_tree *tree, const b_plus_tree_key_type *key_ptr)
+{
+    unsigned int level;
+    void *node = NULL;
+    assert(tree != NULL);
+    assert(key_ptr != NULL);
+    node = tree->root;
+    for (level = tree->height; level > 0; --level)
+        node = ((b_plus_tree_inner_node *)node)->child[b_plus_tree_inner_search((b_plus_tree_inner_node *)node, key_ptr)];
+    return (b_plus_tree_leaf_node *)node;
+}
+
+b_plus_tree_data_type *b_plus_tree_find(b_plus_tree *tree, const b_plus_tree_key_type *key_ptr)
+{
+    unsigned int i;
+    b_plus_tree_leaf_node *leaf = NULL;
+    assert(tree != NULL);
+    assert(key_ptr != NULL);
+    if (tree->root == NULL)
+        return NULL;
+    leaf = b_plus_tree_find_leaf(tree, key_ptr);
+    i = b_plus_tree_leaf_search(leaf, key_ptr);
+    if (i < leaf->count && b_plus_tree_key_compare(&leaf->data[i].key, key_ptr) == 0)
+        return &leaf->data[i];
+    return NULL;
+}
+
+inline b_plus_tree_data_type *b_plus_tree_find_min(b_plus_tree *tree)
+{
+    assert(tree != NULL);
+    return tree->first != NULL ? &tree->first->data[0] : NULL;
+}
+
+inline b_plus_tree_data_type *b_plus_tree_find_max(b_plus_tree *tree)
+{
+    assert(tree != NULL);
+    return tree->last != NULL ? &tree->last->data[tree->last->count - 1] : NULL;
+}
+
+static inline void b_plus_tree_inner_insert_at(b_plus_tree_inner_node *node, unsigned int i, const b_plus_tree_key_type *key_ptr, void *child)
+{
+    assert(node != NULL);
+    assert(node->count < B_PLUS_TREE_INNER_KEYS);
+    memmove(&node->key[i + 1], &node->key[i], (node->count - i) * sizeof(b_plus_tree_key_type));
+    memmove(&node->child[i + 2], &node->child[i + 1], (node->count - i) * sizeof(void *));
+    b_plus_tree_key_copy(&node->key[i], key_ptr);
+    node->child[i + 1] = child;
+    ++node->count;
+}
+
+// Removes key[i] together with the child to its right.
+static inline void b_plus_tree_inner_erase_at(b_plus_tree_inner_node *node, unsigned int i)
+{
+    assert(node != NULL);
+    assert(i < node->count);
+    memmove(&node->key[i], &node->key[i + 1], (node->count - i - 1) * sizeof(b_plus_tree_key_type));
+    memmove(&node->child[i + 1], &node->child[i + 2], (node->count - i - 1) * sizeof(void *));
+    --node->count;
+}
+
+// Returns the new right sibling when the leaf splits and stores its first key in split_key.
+static void *b_plus_tree_leaf_insert(b_plus_tree *tree, b_plus_tree_leaf_node *leaf, const b_plus_tree_data_type *data_ptr, b_plus_tree_key_type *split_key)
+{
+    unsigned int i;
+    unsigned int from;
+    unsigned int half = (B_PLUS_TREE_LEAF_SIZE + 1) >> 1;
+    b_plus_tree_leaf_node *right = NULL;
+    b_plus_tree_leaf_node *target = NULL;
+    assert(tree != NULL);
+    assert(leaf != NULL);
+    assert(data_ptr != NULL);
+    i = b_plus_tree_leaf_search(leaf, &data_ptr->key);
+    if (i < leaf->count && b_plus_tree_key_compare(&leaf->data[i].key, &data_ptr->key) == 0) {
+        b_plus_tree_val_copy(&leaf->data[i].val, &data_ptr->val);
+        return NULL;
+    }
+    ++tree->size;
+    target = leaf;
+    if (leaf->count == B_PLUS_TREE_LEAF_SIZE) {
+        right = create_b_plus_tree_leaf_node(tree);
+        from = i < half ? half - 1 : half;
+        memcpy(right->data, &leaf->data[from], (B_PLUS_TREE_LEAF_SIZE - from) * sizeof(b_plus_tree_data_type));
+        right->count = B_PLUS_TREE_LEAF_SIZE - from;
+        leaf->count = from;
+        right->prev = leaf;
+        right->next = leaf->next;
+        if (leaf->next != NULL)
+            leaf->next->prev = right;
+        else
+            tree->last = right;
+        leaf->next = right;
+        if (i >= half) {
+            target = right;
+            i -= from;
+        }
+    }
+    memmove(&target->data[i + 1], &target->data[i], (target->count - i) * sizeof(b_plus_tree_data_type));
+    b_plus_tree_data_copy(&target->data[i], data_ptr);
+    ++target->count;
+    if (right != NULL)
+        b_plus_tree_key_copy(split_key, &right->data[0].key);
+    return right;
+}
+
+// Inserts key and child at position i of a full node; the left half stays in place and the middle key moves up.
+static void *b_plus_tree_inner_split(b_plus_tree *tree, b_plus_tree_inner_node *node, unsigned int i, const b_plus_tree_key_type *key_ptr, void *child, b_plus_tree_key_type *split_key)
+{
+    unsigned int half = (B_PLUS_TREE_INNER_KEYS + 1) >> 1;
+    b_plus_tree_key_type key[B_PLUS_TREE_INNER_KEYS + 1];
+    void *children[B_PLUS_TREE_INNER_KEYS + 2];
+    b_plus_tree_inner_node *right = NULL;
+    assert(tree != NULL);
+    assert(node != NULL);
+    assert(node->count == B_PLUS_TREE_INNER_KEYS);
+    memcpy(key, node->key, i * sizeof(b_plus_tree_key_type));
+    b_plus_tree_key_copy(&key[i], key_ptr);
+    memcpy(&key[i + 1], &node->key[i], (B_PLUS_TREE_INNER_KEYS - i) * sizeof(b_plus_tree_key_type));
+    memcpy(children, node->child, (i + 1) * sizeof(void *));
+    children[i + 1] = child;
+    memcpy(&children[i + 2], &node->child[i + 1], (B_PLUS_TREE_INNER_KEYS - i) * sizeof(void *));
+    right = create_b_plus_tree_inner_node(tree);
+    memcpy(node->key, key, half * sizeof(b_plus_tree_key_type));
+    memcpy(node->child, children, (half + 1) * sizeof(void *));
+    node->count = half;
+    b_plus_tree_key_copy(split_key, &key[half]);
+    right->count = B_PLUS_TREE_INNER_KEYS - half;
+    memcpy(right->key, &key[half + 1], right->count * sizeof(b_plus_tree_key_type));
+    memcpy(right->child, &children[half + 1], (right->count + 1) * sizeof(void *));
+    return right;
+}
+
+static void *b_plus_tree_node_insert(b_plus_tree *tree, void *node, unsigned int level, const b_plus_tree_data_type *data_ptr, b_plus_tree_key_type *split_key)
+{
+    unsigned int i;
+    void *child = NULL;
+    b_plus_tree_key_type key;
+    b_plus_tree_inner_node *inner = NULL;
+    assert(tree != NULL);
+    assert(node != NULL);
+    if (level == 0)
+        return b_plus_tree_leaf_insert(tree, (b_plus_tree_leaf_node *)node, data_ptr, split_key);
+    inner = (b_plus_tree_inner_node *)node;
+    i = b_plus_tree_inner_search(inner, &data_ptr->key);
+    child = b_plus_tree_node_insert(tree, inner->child[i], level - 1, data_ptr, &key);
+    if (child == NULL)
+        return NULL;
+    if (inner->count < B_PLUS_TREE_INNER_KEYS) {
+        b_plus_tree_inner_insert_at(inner, i, &key, child);
+        return NULL;
+    }
+    return b_plus_tree_inner_split(tree, inner, i, &key, child, split_key);
+}
+
+void b_plus_tree_insert(b_plus_tree *tree, const b_plus_tree_data_type *data_ptr)
+{
+    void *right = NULL;
+    b_plus_tree_key_type key;
+    b_plus_tree_inner_node *root = NULL;
+    assert(tree != NULL);
+    assert(data_ptr != NULL);
+    if (tree->root == NULL)
+        tree->root = tree->first = tree->last = create_b_plus_tree_leaf_node(tree);
+    right = b_plus_tree_node_insert(tree, tree->root, tree->height, data_ptr, &key);
+    if (right != NULL) {
+        root = create_b_plus_tree_inner_node(tree);
+        b_plus_tree_key_copy(&root->key[0], &key);
+        root->child[0] = tree->root;
+        root->child[1] = right;
+        root->count = 1;
+        tree->root = root;
+        ++tree->height;
+    }
+}
+
+// Merges child[i + 1] of the parent into child[i].
+static void b_plus_tree_leaf_merge(b_plus_tree *tree, b_plus_tree_inner_node *parent, unsigned int i)
+{
+    b_plus_tree_leaf_node *left = NULL;
+    b_plus_tree_leaf_node *right = NULL;
+    assert(tree != NULL);
+    assert(parent != NULL);
+    left = (b_plus_tree_leaf_node *)parent->child[i];
+    right = (b_plus_tree_leaf_node *)parent->child[i + 1];
+    assert(left->count + right->count <= B_PLUS_TREE_LEAF_SIZE);
+    memcpy(&left->data[left->count], right->data, right->count * sizeof(b_plus_tree_data_type));
+    left->count += right->count;
+    left->next = right->next;
+    if (right->next != NULL)
+        right->next->prev = left;
+    else
+        tree->last = left;
+    b_plus_tree_pool_free(&tree->leaf_pool, right);
+    b_plus_tree_inner_erase_at(parent, i);
+}
+
+static void b_plus_tree_inner_merge(b_plus_tree *tree, b_plus_tree_inner_node *parent, unsigned int i)
+{
+    b_plus_tree_inner_node *left = NULL;
+    b_plus_tree_inner_node *right = NULL;
+    assert(tree != NULL);
+    assert(parent != NULL);
+    left = (b_plus_tree_inner_node *)parent->child[i];
+    right = (b_plus_tree_inner_node *)parent->child[i + 1];
+    assert(left->count + right->count + 1 <= B_PLUS_TREE_INNER_KEYS);
+    b_plus_tree_key_copy(&left->key[left->count], &parent->key[i]);
+    memcpy(&left->key[left->count + 1], right->key, right->count * sizeof(b_plus_tree_key_type));
+    memcpy(&left->child[left->count + 1], right->child, (right->count + 1) * sizeof(void *));
+    left->count += right->count + 1;
+    b_plus_tree_pool_free(&tree->inner_pool, right);
+    b_plus_tree_inner_erase_at(parent, i);
+}
+
+static void b_plus_tree_leaf_rebalance(b_plus_tree *tree, b_plus_tree_inner_node *parent, unsigned int i)
+{
+    b_plus_tree_leaf_node *leaf = NULL;
+    b_plus_tree_leaf_node *sibling = NULL;
+    assert(tree != NULL);
+    assert(parent != NULL);
+    leaf = (b_plus_tree_leaf_node *)parent->child[i];
+    if (i > 0) {
+        sibling = (b_plus_tree_leaf_node *)parent->child[i - 1];
+        if (sibling->count > B_PLUS_TREE_LEAF_MIN) {
+            memmove(&leaf->data[1], leaf->data, leaf->count * sizeof(b_plus_tree_data_type));
+            b_plus_tree_data_copy(&leaf->data[0], &sibling->data[--sibling->count]);
+            ++leaf->count;
+            b_plus_tree_key_copy(&parent->key[i - 1], &leaf->data[0].key);
+            return;
+        }
+    }
+    if (i < parent->count) {
+        sibling = (b_plus_tree_leaf_node *)parent->child[i + 1];
+        if (sibling->count > B_PLUS_TREE_LEAF_MIN) {
+            b_plus_tree_data_copy(&leaf->data[leaf->count++], &sibling->data[0]);
+            memmove(sibling->data, &sibling->data[1], --sibling->count * sizeof(b_plus_tree_data_type));
+            b_plus_tree_key_copy(&parent->key[i], &sibling->data[0].key);
+            return;
+        }
+    }
+    b_plus_tree_leaf_merge(tree, parent, i > 0 ? i - 1 : i);
+}
+
+static void b_plus_tree_inner_rebalance(b_plus_tree *tree, b_plus_tree_inner_node *parent, unsigned int i)
+{
+    b_plus_tree_inner_node *node = NULL;
+    b_plus_tree_inner_node *sibling = NULL;
+    assert(tree != NULL);
+    assert(parent != NULL);
+    node = (b_plus_tree_inner_node *)parent->child[i];
+    if (i > 0) {
+        sibling = (b_plus_tree_inner_node *)parent->child[i - 1];
+        if (sibling->count > B_PLUS_TREE_INNER_MIN) {
+            memmove(&node->key[1], node->key, node->count * sizeof(b_plus_tree_key_type));
+            memmove(&node->child[1], node->child, (node->count + 1) * sizeof(void *));
+            b_plus_tree_key_copy(&node->key[0], &parent->key[i - 1]);
+            node->child[0] = sibling->child[sibling->count];
+            ++node->count;
+            b_plus_tree_key_copy(&parent->key[i - 1], &sibling->key[--sibling->count]);
+            return;
+        }
+    }
+    if (i < parent->count) {
+        sibling = (b_plus_tree_inner_node *)parent->child[i + 1];
+        if (sibling->count > B_PLUS_TREE_INNER_MIN) {
+            b_plus_tree_key_copy(&node->key[node->count], &parent->key[i]);
+            node->child[++node->count] = sibling->child[0];
+            b_plus_tree_key_copy(&parent->key[i], &sibling->key[0]);
+            memmove(sibling->key, &sibling->key[1], (sibling->count - 1) * sizeof(b_plus_tree_key_type));
+            memmove(sibling->child, &sibling->child[1], sibling->count * sizeof(void *));
+            --sibling->count;
+            return;
+        }
+    }
+    b_plus_tree_inner_merge(tree, parent, i > 0 ? i - 1 : i);
+}
+
+// Returns whether the key was found; an underfull child is fixed on the way back up.
+static int b_plus_tree_node_delete(b_plus_tree *tree, void *node, unsigned int level, const b_plus_tree_key_type *key_ptr)
+{
+    unsigned int i;
+    b_plus_tree_leaf_node *leaf = NULL;
+    b_plus_tree_inner_node *inner = NULL;
+    assert(tree != NULL);
+    assert(node != NULL);
+    assert(key_ptr != NULL);
+    if (level == 0) {
+        leaf = (b_plus_tree_leaf_node *)node;
+        i = b_plus_tree_leaf_search(leaf, key_ptr);
+        if (i == leaf->count || b_plus_tree_key_compare(&leaf->data[i].key, key_ptr) != 0)
+            return 0;
+        memmove(&leaf->data[i], &leaf->data[i + 1], (leaf->count - i - 1) * sizeof(b_plus_tree_data_type));
+        --leaf->count;
+        --tree->size;
+        return 1;
+    }
+    inner = (b_plus_tree_inner_node *)node;
+    i = b_plus_tree_inner_search(inner, key_ptr);
+    if (!b_plus_tree_node_delete(tree, inner->child[i], level - 1, key_ptr))
+        return 0;
+    if (level == 1 && ((b_plus_tree_leaf_node *)inner->child[i])->count < B_PLUS_TREE_LEAF_MIN)
+        b_plus_tree_leaf_rebalance(tree, inner, i);
+    else if (level > 1 && ((b_plus_tree_inner_node *)inner->child[i])->count < B_PLUS_TREE_INNER_MIN)
+        b_plus_tree_inner_rebalance(tree, inner, i);
+    return 1;
+}
+
+void b_plus_tree_delete(b_plus_tree *tree, const b_plus_tree_key_type *key_ptr)
+{
+    void *root = NULL;
+    assert(tree != NULL);
+    assert(key_ptr != NULL);
+    if (tree->root == NULL || !b_plus_tree_node_delete(tree, tree->root, tree->height, key_ptr))
+        return;
+    root = tree->root;
+    if (tree->height > 0 && ((b_plus_tree_inner_node *)root)->count == 0) {
+        tree->root = ((b_plus_tree_inner_node *)root)->child[0];
+        --tree->height;
+        b_plus_tree_pool_free(&tree->inner_pool, root);
+    } else if (tree->height == 0 && ((b_plus_tree_leaf_node *)root)->count == 0) {
+        b_plus_tree_pool_free(&tree->leaf_pool, root);
+        tree->root = tree->first = tree->last = NULL;
+    }
+}
+
+// Visits the entries with keys in [low, high) in ascending order along the leaf chain and returns their number.
+unsigned long b_plus_tree_for_each_range(b_plus_tree *tree, const b_plus_tree_key_type *low, const b_plus_tree_key_type *high, b_plus_tree_visit_func_type func, void *arg)
+{
+    unsigned int i;
+    unsigned long ret = 0;
+    b_plus_tree_leaf_node *leaf = NULL;
+    assert(tree != NULL);
+    assert(low != NULL);
+    assert(high != NULL);
+    assert(func != NULL);
+    if (tree->root == NULL || b_plus_tree_key_compare(low, high) >= 0)
+        return 0;
+    leaf = b_plus_tree_find_leaf(tree, low);
+    i = b_plus_tree_leaf_search(leaf, low);
+    for (; leaf != NULL; leaf = leaf->next, i = 0) {
+        B_PLUS_TREE_PREFETCH(leaf->next);
+        for (; i < leaf->count; ++i) {
+            if (b_plus_tree_key_compare(&leaf->data[i].key, high) >= 0)
+                return ret;
+            func(&leaf->data[i], arg);
+            ++ret;
+        }
+    }
+    return ret;
+}
+
+void b_plus_tree_clear(b_plus_tree *tree)
+{
+    assert(tree != NULL);
+    b_plus_tree_pool_release(&tree->inner_pool);
+    b_plus_tree_pool_release(&tree->leaf_pool);
+    tree->root = NULL;
+    tree->first = tree->last = NULL;
+    tree->height = 0;
+    tree->size = 0;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef __B_PLUS_TREE_H__
+#define __B_PLUS_TREE_H__
+
+// Inner nodes hold up to B_PLUS_TREE_INNER_KEYS separator keys in their first two cache lines, so a descent touches about
+// three lines per level; leaves hold the entries themselves and are linked in key order for scans.
+// Nodes come from per-tree pools of cache-line-aligned chunks, which are returned only by b_plus_tree_clear.
+// The AVX2 searches compare 32-bit int keys; build without AVX2 when changing b_plus_tree_key_type.
+#define B_PLUS_TREE_CACHE_LINE 64
+#define B_PLUS_TREE_INNER_KEYS 32
+#define B_PLUS_TREE_LEAF_SIZE 32
+#define B_PLUS_TREE_CHUNK_NODES 64
+
+typedef int b_plus_tree_key_type;
+typedef int b_plus_tree_val_type;
+typedef struct BPlusTreeDataNode
+{
+    b_plus_tree_key_type key;
+    b_plus_tree_val_type val;
+} b_plus_tree_data_type;
+// child[i] holds the keys in [key[i - 1], key[i]); children are leaves on the lowest inner level and inner nodes above it.
+typedef struct BPlusTreeInnerNode
+{
+    b_plus_tree_key_type key[B_PLUS_TREE_INNER_KEYS];
+    void *child[B_PLUS_TREE_INNER_KEYS + 1];
+    unsigned int count;
+} b_plus_tree_inner_node;
+typedef struct BPlusTreeLeafNode
+{
+    b_plus_tree_data_type data[B_PLUS_TREE_LEAF_SIZE];
+    struct BPlusTreeLeafNode *prev;
+    struct BPlusTreeLeafNode *next;
+    unsigned int count;
+} b_plus_tree_leaf_node;
+typedef struct BPlusTreePool
+{
+    void *chunk;
+    void *free_list;
+    unsigned long node_size;
+} b_plus_tree_pool;
+typedef struct BPlusTree
+{
+    void *root;
+    b_plus_tree_leaf_node *first;
+    b_plus_tree_leaf_node *last;
+    unsigned int height;
+    unsigned long size;
+    b_plus_tree_pool inner_pool;
+    b_plus_tree_pool leaf_pool;
+} b_plus_tree;
+// for_each_range visits the keys in the half-open interval [low, high) in ascending order; an entry keyed high is not visited.
+typedef void (*b_plus_tree_visit_func_type)(b_plus_tree_data_type *, void *);
+
+void b_plus_tree_init(b_plus_tree *);
+int b_plus_tree_empty(const b_plus_tree *);
+unsigned long b_plus_tree_size(const b_plus_tree *);
+b_plus_tree_data_type *b_plus_tree_find(b_plus_tree *, const b_plus_tree_key_type *);
+b_plus_tree_data_type *b_plus_tree_find_min(b_plus_tree *);
+b_plus_tree_data_type *b_plus_tree_find_max(b_plus_tree *);
+void b_plus_tree_insert(b_plus_tree *, const b_plus_tree_data_type *);
+void b_plus_tree_delete(b_plus_tree *, const b_plus_tree_key_type *);
+unsigned long b_plus_tree_for_each_range(b_plus_tree *, const b_plus_tree_key_type *, const b_plus_tree_key_type *, b_plus_tree_visit_func_type, void *);
+void b_plus_tree_clear(b_plus_tree *);
+
+#endif // __B_PLUS_TREE_H__
\ No newline at end of file
@@ -0,0 +1,317 @@
+#include "b_plus_tree.h"
+#include "../benchmark/benchmark.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+
+#define MAXN (1 << 22)
+#define CHECKN (B_PLUS_TREE_LEAF_SIZE * 64 + 7)
+
+// Walks a range scan along the sorted reference keys in [ref[pos], ref[end]).
+typedef struct CheckScan
+{
+    const int *ref;
+    unsigned long pos;
+    unsigned long end;
+    int ok;
+} check_scan;
+
+b_plus_tree *tree;
+int *keys;
+
+unsigned long count_leaves(const b_plus_tree *);
+void add_key(b_plus_tree_data_type *, void *);
+void check(int, const char *);
+void check_visit(b_plus_tree_data_type *, void *);
+unsigned long check_lower_bound(const int *, unsigned long, int);
+unsigned long check_collect(const char *, int *);
+void check_range(b_plus_tree *, const int *, unsigned long, int, int);
+void check_tree(b_plus_tree *, const int *, unsigned long);
+void check_leaf_boundaries(void);
+
+unsigned long count_leaves(const b_plus_tree *tree)
+{
+    unsigned long ret = 0;
+    const b_plus_tree_leaf_node *leaf = NULL;
+    for (leaf = tree->first; leaf != NULL; leaf = leaf->next)
+        ++ret;
+    return ret;
+}
+
+void add_key(b_plus_tree_data_type *data, void *arg)
+{
+    *(unsigned long long *)arg += (unsigned int)data->key;
+}
+
+void check(int ok, const char *what)
+{
+    if (!ok) {
+        fprintf(stderr, "b_plus_tree: check failed: %s\n", what);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void check_visit(b_plus_tree_data_type *data, void *arg)
+{
+    check_scan *scan = (check_scan *)arg;
+    if (scan->pos >= scan->end || data->key != scan->ref[scan->pos] || data->val != data->key)
+        scan->ok = 0;
+    ++scan->pos;
+}
+
+unsigned long check_lower_bound(const int *ref, unsigned long n, int key)
+{
+    unsigned long low = 0;
+    unsigned long high = n;
+    unsigned long mid;
+    while (low < high) {
+        mid = low + ((high - low) >> 1);
+        if (ref[mid] < key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+unsigned long check_collect(const char *present, int *ref)
+{
+    int i;
+    unsigned long n = 0;
+    for (i = 0; i < CHECKN; ++i) {
+        if (present[i])
+            ref[n++] = i << 1;
+    }
+    return n;
+}
+
+void check_range(b_plus_tree *tree, const int *ref, unsigned long n, int low, int high)
+{
+    unsigned long ret;
+    check_scan scan;
+    scan.ref = ref;
+    scan.pos = check_lower_bound(ref, n, low);
+    scan.end = check_lower_bound(ref, n, high);
+    scan.ok = 1;
+    ret = b_plus_tree_for_each_range(tree, &low, &high, check_visit, &scan);
+    check(scan.ok && scan.pos == scan.end, "for_each_range visits [low, high) in order");
+    check(ret == scan.end - check_lower_bound(ref, n, low), "for_each_range returns the visit count");
+}
+
+// Every stored key is even, so each odd key is a miss that falls between two entries.
+void check_tree(b_plus_tree *tree, const int *ref, unsigned long n)
+{
+    unsigned long i;
+    int key;
+    b_plus_tree_data_type *data = NULL;
+    const b_plus_tree_leaf_node *leaf = NULL;
+    check(b_plus_tree_size(tree) == n, "size");
+    check(b_plus_tree_empty(tree) == (n == 0), "empty");
+    if (n == 0) {
+        check(b_plus_tree_find_min(tree) == NULL && b_plus_tree_find_max(tree) == NULL, "find_min/find_max on an empty tree");
+        return;
+    }
+    check(b_plus_tree_find_min(tree)->key == ref[0], "find_min");
+    check(b_plus_tree_find_max(tree)->key == ref[n - 1], "find_max");
+    for (i = 0; i < n; ++i) {
+        data = b_plus_tree_find(tree, &ref[i]);
+        check(data != NULL && data->key == ref[i] && data->val == ref[i], "find of a stored key");
+        key = ref[i] + 1;
+        check(b_plus_tree_find(tree, &key) == NULL, "find of a missing key");
+    }
+    key = ref[0] - 1;
+    check(b_plus_tree_find(tree, &key) == NULL, "find below the minimum");
+    check_range(tree, ref, n, INT_MIN, INT_MAX);
+    for (leaf = tree->first; leaf != NULL; leaf = leaf->next) {
+        check(leaf->count > 0, "no empty leaves");
+        // high lands exactly on a stored key, which must not be visited.
+        check_range(tree, ref, n, leaf->data[0].key, leaf->data[leaf->count - 1].key);
+        check_range(tree, ref, n, leaf->data[0].key, leaf->data[leaf->count - 1].key + 1);
+        check_range(tree, ref, n, leaf->data[0].key - 1, leaf->data[0].key + 1);
+        check_range(tree, ref, n, leaf->data[0].key, leaf->data[0].key);
+        if (leaf->next != NULL) {
+            check(leaf->data[leaf->count - 1].key < leaf->next->data[0].key, "leaves are linked in key order");
+            check_range(tree, ref, n, leaf->data[leaf->count - 1].key, leaf->next->data[0].key);
+            check_range(tree, ref, n, leaf->data[leaf->count - 1].key + 1, leaf->next->data[0].key + 1);
+        }
+    }
+}
+
+void check_leaf_boundaries(void)
+{
+    int i;
+    int j;
+    int key;
+    unsigned long n;
+    unsigned long m;
+    int order[CHECKN];
+    int ref[CHECKN];
+    int edge[CHECKN];
+    char present[CHECKN];
+    b_plus_tree local;
+    b_plus_tree *t = &local;
+    const b_plus_tree_leaf_node *leaf = NULL;
+
+    for (i = 0; i < CHECKN; ++i)
+        order[i] = i;
+    for (i = CHECKN - 1; i > 0; --i) {
+        j = rand() % (i + 1);
+        key = order[i];
+        order[i] = order[j];
+        order[j] = key;
+    }
+    b_plus_tree_init(t);
+    for (i = 0; i < CHECKN; ++i) {
+        key = order[i] << 1;
+        b_plus_tree_insert(t, &(b_plus_tree_data_type){key, key});
+        present[i] = 1;
+    }
+    // Inserting a stored key again must not add an entry.
+    b_plus_tree_insert(t, &(b_plus_tree_data_type){0, 0});
+    n = check_collect(present, ref);
+    check_tree(t, ref, n);
+
+    // Take out the first and last entry of every leaf.
+    m = 0;
+    for (leaf = t->first; leaf != NULL; leaf = leaf->next) {
+        edge[m++] = leaf->data[0].key;
+        if (leaf->count > 1)
+            edge[m++] = leaf->data[leaf->count - 1].key;
+    }
+    for (i = 0; i < (int)m; ++i) {
+        b_plus_tree_delete(t, &edge[i]);
+        present[edge[i] >> 1] = 0;
+    }
+    // Deleting a missing key is a no-op.
+    key = 1;
+    b_plus_tree_delete(t, &key);
+    n = check_collect(present, ref);
+    check_tree(t, ref, n);
+
+    // Thin the tree out so leaves underflow and borrow or merge.
+    for (i = 0; i < CHECKN; ++i) {
+        if (present[order[i]] && i % 3 != 0) {
+            key = order[i] << 1;
+            b_plus_tree_delete(t, &key);
+            present[order[i]] = 0;
+        }
+    }
+    n = check_collect(present, ref);
+    check_tree(t, ref, n);
+
+    for (i = 0; i < CHECKN; ++i) {
+        key = order[i] << 1;
+        b_plus_tree_delete(t, &key);
+        present[order[i]] = 0;
+    }
+    check_tree(t, ref, 0);
+    b_plus_tree_clear(t);
+}
+
+void setup_empty(void *arg)
+{
+    (void)arg;
+    b_plus_tree_init(tree);
+}
+
+void setup_full(void *arg)
+{
+    int i;
+    setup_empty(arg);
+    for (i = 0; i < MAXN; ++i)
+        b_plus_tree_insert(tree, &(b_plus_tree_data_type){keys[i], keys[i]});
+}
+
+void setup_deleted(void *arg)
+{
+    int i;
+    setup_full(arg);
+    for (i = 0; i < (MAXN >> 1); ++i)
+        b_plus_tree_delete(tree, &keys[i]);
+}
+
+void teardown(void *arg)
+{
+    (void)arg;
+    b_plus_tree_clear(tree);
+}
+
+void insert_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        benchmark_op_begin(rec);
+        b_plus_tree_insert(tree, &(b_plus_tree_data_type){keys[i], keys[i]});
+        benchmark_op_end(rec);
+    }
+    rec->checksum = count_leaves(tree);
+}
+
+void delete_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < (MAXN >> 1); ++i) {
+        benchmark_op_begin(rec);
+        b_plus_tree_delete(tree, &keys[i]);
+        benchmark_op_end(rec);
+    }
+    rec->checksum = b_plus_tree_size(tree);
+}
+
+void find_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        benchmark_op_begin(rec);
+        if (b_plus_tree_find(tree, &keys[i]) != NULL)
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+void scan_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int high;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < (MAXN >> 4); ++i) {
+        high = keys[i] > INT_MAX - (1 << 16) ? INT_MAX : keys[i] + (1 << 16);
+        benchmark_op_begin(rec);
+        b_plus_tree_for_each_range(tree, &keys[i], &high, add_key, &rec->checksum);
+        benchmark_op_end(rec);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+    benchmark b;
+    tree = (b_plus_tree *)malloc(sizeof(b_plus_tree));
+    keys = (int *)malloc(sizeof(int) * MAXN);
+    if (tree == NULL || keys == NULL)
+        exit(EXIT_FAILURE);
+
+    srand((unsigned int)time(NULL));
+    for (i = 0; i < MAXN; ++i)
+        keys[i] = i & 1 ? i : rand() + i;
+    check_leaf_boundaries();
+
+    benchmark_init(&b, "b_plus_tree", argc, argv);
+    benchmark_run(&b, &(benchmark_case){"insert", 1, setup_empty, insert_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"delete", 1, setup_full, delete_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"find", 1, setup_deleted, find_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"scan", 1, setup_deleted, scan_run, teardown, NULL});
+    benchmark_finish(&b);
+
+    free(tree);
+    free(keys);
+    return 0;
+}
\ No newline at end of file
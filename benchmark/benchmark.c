@@ -0,0 +1,464 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#include "benchmark.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define BENCHMARK_CALIBRATION_ROUNDS 1024
+#define BENCHMARK_MIN_SAMPLES 1024
+#define BENCHMARK_MIN_TEXT_RATE 1000.0
+
+// Hardware counters are reported per operation; a negative value means the counter could not be read.
+typedef struct BenchmarkResult
+{
+    unsigned long long ops;
+    double seconds;
+    double min_seconds;
+    double ops_per_sec;
+    unsigned long long p50;
+    unsigned long long p99;
+    unsigned long long p999;
+    unsigned long long samples;
+    unsigned long long checksum;
+    double counter[BENCHMARK_COUNTERS];
+} benchmark_result;
+typedef struct BenchmarkThread
+{
+    benchmark_recorder *recorder;
+    const benchmark_case *bench_case;
+    unsigned int index;
+} benchmark_thread;
+
+static const char *const benchmark_counter_name[BENCHMARK_COUNTERS] = {"cache_misses_per_op", "branch_misses_per_op"};
+
+static int benchmark_compare(const void *, const void *);
+static int benchmark_compare_double(const void *, const void *);
+static unsigned long long benchmark_calibrate(void);
+static int benchmark_parse_option(benchmark *, const char *);
+static void benchmark_perf_open(benchmark *);
+static void benchmark_perf_start(benchmark *);
+static void benchmark_perf_stop(benchmark *, unsigned long long *);
+static void benchmark_perf_close(benchmark *);
+static void benchmark_recorder_reset(benchmark_recorder *, unsigned int, unsigned long long, int);
+static void benchmark_recorder_push(benchmark_recorder *, unsigned long long);
+static void *benchmark_worker(void *);
+static void benchmark_trial(benchmark *, const benchmark_case *, unsigned int);
+static unsigned long long benchmark_percentile(const unsigned long long *, unsigned long long, double);
+static void benchmark_collect(benchmark *, unsigned int, benchmark_result *);
+static void benchmark_print(benchmark *, const benchmark_case *, unsigned int, const benchmark_result *);
+
+static int benchmark_compare(const void *lhs, const void *rhs)
+{
+    unsigned long long a = *(const unsigned long long *)lhs;
+    unsigned long long b = *(const unsigned long long *)rhs;
+    return a < b ? -1 : a > b;
+}
+
+static int benchmark_compare_double(const void *lhs, const void *rhs)
+{
+    double a = *(const double *)lhs;
+    double b = *(const double *)rhs;
+    return a < b ? -1 : a > b;
+}
+
+unsigned long long benchmark_now(void)
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (unsigned long long)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL
+        + (unsigned long long)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL / (unsigned long long)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+#endif
+}
+
+static unsigned long long benchmark_calibrate(void)
+{
+    unsigned long i;
+    unsigned long long begin;
+    unsigned long long delta[BENCHMARK_CALIBRATION_ROUNDS];
+    for (i = 0; i < BENCHMARK_CALIBRATION_ROUNDS; ++i) {
+        begin = benchmark_now();
+        delta[i] = benchmark_now() - begin;
+    }
+    qsort(delta, BENCHMARK_CALIBRATION_ROUNDS, sizeof(unsigned long long), benchmark_compare);
+    return delta[BENCHMARK_CALIBRATION_ROUNDS / 2];
+}
+
+static int benchmark_parse_option(benchmark *b, const char *arg)
+{
+    assert(b != NULL);
+    assert(arg != NULL);
+    if (strcmp(arg, "--format=text") == 0) {
+        b->format = BENCHMARK_TEXT;
+    } else if (strcmp(arg, "--format=json") == 0) {
+        b->format = BENCHMARK_JSON;
+    } else if (strcmp(arg, "--format=csv") == 0) {
+        b->format = BENCHMARK_CSV;
+    } else if (strncmp(arg, "--output=", 9) == 0) {
+        b->output = fopen(arg + 9, "w");
+        if (b->output == NULL)
+            return 0;
+    } else if (strncmp(arg, "--warmup=", 9) == 0) {
+        b->warmup = (unsigned int)strtoul(arg + 9, NULL, 10);
+    } else if (strncmp(arg, "--trials=", 9) == 0) {
+        b->trials = (unsigned int)strtoul(arg + 9, NULL, 10);
+    } else if (strncmp(arg, "--sample=", 9) == 0) {
+        b->sample_interval = (unsigned int)strtoul(arg + 9, NULL, 10);
+    } else if (strcmp(arg, "--perf") == 0) {
+        b->perf = 1;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+void benchmark_init(benchmark *b, const char *suite, int argc, char **argv)
+{
+    int i;
+    assert(b != NULL);
+    assert(suite != NULL);
+    memset(b, 0, sizeof(benchmark));
+    b->suite = suite;
+    b->format = BENCHMARK_TEXT;
+    b->output = stdout;
+    b->warmup = BENCHMARK_DEFAULT_WARMUP;
+    b->trials = BENCHMARK_DEFAULT_TRIALS;
+    b->sample_interval = BENCHMARK_DEFAULT_SAMPLE_INTERVAL;
+    for (i = 1; i < argc; ++i) {
+        if (!benchmark_parse_option(b, argv[i])) {
+            fprintf(stderr, "usage: %s [--format=text|json|csv] [--output=path] [--warmup=n] [--trials=n] [--sample=n] [--perf]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (b->trials == 0)
+        b->trials = 1;
+    if (b->sample_interval == 0)
+        b->sample_interval = 1;
+    for (i = 0; i < BENCHMARK_COUNTERS; ++i)
+        b->perf_fd[i] = -1;
+    if (b->perf)
+        benchmark_perf_open(b);
+    b->timer_overhead = benchmark_calibrate();
+    if (b->format == BENCHMARK_JSON) {
+        fprintf(b->output, "{\"suite\": \"%s\", \"warmup\": %u, \"trials\": %u, \"sample_interval\": %u, \"timer_overhead_ns\": %llu, \"results\": [",
+            b->suite, b->warmup, b->trials, b->sample_interval, b->timer_overhead);
+    } else if (b->format == BENCHMARK_CSV) {
+        fprintf(b->output, "suite,name,threads,trials,ops,seconds,min_seconds,ops_per_sec,p50_ns,p99_ns,p999_ns,samples,%s,%s,checksum\n",
+            benchmark_counter_name[0], benchmark_counter_name[1]);
+    }
+}
+
+static void benchmark_perf_open(benchmark *b)
+{
+#if defined(__linux__)
+    unsigned int i;
+    struct perf_event_attr attr;
+    static const unsigned long long config[BENCHMARK_COUNTERS] = {PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    assert(b != NULL);
+    for (i = 0; i < BENCHMARK_COUNTERS; ++i) {
+        memset(&attr, 0, sizeof(struct perf_event_attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(struct perf_event_attr);
+        attr.config = config[i];
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        b->perf_fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    if (b->perf_fd[0] < 0 && b->perf_fd[1] < 0)
+        fprintf(stderr, "benchmark: hardware counters are unavailable\n");
+#else
+    assert(b != NULL);
+    fprintf(stderr, "benchmark: hardware counters are unavailable\n");
+#endif
+}
+
+static void benchmark_perf_start(benchmark *b)
+{
+#if defined(__linux__)
+    unsigned int i;
+    assert(b != NULL);
+    for (i = 0; i < BENCHMARK_COUNTERS; ++i) {
+        if (b->perf_fd[i] >= 0) {
+            ioctl(b->perf_fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(b->perf_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    (void)b;
+#endif
+}
+
+static void benchmark_perf_stop(benchmark *b, unsigned long long *value)
+{
+    unsigned int i;
+    assert(b != NULL);
+    assert(value != NULL);
+    for (i = 0; i < BENCHMARK_COUNTERS; ++i) {
+        value[i] = 0;
+#if defined(__linux__)
+        if (b->perf_fd[i] >= 0) {
+            ioctl(b->perf_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(b->perf_fd[i], &value[i], sizeof(unsigned long long)) != sizeof(unsigned long long))
+                value[i] = 0;
+        }
+#endif
+    }
+}
+
+static void benchmark_perf_close(benchmark *b)
+{
+    unsigned int i;
+    assert(b != NULL);
+    for (i = 0; i < BENCHMARK_COUNTERS; ++i) {
+#if defined(__linux__)
+        if (b->perf_fd[i] >= 0)
+            close(b->perf_fd[i]);
+#endif
+        b->perf_fd[i] = -1;
+    }
+}
+
+static void benchmark_recorder_reset(benchmark_recorder *rec, unsigned int interval, unsigned long long overhead, int keep_samples)
+{
+    assert(rec != NULL);
+    rec->ops = 0;
+    rec->checksum = 0;
+    rec->interval = interval;
+    rec->overhead = overhead;
+    rec->sampling = 0;
+    if (!keep_samples)
+        rec->sample_count = 0;
+}
+
+static void benchmark_recorder_push(benchmark_recorder *rec, unsigned long long sample)
+{
+    assert(rec != NULL);
+    if (rec->sample_count == rec->sample_capacity) {
+        rec->sample_capacity = rec->sample_capacity ? rec->sample_capacity << 1 : BENCHMARK_MIN_SAMPLES;
+        rec->samples = (unsigned long long *)realloc(rec->samples, rec->sample_capacity * sizeof(unsigned long long));
+        assert(rec->samples != NULL);
+    }
+    rec->samples[rec->sample_count++] = sample;
+}
+
+inline void benchmark_op_begin(benchmark_recorder *rec)
+{
+    assert(rec != NULL);
+    if (rec->ops++ % rec->interval == 0) {
+        rec->sampling = 1;
+        rec->begin = benchmark_now();
+    }
+}
+
+inline void benchmark_op_end(benchmark_recorder *rec)
+{
+    unsigned long long elapsed;
+    assert(rec != NULL);
+    if (!rec->sampling)
+        return;
+    elapsed = benchmark_now() - rec->begin;
+    benchmark_recorder_push(rec, elapsed > rec->overhead ? elapsed - rec->overhead : 0);
+    rec->sampling = 0;
+}
+
+static void *benchmark_worker(void *arg)
+{
+    benchmark_thread *thread = (benchmark_thread *)arg;
+    assert(thread != NULL);
+    thread->bench_case->run(thread->recorder, thread->index, thread->bench_case->arg);
+    return NULL;
+}
+
+static void benchmark_trial(benchmark *b, const benchmark_case *bench_case, unsigned int threads)
+{
+    unsigned int i;
+    pthread_t handle[BENCHMARK_MAX_THREADS];
+    benchmark_thread thread[BENCHMARK_MAX_THREADS];
+    assert(b != NULL);
+    assert(bench_case != NULL);
+    for (i = 0; i < threads; ++i) {
+        thread[i].recorder = &b->recorder[i];
+        thread[i].bench_case = bench_case;
+        thread[i].index = i;
+    }
+    for (i = 1; i < threads; ++i) {
+        if (pthread_create(&handle[i], NULL, benchmark_worker, &thread[i]) != 0)
+            assert(0);
+    }
+    benchmark_worker(&thread[0]);
+    for (i = 1; i < threads; ++i)
+        pthread_join(handle[i], NULL);
+}
+
+static unsigned long long benchmark_percentile(const unsigned long long *sorted, unsigned long long n, double p)
+{
+    unsigned long long rank;
+    if (n == 0)
+        return 0;
+    rank = (unsigned long long)(p * (double)n);
+    return sorted[rank < n ? rank : n - 1];
+}
+
+static void benchmark_collect(benchmark *b, unsigned int threads, benchmark_result *result)
+{
+    unsigned int i;
+    unsigned long long n = 0;
+    unsigned long long *samples = NULL;
+    assert(b != NULL);
+    assert(result != NULL);
+    for (i = 0; i < threads; ++i)
+        n += b->recorder[i].sample_count;
+    result->samples = n;
+    result->p50 = result->p99 = result->p999 = 0;
+    if (n == 0)
+        return;
+    samples = (unsigned long long *)malloc(n * sizeof(unsigned long long));
+    assert(samples != NULL);
+    for (i = 0, n = 0; i < threads; ++i) {
+        memcpy(samples + n, b->recorder[i].samples, b->recorder[i].sample_count * sizeof(unsigned long long));
+        n += b->recorder[i].sample_count;
+    }
+    qsort(samples, n, sizeof(unsigned long long), benchmark_compare);
+    result->p50 = benchmark_percentile(samples, n, 0.5);
+    result->p99 = benchmark_percentile(samples, n, 0.99);
+    result->p999 = benchmark_percentile(samples, n, 0.999);
+    free(samples);
+}
+
+void benchmark_run(benchmark *b, const benchmark_case *bench_case)
+{
+    unsigned int i;
+    unsigned int t;
+    unsigned int threads;
+    unsigned long long begin;
+    unsigned long long value[BENCHMARK_COUNTERS];
+    unsigned long long counter[BENCHMARK_COUNTERS] = {0};
+    double *seconds = NULL;
+    benchmark_result result;
+    assert(b != NULL);
+    assert(bench_case != NULL);
+    assert(bench_case->run != NULL);
+    threads = bench_case->threads ? bench_case->threads : 1;
+    if (threads > BENCHMARK_MAX_THREADS)
+        threads = BENCHMARK_MAX_THREADS;
+    seconds = (double *)malloc(b->trials * sizeof(double));
+    assert(seconds != NULL);
+    memset(&result, 0, sizeof(benchmark_result));
+    for (t = 0; t < b->warmup + b->trials; ++t) {
+        if (bench_case->setup != NULL)
+            bench_case->setup(bench_case->arg);
+        for (i = 0; i < threads; ++i)
+            benchmark_recorder_reset(&b->recorder[i], b->sample_interval, b->timer_overhead, t > b->warmup);
+        benchmark_perf_start(b);
+        begin = benchmark_now();
+        benchmark_trial(b, bench_case, threads);
+        if (t >= b->warmup)
+            seconds[t - b->warmup] = (double)(benchmark_now() - begin) / 1e9;
+        benchmark_perf_stop(b, value);
+        if (t >= b->warmup) {
+            for (i = 0; i < BENCHMARK_COUNTERS; ++i)
+                counter[i] += value[i];
+        }
+        if (bench_case->teardown != NULL)
+            bench_case->teardown(bench_case->arg);
+    }
+    for (i = 0; i < threads; ++i) {
+        result.ops += b->recorder[i].ops;
+        result.checksum += b->recorder[i].checksum;
+    }
+    qsort(seconds, b->trials, sizeof(double), benchmark_compare_double);
+    result.seconds = seconds[b->trials / 2];
+    result.min_seconds = seconds[0];
+    result.ops_per_sec = result.seconds > 0 ? (double)result.ops / result.seconds : 0;
+    for (i = 0; i < BENCHMARK_COUNTERS; ++i)
+        result.counter[i] = b->perf_fd[i] >= 0 && result.ops ? (double)counter[i] / b->trials / (double)result.ops : -1;
+    benchmark_collect(b, threads, &result);
+    benchmark_print(b, bench_case, threads, &result);
+    free(seconds);
+}
+
+static void benchmark_print(benchmark *b, const benchmark_case *bench_case, unsigned int threads, const benchmark_result *result)
+{
+    unsigned int i;
+    assert(b != NULL);
+    assert(bench_case != NULL);
+    assert(result != NULL);
+    if (b->format == BENCHMARK_JSON) {
+        fprintf(b->output, "%s\n    {\"name\": \"%s\", \"threads\": %u, \"trials\": %u, \"ops\": %llu, \"seconds\": %.9f, \"min_seconds\": %.9f, \"ops_per_sec\": %.1f, "
+            "\"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"samples\": %llu",
+            b->case_count ? "," : "", bench_case->name, threads, b->trials, result->ops, result->seconds, result->min_seconds, result->ops_per_sec,
+            result->p50, result->p99, result->p999, result->samples);
+        for (i = 0; i < BENCHMARK_COUNTERS; ++i) {
+            if (result->counter[i] < 0)
+                fprintf(b->output, ", \"%s\": null", benchmark_counter_name[i]);
+            else
+                fprintf(b->output, ", \"%s\": %.6f", benchmark_counter_name[i], result->counter[i]);
+        }
+        fprintf(b->output, ", \"checksum\": %llu}", result->checksum);
+    } else if (b->format == BENCHMARK_CSV) {
+        fprintf(b->output, "%s,%s,%u,%u,%llu,%.9f,%.9f,%.1f,%llu,%llu,%llu,%llu", b->suite, bench_case->name, threads, b->trials, result->ops,
+            result->seconds, result->min_seconds, result->ops_per_sec, result->p50, result->p99, result->p999, result->samples);
+        for (i = 0; i < BENCHMARK_COUNTERS; ++i) {
+            if (result->counter[i] < 0)
+                fprintf(b->output, ",");
+            else
+                fprintf(b->output, ",%.6f", result->counter[i]);
+        }
+        fprintf(b->output, ",%llu\n", result->checksum);
+    } else {
+        // Bulk cases record one op per trial; a rounded rate would print as 0 or 1 ops/s, so show the time per op instead.
+        if (result->ops > 0 && result->ops_per_sec < BENCHMARK_MIN_TEXT_RATE)
+            fprintf(b->output, "%s/%s: %.6fs/op", b->suite, bench_case->name, result->seconds / (double)result->ops);
+        else
+            fprintf(b->output, "%s/%s: %.0f ops/s", b->suite, bench_case->name, result->ops_per_sec);
+        fprintf(b->output, " (%llu ops, median %.3fs of %u trials, %u threads), p50 %lluns p99 %lluns p999 %lluns",
+            result->ops, result->seconds, b->trials, threads, result->p50, result->p99, result->p999);
+        for (i = 0; i < BENCHMARK_COUNTERS; ++i) {
+            if (result->counter[i] >= 0)
+                fprintf(b->output, ", %s %.3f", benchmark_counter_name[i], result->counter[i]);
+        }
+        fprintf(b->output, ", checksum %llu\n", result->checksum);
+    }
+    fflush(b->output);
+    ++b->case_count;
+}
+
+void benchmark_finish(benchmark *b)
+{
+    unsigned int i;
+    assert(b != NULL);
+    if (b->format == BENCHMARK_JSON)
+        fprintf(b->output, "\n]}\n");
+    if (b->output != stdout)
+        fclose(b->output);
+    b->output = NULL;
+    benchmark_perf_close(b);
+    for (i = 0; i < BENCHMARK_MAX_THREADS; ++i) {
+        free(b->recorder[i].samples);
+        b->recorder[i].samples = NULL;
+        b->recorder[i].sample_count = b->recorder[i].sample_capacity = 0;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include <stdio.h>
+
+// A case runs warmup untimed trials and then the measured ones; setup and teardown wrap every trial outside the timer.
+// Throughput comes from the median trial. Every sample_interval-th operation is timed on its own for the latency
+// percentiles, with the timer overhead measured at startup subtracted.
+#define BENCHMARK_MAX_THREADS 64
+#define BENCHMARK_DEFAULT_WARMUP 1
+#define BENCHMARK_DEFAULT_TRIALS 5
+#define BENCHMARK_DEFAULT_SAMPLE_INTERVAL 16
+#define BENCHMARK_COUNTERS 2
+
+typedef enum BenchmarkFormat
+{
+    BENCHMARK_TEXT,
+    BENCHMARK_JSON,
+    BENCHMARK_CSV
+} benchmark_format;
+typedef struct BenchmarkRecorder
+{
+    unsigned long long *samples;
+    unsigned long sample_count;
+    unsigned long sample_capacity;
+    unsigned long long ops;
+    unsigned long long begin;
+    unsigned long long overhead;
+    unsigned long long checksum;
+    unsigned int interval;
+    int sampling;
+} benchmark_recorder;
+typedef struct BenchmarkCase
+{
+    const char *name;
+    unsigned int threads;
+    void (*setup)(void *);
+    void (*run)(benchmark_recorder *, unsigned int, void *);
+    void (*teardown)(void *);
+    void *arg;
+} benchmark_case;
+typedef struct Benchmark
+{
+    const char *suite;
+    benchmark_format format;
+    FILE *output;
+    unsigned int warmup;
+    unsigned int trials;
+    unsigned int sample_interval;
+    unsigned long long timer_overhead;
+    unsigned long case_count;
+    int perf;
+    int perf_fd[BENCHMARK_COUNTERS];
+    benchmark_recorder recorder[BENCHMARK_MAX_THREADS];
+} benchmark;
+
+unsigned long long benchmark_now(void);
+void benchmark_init(benchmark *, const char *, int, char **);
+void benchmark_op_begin(benchmark_recorder *);
+void benchmark_op_end(benchmark_recorder *);
+void benchmark_run(benchmark *, const benchmark_case *);
+void benchmark_finish(benchmark *);
+
+#endif // __BENCHMARK_H__
\ No newline at end of file
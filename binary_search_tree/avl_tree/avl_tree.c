@@ -1,6 +1,36 @@
 #include "avl_tree.h"
 #include <stdlib.h>
 #include <assert.h>
+#include <pthread.h>
+
+// Bulk build hands a subtree to a new thread only when it holds at least this many entries.
+#define AVL_TREE_MIN_REGION 4096
+// Set operations fork only while both subtrees are at least this high, which leaves each thread a few thousand entries.
+#define AVL_TREE_MIN_FORK_HEIGHT 12
+
+typedef struct AVLTreeBuildTask
+{
+    const avl_tree_data_type *data;
+    unsigned long n;
+    unsigned int threads;
+    avl_tree_node *root;
+} avl_tree_build_task;
+typedef avl_tree_node *(*avl_tree_set_func_type)(avl_tree_node *, avl_tree_node *, unsigned int);
+typedef struct AVLTreeSetTask
+{
+    avl_tree_set_func_type func;
+    avl_tree_node *lhs;
+    avl_tree_node *rhs;
+    unsigned int threads;
+    avl_tree_node *root;
+} avl_tree_set_task;
+typedef struct AVLTreeDeleteTask
+{
+    avl_tree_node *root;
+    const avl_tree_key_type *keys;
+    unsigned long n;
+    unsigned int threads;
+} avl_tree_delete_task;
 
 static int avl_tree_key_compare(const avl_tree_key_type *, const avl_tree_key_type *);
 static int avl_tree_data_compare(const avl_tree_data_type *, const avl_tree_data_type *);
@@ -11,6 +41,9 @@ static avl_tree_node *create_avl_tree_node(const avl_tree_data_type *);
 static long get_height(const avl_tree_node *);
 static long max(long, long);
 static long calc_height(avl_tree_node *);
+#ifdef AVL_TREE_ORDER_STATISTIC
+static unsigned long get_size(const avl_tree_node *);
+#endif
 static int get_balance_factor(const avl_tree_node *);
 static avl_tree_node *left_rotate(avl_tree_node *);
 static avl_tree_node *right_rotate(avl_tree_node *);
@@ -24,6 +57,23 @@ static avl_tree_node *avl_tree_node_insert(avl_tree_node *, const avl_tree_data_
 static avl_tree_node *avl_tree_node_delete(avl_tree_node *, const avl_tree_key_type *);
 static avl_tree_node *root_node_delete(avl_tree_node *);
 static void avl_tree_node_clear(avl_tree_node *);
+static int avl_tree_sorted(const avl_tree_data_type *, unsigned long);
+static avl_tree_node *avl_tree_build(const avl_tree_data_type *, unsigned long, unsigned int);
+static void *avl_tree_build_worker(void *);
+static avl_tree_node *join_left(avl_tree_node *, avl_tree_node *, avl_tree_node *);
+static avl_tree_node *join_right(avl_tree_node *, avl_tree_node *, avl_tree_node *);
+static avl_tree_node *avl_tree_node_join(avl_tree_node *, avl_tree_node *, avl_tree_node *);
+static avl_tree_node *split_max_node(avl_tree_node *, avl_tree_node **);
+static avl_tree_node *avl_tree_node_concat(avl_tree_node *, avl_tree_node *);
+static avl_tree_node *avl_tree_node_split(avl_tree_node *, const avl_tree_key_type *, avl_tree_node **, avl_tree_node **);
+static void *avl_tree_set_worker(void *);
+static void avl_tree_set_fork(avl_tree_set_task *, avl_tree_set_task *, unsigned int);
+static avl_tree_node *avl_tree_node_union(avl_tree_node *, avl_tree_node *, unsigned int);
+static avl_tree_node *avl_tree_node_intersection(avl_tree_node *, avl_tree_node *, unsigned int);
+static avl_tree_node *avl_tree_node_difference(avl_tree_node *, avl_tree_node *, unsigned int);
+static int avl_tree_keys_sorted(const avl_tree_key_type *, unsigned long);
+static avl_tree_node *avl_tree_node_delete_batch(avl_tree_node *, const avl_tree_key_type *, unsigned long, unsigned int);
+static void *avl_tree_delete_worker(void *);
 
 static inline int avl_tree_key_compare(const avl_tree_key_type *lhs, const avl_tree_key_type *rhs)
 {
@@ -72,6 +122,9 @@ static inline avl_tree_node *create_avl_tree_node(const avl_tree_data_type *data
     assert(ret != NULL);
     ret->data = *data_ptr;
     ret->height = 0;
+#ifdef AVL_TREE_ORDER_STATISTIC
+    ret->size = 1;
+#endif
     ret->left = ret->right = NULL;
     return ret;
 }
@@ -86,8 +139,19 @@ static inline long max(long a, long b)
     return a > b ? a : b;
 }
 
+#ifdef AVL_TREE_ORDER_STATISTIC
+static inline unsigned long get_size(const avl_tree_node *root)
+{
+    return root ? root->size : 0;
+}
+#endif
+
+// Every rotation, insert and delete recomputes the height here, so the subtree size is kept in step with it.
 static long calc_height(avl_tree_node *root)
 {
+#ifdef AVL_TREE_ORDER_STATISTIC
+    root->size = get_size(root->left) + get_size(root->right) + 1;
+#endif
     return root->height = max(get_height(root->left), get_height(root->right)) + 1;
 }
 
@@ -201,9 +265,9 @@ static inline avl_tree_node *avl_tree_balance(avl_tree_node *root)
 {
     int bf = get_balance_factor(root);
     if (bf < -1)
-        return get_balance_factor(root->right) < 0 ? left_rotate(root) : right_left_rotate(root);
+        return get_balance_factor(root->right) <= 0 ? left_rotate(root) : right_left_rotate(root);
     if (bf > 1)
-        return get_balance_factor(root->left) > 0 ? right_rotate(root) : left_right_rotate(root);
+        return get_balance_factor(root->left) >= 0 ? right_rotate(root) : left_right_rotate(root);
     return root;
 }
 
@@ -257,12 +321,14 @@ static avl_tree_node *root_node_delete(avl_tree_node *root)
     avl_tree_node *ret = NULL;
     if (root->left != NULL && root->right != NULL) {
         if (get_height(root->left) < get_height(root->right)) {
-            avl_tree_data_copy(&root->data, &find_max_node(root->right)->data);
-            ret = avl_tree_node_delete(root->right, &root->data.key);
+            avl_tree_data_copy(&root->data, &find_min_node(root->right)->data);
+            root->right = avl_tree_node_delete(root->right, &root->data.key);
         } else {
-            avl_tree_data_copy(&root->data, &find_min_node(root->left)->data);
-            ret = avl_tree_node_delete(root->left, &root->data.key);
+            avl_tree_data_copy(&root->data, &find_max_node(root->left)->data);
+            root->left = avl_tree_node_delete(root->left, &root->data.key);
         }
+        calc_height(root);
+        ret = avl_tree_balance(root);
     } else {
         if (root->left != NULL)
             ret = root->left;
@@ -282,6 +348,371 @@ inline void avl_tree_delete(avl_tree *tree, const avl_tree_key_type *key_ptr)
     tree->root = avl_tree_node_delete(tree->root, key_ptr);
 }
 
+static inline int avl_tree_sorted(const avl_tree_data_type *data, unsigned long n)
+{
+    unsigned long i;
+    for (i = 1; i < n; ++i) {
+        if (avl_tree_data_compare(&data[i - 1], &data[i]) >= 0)
+            return 0;
+    }
+    return 1;
+}
+
+// The middle entry becomes the root and each half is built the same way, so sibling subtrees differ in size by at most one.
+static avl_tree_node *avl_tree_build(const avl_tree_data_type *data, unsigned long n, unsigned int threads)
+{
+    unsigned long mid;
+    pthread_t thread;
+    avl_tree_build_task task;
+    avl_tree_node *root = NULL;
+    if (n == 0)
+        return NULL;
+    mid = n >> 1;
+    root = create_avl_tree_node(&data[mid]);
+    task.data = data;
+    task.n = mid;
+    task.threads = threads >> 1;
+    if (threads > 1 && n >= AVL_TREE_MIN_REGION && pthread_create(&thread, NULL, avl_tree_build_worker, &task) == 0) {
+        root->right = avl_tree_build(data + mid + 1, n - mid - 1, threads - task.threads);
+        pthread_join(thread, NULL);
+        root->left = task.root;
+    } else {
+        root->left = avl_tree_build(data, mid, 1);
+        root->right = avl_tree_build(data + mid + 1, n - mid - 1, 1);
+    }
+    calc_height(root);
+    return root;
+}
+
+static void *avl_tree_build_worker(void *arg)
+{
+    avl_tree_build_task *task = (avl_tree_build_task *)arg;
+    assert(task != NULL);
+    task->root = avl_tree_build(task->data, task->n, task->threads);
+    return NULL;
+}
+
+// Replaces the contents with n entries sorted by strictly increasing key in O(n), splitting the work over up to threads threads.
+void avl_tree_build_from_sorted(avl_tree *tree, const avl_tree_data_type *data, unsigned long n, unsigned int threads)
+{
+    assert(tree != NULL);
+    assert(n == 0 || data != NULL);
+    assert(avl_tree_sorted(data, n));
+    avl_tree_clear(tree);
+    tree->root = avl_tree_build(data, n, threads);
+}
+
+// Hangs mid and right off the right spine of left, where left is more than one level higher than right.
+static avl_tree_node *join_right(avl_tree_node *left, avl_tree_node *mid, avl_tree_node *right)
+{
+    if (get_height(left->right) <= get_height(right) + 1) {
+        mid->left = left->right;
+        mid->right = right;
+        calc_height(mid);
+        left->right = mid;
+    } else {
+        left->right = join_right(left->right, mid, right);
+    }
+    calc_height(left);
+    return avl_tree_balance(left);
+}
+
+static avl_tree_node *join_left(avl_tree_node *left, avl_tree_node *mid, avl_tree_node *right)
+{
+    if (get_height(right->left) <= get_height(left) + 1) {
+        mid->left = left;
+        mid->right = right->left;
+        calc_height(mid);
+        right->left = mid;
+    } else {
+        right->left = join_left(left, mid, right->left);
+    }
+    calc_height(right);
+    return avl_tree_balance(right);
+}
+
+// Joins two trees and a node whose key lies between them in O(|height(left) - height(right)| + 1).
+static avl_tree_node *avl_tree_node_join(avl_tree_node *left, avl_tree_node *mid, avl_tree_node *right)
+{
+    assert(mid != NULL);
+    if (get_height(left) > get_height(right) + 1)
+        return join_right(left, mid, right);
+    if (get_height(right) > get_height(left) + 1)
+        return join_left(left, mid, right);
+    mid->left = left;
+    mid->right = right;
+    calc_height(mid);
+    return mid;
+}
+
+static avl_tree_node *split_max_node(avl_tree_node *root, avl_tree_node **max_ptr)
+{
+    avl_tree_node *ret = NULL;
+    if (root->right == NULL) {
+        ret = root->left;
+        root->left = NULL;
+        *max_ptr = root;
+        return ret;
+    }
+    root->right = split_max_node(root->right, max_ptr);
+    calc_height(root);
+    return avl_tree_balance(root);
+}
+
+static avl_tree_node *avl_tree_node_concat(avl_tree_node *left, avl_tree_node *right)
+{
+    avl_tree_node *mid = NULL;
+    if (left == NULL)
+        return right;
+    if (right == NULL)
+        return left;
+    left = split_max_node(left, &mid);
+    return avl_tree_node_join(left, mid, right);
+}
+
+// Splits root into keys below and above the key and returns the node holding the key itself, or NULL.
+static avl_tree_node *avl_tree_node_split(avl_tree_node *root, const avl_tree_key_type *key_ptr, avl_tree_node **left, avl_tree_node **right)
+{
+    int cmp;
+    avl_tree_node *ret = NULL;
+    avl_tree_node *tmp = NULL;
+    assert(key_ptr != NULL);
+    if (root == NULL) {
+        *left = *right = NULL;
+        return NULL;
+    }
+    cmp = avl_tree_key_compare(key_ptr, &root->data.key);
+    if (cmp < 0) {
+        ret = avl_tree_node_split(root->left, key_ptr, left, &tmp);
+        *right = avl_tree_node_join(tmp, root, root->right);
+    } else if (cmp > 0) {
+        ret = avl_tree_node_split(root->right, key_ptr, &tmp, right);
+        *left = avl_tree_node_join(root->left, root, tmp);
+    } else {
+        *left = root->left;
+        *right = root->right;
+        root->left = root->right = NULL;
+        calc_height(root);
+        ret = root;
+    }
+    return ret;
+}
+
+// Moves every entry of other, whose keys must all be greater than those in the tree, onto the tree and leaves other empty.
+void avl_tree_join(avl_tree *tree, avl_tree *other)
+{
+    assert(tree != NULL);
+    assert(other != NULL);
+    assert(tree->root == NULL || other->root == NULL || avl_tree_key_compare(&find_max_node(tree->root)->data.key, &find_min_node(other->root)->data.key) < 0);
+    tree->root = avl_tree_node_concat(tree->root, other->root);
+    other->root = NULL;
+}
+
+// Moves the entries with keys not less than the key into right, replacing its contents, and keeps the rest in the tree.
+void avl_tree_split(avl_tree *tree, const avl_tree_key_type *key_ptr, avl_tree *right)
+{
+    avl_tree_node *found = NULL;
+    assert(tree != NULL);
+    assert(key_ptr != NULL);
+    assert(right != NULL);
+    assert(tree != right);
+    avl_tree_clear(right);
+    found = avl_tree_node_split(tree->root, key_ptr, &tree->root, &right->root);
+    if (found != NULL)
+        right->root = avl_tree_node_join(NULL, found, right->root);
+}
+
+static void *avl_tree_set_worker(void *arg)
+{
+    avl_tree_set_task *task = (avl_tree_set_task *)arg;
+    assert(task != NULL);
+    task->root = task->func(task->lhs, task->rhs, task->threads);
+    return NULL;
+}
+
+// Runs both halves of a set operation, the left one on a new thread while threads remain and both of its trees are high enough.
+static void avl_tree_set_fork(avl_tree_set_task *left, avl_tree_set_task *right, unsigned int threads)
+{
+    pthread_t thread;
+    left->threads = threads >> 1;
+    right->threads = threads - left->threads;
+    if (threads > 1 && get_height(left->lhs) >= AVL_TREE_MIN_FORK_HEIGHT && get_height(left->rhs) >= AVL_TREE_MIN_FORK_HEIGHT && pthread_create(&thread, NULL, avl_tree_set_worker, left) == 0) {
+        avl_tree_set_worker(right);
+        pthread_join(thread, NULL);
+    } else {
+        left->threads = right->threads = threads;
+        avl_tree_set_worker(left);
+        avl_tree_set_worker(right);
+    }
+}
+
+// Each set operation splits lhs around the root of rhs, recurses on the two halves and joins the results,
+// which takes O(m log(n / m + 1)) work for trees of m <= n entries. Both trees are consumed.
+static avl_tree_node *avl_tree_node_union(avl_tree_node *lhs, avl_tree_node *rhs, unsigned int threads)
+{
+    avl_tree_set_task left;
+    avl_tree_set_task right;
+    avl_tree_node *found = NULL;
+    if (lhs == NULL)
+        return rhs;
+    if (rhs == NULL)
+        return lhs;
+    found = avl_tree_node_split(lhs, &rhs->data.key, &left.lhs, &right.lhs);
+    free(found);
+    left.func = right.func = avl_tree_node_union;
+    left.rhs = rhs->left;
+    right.rhs = rhs->right;
+    avl_tree_set_fork(&left, &right, threads);
+    return avl_tree_node_join(left.root, rhs, right.root);
+}
+
+static avl_tree_node *avl_tree_node_intersection(avl_tree_node *lhs, avl_tree_node *rhs, unsigned int threads)
+{
+    avl_tree_set_task left;
+    avl_tree_set_task right;
+    avl_tree_node *found = NULL;
+    if (lhs == NULL || rhs == NULL) {
+        avl_tree_node_clear(lhs);
+        avl_tree_node_clear(rhs);
+        return NULL;
+    }
+    found = avl_tree_node_split(lhs, &rhs->data.key, &left.lhs, &right.lhs);
+    left.func = right.func = avl_tree_node_intersection;
+    left.rhs = rhs->left;
+    right.rhs = rhs->right;
+    free(rhs);
+    avl_tree_set_fork(&left, &right, threads);
+    if (found != NULL)
+        return avl_tree_node_join(left.root, found, right.root);
+    return avl_tree_node_concat(left.root, right.root);
+}
+
+static avl_tree_node *avl_tree_node_difference(avl_tree_node *lhs, avl_tree_node *rhs, unsigned int threads)
+{
+    avl_tree_set_task left;
+    avl_tree_set_task right;
+    avl_tree_node *found = NULL;
+    if (lhs == NULL || rhs == NULL) {
+        avl_tree_node_clear(rhs);
+        return lhs;
+    }
+    found = avl_tree_node_split(lhs, &rhs->data.key, &left.lhs, &right.lhs);
+    free(found);
+    left.func = right.func = avl_tree_node_difference;
+    left.rhs = rhs->left;
+    right.rhs = rhs->right;
+    free(rhs);
+    avl_tree_set_fork(&left, &right, threads);
+    return avl_tree_node_concat(left.root, right.root);
+}
+
+// Merges other into the tree, taking the value from other for keys in both, and leaves other empty.
+void avl_tree_union(avl_tree *tree, avl_tree *other, unsigned int threads)
+{
+    assert(tree != NULL);
+    assert(other != NULL);
+    assert(tree != other);
+    tree->root = avl_tree_node_union(tree->root, other->root, threads);
+    other->root = NULL;
+}
+
+// Keeps only the entries whose keys are also in other and leaves other empty.
+void avl_tree_intersection(avl_tree *tree, avl_tree *other, unsigned int threads)
+{
+    assert(tree != NULL);
+    assert(other != NULL);
+    assert(tree != other);
+    tree->root = avl_tree_node_intersection(tree->root, other->root, threads);
+    other->root = NULL;
+}
+
+// Removes the entries whose keys are in other and leaves other empty.
+void avl_tree_difference(avl_tree *tree, avl_tree *other, unsigned int threads)
+{
+    assert(tree != NULL);
+    assert(other != NULL);
+    assert(tree != other);
+    tree->root = avl_tree_node_difference(tree->root, other->root, threads);
+    other->root = NULL;
+}
+
+// Inserts n entries sorted by strictly increasing key by building them into a tree and taking the union.
+void avl_tree_insert_batch(avl_tree *tree, const avl_tree_data_type *data, unsigned long n, unsigned int threads)
+{
+    assert(tree != NULL);
+    assert(n == 0 || data != NULL);
+    assert(avl_tree_sorted(data, n));
+    tree->root = avl_tree_node_union(tree->root, avl_tree_build(data, n, threads), threads);
+}
+
+static inline int avl_tree_keys_sorted(const avl_tree_key_type *keys, unsigned long n)
+{
+    unsigned long i;
+    for (i = 1; i < n; ++i) {
+        if (avl_tree_key_compare(&keys[i - 1], &keys[i]) >= 0)
+            return 0;
+    }
+    return 1;
+}
+
+// Splits the keys around the root, deletes each part from the matching subtree and joins the subtrees back.
+static avl_tree_node *avl_tree_node_delete_batch(avl_tree_node *root, const avl_tree_key_type *keys, unsigned long n, unsigned int threads)
+{
+    unsigned long low = 0;
+    unsigned long high = n;
+    unsigned long mid;
+    int found;
+    pthread_t thread;
+    avl_tree_delete_task task;
+    avl_tree_node *right = NULL;
+    if (root == NULL || n == 0)
+        return root;
+    while (low < high) {
+        mid = low + ((high - low) >> 1);
+        if (avl_tree_key_compare(&keys[mid], &root->data.key) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    found = low < n && avl_tree_key_compare(&keys[low], &root->data.key) == 0;
+    task.root = root->left;
+    task.keys = keys;
+    task.n = low;
+    task.threads = threads >> 1;
+    keys += low + found;
+    n -= low + found;
+    if (threads > 1 && task.n >= AVL_TREE_MIN_REGION && n >= AVL_TREE_MIN_REGION && pthread_create(&thread, NULL, avl_tree_delete_worker, &task) == 0) {
+        right = avl_tree_node_delete_batch(root->right, keys, n, threads - task.threads);
+        pthread_join(thread, NULL);
+    } else {
+        task.threads = threads;
+        avl_tree_delete_worker(&task);
+        right = avl_tree_node_delete_batch(root->right, keys, n, threads);
+    }
+    if (found) {
+        free(root);
+        return avl_tree_node_concat(task.root, right);
+    }
+    return avl_tree_node_join(task.root, root, right);
+}
+
+static void *avl_tree_delete_worker(void *arg)
+{
+    avl_tree_delete_task *task = (avl_tree_delete_task *)arg;
+    assert(task != NULL);
+    task->root = avl_tree_node_delete_batch(task->root, task->keys, task->n, task->threads);
+    return NULL;
+}
+
+// Deletes n keys given in strictly increasing order, splitting the work over up to threads threads.
+void avl_tree_delete_batch(avl_tree *tree, const avl_tree_key_type *keys, unsigned long n, unsigned int threads)
+{
+    assert(tree != NULL);
+    assert(n == 0 || keys != NULL);
+    assert(avl_tree_keys_sorted(keys, n));
+    tree->root = avl_tree_node_delete_batch(tree->root, keys, n, threads);
+}
+
 static void avl_tree_node_clear(avl_tree_node *root)
 {
     if (root != NULL) {
@@ -296,4 +727,63 @@ inline void avl_tree_clear(avl_tree *tree)
     assert(tree != NULL);
     avl_tree_node_clear(tree->root);
     tree->root = NULL;
-}
\ No newline at end of file
+}
+
+#ifdef AVL_TREE_ORDER_STATISTIC
+inline unsigned long avl_tree_size(const avl_tree *tree)
+{
+    assert(tree != NULL);
+    return get_size(tree->root);
+}
+
+// Returns the node holding the k-th smallest key, counting from 0, or NULL when k is out of range.
+avl_tree_node *avl_tree_select(avl_tree *tree, unsigned long k)
+{
+    unsigned long left_size;
+    avl_tree_node *root = NULL;
+    assert(tree != NULL);
+    root = tree->root;
+    while (root != NULL) {
+        left_size = get_size(root->left);
+        if (k < left_size) {
+            root = root->left;
+        } else if (k == left_size) {
+            return root;
+        } else {
+            k -= left_size + 1;
+            root = root->right;
+        }
+    }
+    return NULL;
+}
+
+// Returns the number of keys less than the key, which is the index select would give it.
+unsigned long avl_tree_rank(avl_tree *tree, const avl_tree_key_type *key_ptr)
+{
+    unsigned long ret = 0;
+    avl_tree_node *root = NULL;
+    assert(tree != NULL);
+    assert(key_ptr != NULL);
+    root = tree->root;
+    while (root != NULL) {
+        if (avl_tree_key_compare(key_ptr, &root->data.key) <= 0) {
+            root = root->left;
+        } else {
+            ret += get_size(root->left) + 1;
+            root = root->right;
+        }
+    }
+    return ret;
+}
+
+// Returns the number of keys in [low, high).
+unsigned long avl_tree_count_range(avl_tree *tree, const avl_tree_key_type *low, const avl_tree_key_type *high)
+{
+    assert(tree != NULL);
+    assert(low != NULL);
+    assert(high != NULL);
+    if (avl_tree_key_compare(low, high) >= 0)
+        return 0;
+    return avl_tree_rank(tree, high) - avl_tree_rank(tree, low);
+}
+#endif
\ No newline at end of file
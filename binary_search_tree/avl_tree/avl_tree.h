@@ -1,6 +1,9 @@
 #ifndef __AVL_TREE_H__
 #define __AVL_TREE_H__
 
+// Uncomment to keep the subtree size in every node; select, rank and count_range then take O(log n).
+// #define AVL_TREE_ORDER_STATISTIC
+
 typedef int avl_tree_key_type;
 typedef int avl_tree_val_type;
 typedef struct AVLTreeDataNode
@@ -12,6 +15,9 @@ typedef struct AVLTreeNode
 {
     avl_tree_data_type data;
     long height;
+#ifdef AVL_TREE_ORDER_STATISTIC
+    unsigned long size;
+#endif
     struct AVLTreeNode *left;
     struct AVLTreeNode *right;
 } avl_tree_node;
@@ -27,6 +33,20 @@ avl_tree_node *avl_tree_find_min(avl_tree *);
 avl_tree_node *avl_tree_find_max(avl_tree *);
 void avl_tree_insert(avl_tree *, const avl_tree_data_type *);
 void avl_tree_delete(avl_tree *, const avl_tree_key_type *);
+void avl_tree_build_from_sorted(avl_tree *, const avl_tree_data_type *, unsigned long, unsigned int);
+void avl_tree_join(avl_tree *, avl_tree *);
+void avl_tree_split(avl_tree *, const avl_tree_key_type *, avl_tree *);
+void avl_tree_union(avl_tree *, avl_tree *, unsigned int);
+void avl_tree_intersection(avl_tree *, avl_tree *, unsigned int);
+void avl_tree_difference(avl_tree *, avl_tree *, unsigned int);
+void avl_tree_insert_batch(avl_tree *, const avl_tree_data_type *, unsigned long, unsigned int);
+void avl_tree_delete_batch(avl_tree *, const avl_tree_key_type *, unsigned long, unsigned int);
 void avl_tree_clear(avl_tree *);
+#ifdef AVL_TREE_ORDER_STATISTIC
+unsigned long avl_tree_size(const avl_tree *);
+avl_tree_node *avl_tree_select(avl_tree *, unsigned long);
+unsigned long avl_tree_rank(avl_tree *, const avl_tree_key_type *);
+unsigned long avl_tree_count_range(avl_tree *, const avl_tree_key_type *, const avl_tree_key_type *);
+#endif
 
 #endif // __AVL_TREE_H__
\ No newline at end of file
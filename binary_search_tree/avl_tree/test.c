@@ -1,14 +1,31 @@
 #include "avl_tree.h"
+#include "../../benchmark/benchmark.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
+#define CHECKN 3001
+#define CHECK_BUILD_MAXN 20011
+#define CHECK_SET_UNIVERSE 30011
+
+typedef void (*check_set_func_type)(avl_tree *, avl_tree *, unsigned int);
+
 void output(const avl_tree_node *);
 void pre_order(const avl_tree_node *);
 void in_order(const avl_tree_node *);
 void post_order(const avl_tree_node *);
 long max(long, long);
 long max_height(const avl_tree_node *);
+void check(int, const char *);
+unsigned long check_collect(const char *, unsigned long, int *);
+long check_node(const avl_tree_node *);
+unsigned long check_in_order(const avl_tree_node *, const int *, unsigned long, unsigned long);
+void check_tree(avl_tree *, const int *, unsigned long);
+void check_queries(void);
+void check_build(void);
+unsigned long check_set_build(avl_tree *, const char *, avl_tree_data_type *);
+void check_set_fill(char *, int);
+void check_set_operations(void);
 
 
 inline void output(const avl_tree_node *root)
@@ -54,59 +71,467 @@ long max_height(const avl_tree_node *root)
     return root ? max(max_height(root->left), max_height(root->right)) + 1 : 0;
 }
 
-#define MAXN (1 << 22)
+void check(int ok, const char *what)
+{
+    if (!ok) {
+        fprintf(stderr, "avl_tree: check failed: %s\n", what);
+        exit(EXIT_FAILURE);
+    }
+}
 
-int main(void)
+unsigned long check_collect(const char *present, unsigned long count, int *ref)
+{
+    unsigned long i;
+    unsigned long n = 0;
+    for (i = 0; i < count; ++i) {
+        if (present[i])
+            ref[n++] = (int)(i << 1);
+    }
+    return n;
+}
+
+// Returns the real height of the subtree after checking the stored heights, the balance and the subtree sizes.
+long check_node(const avl_tree_node *root)
+{
+    long left_height;
+    long right_height;
+    if (root == NULL)
+        return -1;
+    left_height = check_node(root->left);
+    right_height = check_node(root->right);
+    check(root->height == max(left_height, right_height) + 1, "stored heights");
+    check(left_height - right_height <= 1 && right_height - left_height <= 1, "AVL balance");
+#ifdef AVL_TREE_ORDER_STATISTIC
+    check(root->size == 1 + (root->left ? root->left->size : 0) + (root->right ? root->right->size : 0), "subtree sizes");
+#endif
+    return root->height;
+}
+
+unsigned long check_in_order(const avl_tree_node *root, const int *ref, unsigned long n, unsigned long pos)
+{
+    if (root == NULL)
+        return pos;
+    pos = check_in_order(root->left, ref, n, pos);
+    check(pos < n && root->data.key == ref[pos] && root->data.val == ref[pos], "in-order keys match the reference");
+    return check_in_order(root->right, ref, n, pos + 1);
+}
+
+// Every stored key is even, so each odd key falls strictly between two entries.
+void check_tree(avl_tree *tree, const int *ref, unsigned long n)
+{
+    unsigned long i;
+#ifdef AVL_TREE_ORDER_STATISTIC
+    unsigned long j;
+#endif
+    int key;
+    check_node(tree->root);
+    check(check_in_order(tree->root, ref, n, 0) == n, "the tree holds every reference key");
+    check(avl_tree_empty(tree) == (n == 0), "empty");
+    for (i = 0; i < n; ++i) {
+        check(avl_tree_find(tree, &ref[i]) != NULL, "find of a stored key");
+        key = ref[i] + 1;
+        check(avl_tree_find(tree, &key) == NULL, "find of a missing key");
+    }
+#ifdef AVL_TREE_ORDER_STATISTIC
+    check(avl_tree_size(tree) == n, "size");
+    check(avl_tree_select(tree, n) == NULL, "select past the end");
+    key = -1;
+    check(avl_tree_rank(tree, &key) == 0, "rank below the minimum");
+    for (i = 0; i < n; ++i) {
+        check(avl_tree_select(tree, i) != NULL && avl_tree_select(tree, i)->data.key == ref[i], "select");
+        check(avl_tree_rank(tree, &ref[i]) == i, "rank of a stored key");
+        key = ref[i] + 1;
+        check(avl_tree_rank(tree, &key) == i + 1, "rank of a missing key");
+    }
+    for (i = 0; i < n; i += 7) {
+        check(avl_tree_count_range(tree, &ref[i], &ref[i]) == 0, "count_range of an empty interval");
+        // high lands on a stored key, which is not counted.
+        for (j = i + 1; j < n && j <= i + 40; j += 13) {
+            check(avl_tree_count_range(tree, &ref[i], &ref[j]) == j - i, "count_range of [low, high)");
+            check(avl_tree_count_range(tree, &ref[j], &ref[i]) == 0, "count_range with low above high");
+        }
+    }
+#endif
+}
+
+void check_queries(void)
 {
     int i;
+    int j;
     int key;
-    int cnt = 0;
-    clock_t begin, end;
-    avl_tree *tree = (avl_tree *)malloc(sizeof(avl_tree));
-    if (tree == NULL)
-        exit(EXIT_FAILURE);
-    
+    unsigned long n;
+    int order[CHECKN];
+    int ref[CHECKN];
+    char present[CHECKN];
+    avl_tree local;
+    avl_tree *t = &local;
+
+    for (i = 0; i < CHECKN; ++i)
+        order[i] = i;
+    for (i = CHECKN - 1; i > 0; --i) {
+        j = rand() % (i + 1);
+        key = order[i];
+        order[i] = order[j];
+        order[j] = key;
+    }
+    avl_tree_init(t);
+    check_tree(t, ref, 0);
+    for (i = 0; i < CHECKN; ++i) {
+        key = order[i] << 1;
+        avl_tree_insert(t, &(avl_tree_data_type){key, key});
+        present[order[i]] = 1;
+    }
+    n = check_collect(present, CHECKN, ref);
+    check_tree(t, ref, n);
+
+    // Rebalancing can hide a bad rotation later on, so the shape is checked after every delete.
+    for (i = 0; i < CHECKN; ++i) {
+        if (i % 3 != 0) {
+            key = order[i] << 1;
+            avl_tree_delete(t, &key);
+            present[order[i]] = 0;
+            check_node(t->root);
+        }
+    }
+    n = check_collect(present, CHECKN, ref);
+    check_tree(t, ref, n);
+    avl_tree_clear(t);
+}
+
+// Builds cover the empty, tiny, single-region and forked cases, each replacing the previous contents.
+void check_build(void)
+{
+    static const unsigned long size[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 100, 1000, 4097, CHECK_BUILD_MAXN};
+    static const unsigned int threads[] = {1, 4};
+    unsigned long i;
+    unsigned long j;
+    unsigned long half = CHECK_BUILD_MAXN >> 1;
+    int *ref = (int *)malloc(sizeof(int) * CHECK_BUILD_MAXN);
+    avl_tree_data_type *data = (avl_tree_data_type *)malloc(sizeof(avl_tree_data_type) * CHECK_BUILD_MAXN);
+    avl_tree local;
+    avl_tree *t = &local;
+    check(ref != NULL && data != NULL, "allocation");
+
+    for (i = 0; i < CHECK_BUILD_MAXN; ++i) {
+        ref[i] = (int)(i << 1);
+        data[i] = (avl_tree_data_type){ref[i], ref[i]};
+    }
+    avl_tree_init(t);
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+        for (j = 0; j < sizeof(size) / sizeof(size[0]); ++j) {
+            avl_tree_build_from_sorted(t, data, size[j], threads[i]);
+            check_tree(t, ref, size[j]);
+        }
+    }
+
+    // A built tree has to keep working under ordinary deletes and inserts.
+    for (i = 0; i < half; ++i)
+        avl_tree_delete(t, &ref[i]);
+    check_tree(t, ref + half, CHECK_BUILD_MAXN - half);
+    for (i = 0; i < half; ++i)
+        avl_tree_insert(t, &data[i]);
+    check_tree(t, ref, CHECK_BUILD_MAXN);
+    avl_tree_clear(t);
+    free(ref);
+    free(data);
+}
+
+// Replaces the tree with the keys 2i for every member i and returns how many there are.
+unsigned long check_set_build(avl_tree *tree, const char *member, avl_tree_data_type *data)
+{
+    unsigned long i;
+    unsigned long n = 0;
+    for (i = 0; i < CHECK_SET_UNIVERSE; ++i) {
+        if (member[i])
+            data[n++] = (avl_tree_data_type){(int)(i << 1), (int)(i << 1)};
+    }
+    avl_tree_build_from_sorted(tree, data, n, 1);
+    return n;
+}
+
+void check_set_fill(char *member, int percent)
+{
+    unsigned long i;
+    for (i = 0; i < CHECK_SET_UNIVERSE; ++i)
+        member[i] = rand() % 100 < percent;
+}
+
+// Runs join, split, the set operations and the batches on random sets against a reference bitmap, from empty and
+// one-sided inputs to evenly mixed ones, single-threaded and forked. check_tree covers heights and balance.
+void check_set_operations(void)
+{
+    static const unsigned int threads[] = {1, 4};
+    static const int percent[][2] = {{50, 50}, {2, 98}, {98, 2}, {0, 50}, {50, 0}, {100, 100}};
+    static const unsigned long pivot[] = {0, 1, CHECK_SET_UNIVERSE / 100, CHECK_SET_UNIVERSE / 2, CHECK_SET_UNIVERSE - 1, CHECK_SET_UNIVERSE};
+    static const check_set_func_type op[] = {avl_tree_union, avl_tree_intersection, avl_tree_difference};
+    unsigned long i;
+    unsigned long j;
+    unsigned long k;
+    unsigned long x;
+    unsigned long n;
+    int key;
+    char *a = (char *)malloc(CHECK_SET_UNIVERSE);
+    char *b = (char *)malloc(CHECK_SET_UNIVERSE);
+    char *expect = (char *)malloc(CHECK_SET_UNIVERSE);
+    int *ref = (int *)malloc(sizeof(int) * CHECK_SET_UNIVERSE);
+    avl_tree_data_type *data = (avl_tree_data_type *)malloc(sizeof(avl_tree_data_type) * CHECK_SET_UNIVERSE);
+    avl_tree lhs;
+    avl_tree rhs;
+    check(a != NULL && b != NULL && expect != NULL && ref != NULL && data != NULL, "allocation");
+
+    avl_tree_init(&lhs);
+    avl_tree_init(&rhs);
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+        for (j = 0; j < sizeof(percent) / sizeof(percent[0]); ++j) {
+            for (k = 0; k < sizeof(op) / sizeof(op[0]); ++k) {
+                check_set_fill(a, percent[j][0]);
+                check_set_fill(b, percent[j][1]);
+                for (x = 0; x < CHECK_SET_UNIVERSE; ++x)
+                    expect[x] = k == 0 ? a[x] | b[x] : k == 1 ? a[x] & b[x] : a[x] & !b[x];
+                check_set_build(&lhs, a, data);
+                check_set_build(&rhs, b, data);
+                op[k](&lhs, &rhs, threads[i]);
+                check(avl_tree_empty(&rhs), "the set operations leave other empty");
+                check_tree(&lhs, ref, check_collect(expect, CHECK_SET_UNIVERSE, ref));
+            }
+
+            check_set_fill(a, percent[j][0]);
+            check_set_fill(b, percent[j][1]);
+            check_set_build(&lhs, a, data);
+            n = check_set_build(&rhs, b, data);
+            avl_tree_clear(&rhs);
+            avl_tree_insert_batch(&lhs, data, n, threads[i]);
+            for (x = 0; x < CHECK_SET_UNIVERSE; ++x)
+                expect[x] = a[x] | b[x];
+            check_tree(&lhs, ref, check_collect(expect, CHECK_SET_UNIVERSE, ref));
+
+            check_set_fill(b, percent[j][1]);
+            n = check_collect(b, CHECK_SET_UNIVERSE, ref);
+            avl_tree_delete_batch(&lhs, ref, n, threads[i]);
+            for (x = 0; x < CHECK_SET_UNIVERSE; ++x)
+                expect[x] &= !b[x];
+            check_tree(&lhs, ref, check_collect(expect, CHECK_SET_UNIVERSE, ref));
+        }
+    }
+
+    // Joins of trees of very different heights, and splits on stored keys, missing keys and both ends.
+    for (j = 0; j < sizeof(percent) / sizeof(percent[0]); ++j) {
+        for (k = 0; k < sizeof(pivot) / sizeof(pivot[0]); ++k) {
+            check_set_fill(a, percent[j][0]);
+            check_set_fill(b, percent[j][1]);
+            for (x = 0; x < CHECK_SET_UNIVERSE; ++x) {
+                if (x < pivot[k])
+                    b[x] = 0;
+                else
+                    a[x] = 0;
+                expect[x] = a[x] | b[x];
+            }
+            check_set_build(&lhs, a, data);
+            check_set_build(&rhs, b, data);
+            avl_tree_join(&lhs, &rhs);
+            check(avl_tree_empty(&rhs), "join leaves other empty");
+            check_tree(&lhs, ref, check_collect(expect, CHECK_SET_UNIVERSE, ref));
+
+            for (x = 0; x < 2; ++x) {
+                check_set_fill(a, percent[j][0]);
+                check_set_build(&lhs, a, data);
+                check_set_build(&rhs, a, data);
+                key = (int)(pivot[k] << 1 | x);
+                avl_tree_split(&lhs, &key, &rhs);
+                // The key 2p + x splits the members i at p + x.
+                for (n = 0; n < CHECK_SET_UNIVERSE; ++n)
+                    expect[n] = n < pivot[k] + x && a[n];
+                check_tree(&lhs, ref, check_collect(expect, CHECK_SET_UNIVERSE, ref));
+                for (n = 0; n < CHECK_SET_UNIVERSE; ++n)
+                    expect[n] = n >= pivot[k] + x && a[n];
+                check_tree(&rhs, ref, check_collect(expect, CHECK_SET_UNIVERSE, ref));
+            }
+        }
+    }
+
+    // For keys in both trees, union keeps the value from other.
+    avl_tree_clear(&lhs);
+    avl_tree_clear(&rhs);
+    avl_tree_insert(&lhs, &(avl_tree_data_type){0, 1});
+    avl_tree_insert(&rhs, &(avl_tree_data_type){0, 2});
+    key = 0;
+    avl_tree_union(&lhs, &rhs, 1);
+    check(avl_tree_find(&lhs, &key) != NULL && avl_tree_find(&lhs, &key)->data.val == 2, "union takes the value from other");
+    avl_tree_clear(&lhs);
+    free(a);
+    free(b);
+    free(expect);
+    free(ref);
+    free(data);
+}
+
+#define MAXN (1 << 22)
+
+avl_tree *tree;
+int *keys;
+avl_tree_data_type *sorted;
+int *sorted_keys;
+
+void setup_empty(void *arg)
+{
+    (void)arg;
     avl_tree_init(tree);
-    srand((unsigned int)time(NULL));
-    begin = clock();
+}
+
+void setup_full(void *arg)
+{
+    int i;
+    setup_empty(arg);
+    for (i = 0; i < MAXN; ++i)
+        avl_tree_insert(tree, &(avl_tree_data_type){keys[i], keys[i]});
+}
+
+void setup_deleted(void *arg)
+{
+    int i;
+    setup_full(arg);
+    for (i = 0; i < (MAXN >> 1); ++i)
+        avl_tree_delete(tree, &keys[i]);
+}
+
+void teardown(void *arg)
+{
+    (void)arg;
+    avl_tree_clear(tree);
+}
+
+void insert_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < MAXN; ++i) {
-        if (i & 1)
-            key = i;
-        else
-            key = rand() + i;
-        avl_tree_insert(tree, &(avl_tree_data_type){key, key});
+        benchmark_op_begin(rec);
+        avl_tree_insert(tree, &(avl_tree_data_type){keys[i], keys[i]});
+        benchmark_op_end(rec);
     }
-    end = clock();
-    printf("%lldms\n", end - begin);
-    printf("%d\n", tree->root->height);
+    rec->checksum = (unsigned long long)max_height(tree->root);
+}
 
-    srand((unsigned int)time(NULL));
-    begin = clock();
+void delete_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < (MAXN >> 1); ++i) {
-        if (i & 1)
-            key = i;
-        else
-            key = rand() + i;
-        avl_tree_delete(tree, &key);
+        benchmark_op_begin(rec);
+        avl_tree_delete(tree, &keys[i]);
+        benchmark_op_end(rec);
+    }
+    rec->checksum = (unsigned long long)max_height(tree->root);
+}
+
+void find_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        benchmark_op_begin(rec);
+        if (avl_tree_find(tree, &keys[i]) != NULL)
+            ++rec->checksum;
+        benchmark_op_end(rec);
     }
-    end = clock();
-    printf("%lldms\n", end - begin);
-    printf("%d\n", tree->root->height);
+}
+
+void build_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    (void)thread;
+    benchmark_op_begin(rec);
+    avl_tree_build_from_sorted(tree, sorted, MAXN, *(unsigned int *)arg);
+    benchmark_op_end(rec);
+    rec->checksum = (unsigned long long)max_height(tree->root);
+}
 
-    begin = clock();
+void insert_batch_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    (void)thread;
+    benchmark_op_begin(rec);
+    avl_tree_insert_batch(tree, sorted, MAXN, *(unsigned int *)arg);
+    benchmark_op_end(rec);
+    rec->checksum = (unsigned long long)max_height(tree->root);
+}
+
+void delete_batch_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    (void)thread;
+    benchmark_op_begin(rec);
+    avl_tree_delete_batch(tree, sorted_keys, MAXN, *(unsigned int *)arg);
+    benchmark_op_end(rec);
+    rec->checksum = (unsigned long long)max_height(tree->root);
+}
+
+#ifdef AVL_TREE_ORDER_STATISTIC
+void rank_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < MAXN; ++i) {
-        if (i & 1)
-            key = i;
-        else
-            key = rand() + i;
-        if (avl_tree_find(tree, &key) != NULL)
-            ++cnt;
+        benchmark_op_begin(rec);
+        rec->checksum += avl_tree_rank(tree, &keys[i]);
+        benchmark_op_end(rec);
     }
-    end = clock();
-    printf("%lldms\n", end - begin);
-    printf("%d\n", cnt);
+}
+
+void select_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    unsigned long size = avl_tree_size(tree);
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        benchmark_op_begin(rec);
+        rec->checksum += (unsigned int)avl_tree_select(tree, (unsigned long)keys[i] % size)->data.key;
+        benchmark_op_end(rec);
+    }
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    int i;
+    benchmark b;
+    tree = (avl_tree *)malloc(sizeof(avl_tree));
+    keys = (int *)malloc(sizeof(int) * MAXN);
+    sorted = (avl_tree_data_type *)malloc(sizeof(avl_tree_data_type) * MAXN);
+    sorted_keys = (int *)malloc(sizeof(int) * MAXN);
+    if (tree == NULL || keys == NULL || sorted == NULL || sorted_keys == NULL)
+        exit(EXIT_FAILURE);
+
+    srand((unsigned int)time(NULL));
+    for (i = 0; i < MAXN; ++i)
+        keys[i] = i & 1 ? i : rand() + i;
+    for (i = 0; i < MAXN; ++i)
+        sorted[i] = (avl_tree_data_type){i, i};
+    for (i = 0; i < MAXN; ++i)
+        sorted_keys[i] = i;
+    check_queries();
+    check_build();
+    check_set_operations();
+
+    benchmark_init(&b, "avl_tree", argc, argv);
+    benchmark_run(&b, &(benchmark_case){"insert", 1, setup_empty, insert_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"delete", 1, setup_full, delete_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"find", 1, setup_deleted, find_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"build", 1, setup_empty, build_run, teardown, &(unsigned int){1}});
+    benchmark_run(&b, &(benchmark_case){"build_parallel", 1, setup_empty, build_run, teardown, &(unsigned int){4}});
+    benchmark_run(&b, &(benchmark_case){"insert_batch", 1, setup_full, insert_batch_run, teardown, &(unsigned int){4}});
+    benchmark_run(&b, &(benchmark_case){"delete_batch", 1, setup_full, delete_batch_run, teardown, &(unsigned int){4}});
+#ifdef AVL_TREE_ORDER_STATISTIC
+    benchmark_run(&b, &(benchmark_case){"rank", 1, setup_deleted, rank_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"select", 1, setup_deleted, select_run, teardown, NULL});
+#endif
+    benchmark_finish(&b);
 
-    avl_tree_clear(tree);
     free(tree);
+    free(keys);
+    free(sorted);
+    free(sorted_keys);
     return 0;
 }
\ No newline at end of file
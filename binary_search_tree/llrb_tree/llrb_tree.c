@@ -1,6 +1,20 @@
 #include "llrb_tree.h"
 #include <stdlib.h>
+#include <limits.h>
 #include <assert.h>
+#include <pthread.h>
+
+// Bulk build hands a subtree to a new thread only when it holds at least this many entries.
+#define LLRB_TREE_MIN_REGION 4096
+
+typedef struct LlrbTreeBuildTask
+{
+    const llrb_tree_data_type *data;
+    unsigned long n;
+    unsigned int height;
+    unsigned int threads;
+    llrb_tree_node *root;
+} llrb_tree_build_task;
 
 static int llrb_tree_key_compare(const llrb_tree_key_type *, const llrb_tree_key_type *);
 static int llrb_tree_data_compare(const llrb_tree_data_type *, const llrb_tree_data_type *);
@@ -23,6 +37,10 @@ static llrb_tree_node *borrow_from_left(llrb_tree_node *);
 static llrb_tree_node *delete_min_node(llrb_tree_node *);
 static llrb_tree_node *llrb_tree_delete_node(llrb_tree_node *, const llrb_tree_key_type *);
 static void llrb_tree_node_clear(llrb_tree_node *);
+static int llrb_tree_sorted(const llrb_tree_data_type *, unsigned long);
+static unsigned long llrb_tree_max_size(unsigned int);
+static llrb_tree_node *llrb_tree_build(const llrb_tree_data_type *, unsigned long, unsigned int, unsigned int);
+static void *llrb_tree_build_worker(void *);
 
 static inline int llrb_tree_key_compare(const llrb_tree_key_type *lhs, const llrb_tree_key_type *rhs)
 {
@@ -298,6 +316,102 @@ static llrb_tree_node *llrb_tree_delete_node(llrb_tree_node *root, const llrb_tr
     return llrb_tree_balance(root);
 }
 
+static inline int llrb_tree_sorted(const llrb_tree_data_type *data, unsigned long n)
+{
+    unsigned long i;
+    for (i = 1; i < n; ++i) {
+        if (llrb_tree_data_compare(&data[i - 1], &data[i]) >= 0)
+            return 0;
+    }
+    return 1;
+}
+
+// Returns 3^height - 1, the most entries a subtree of that black height can hold, saturating at ULONG_MAX.
+static unsigned long llrb_tree_max_size(unsigned int height)
+{
+    unsigned long ret = 1;
+    while (height-- > 0) {
+        if (ret > ULONG_MAX / 3)
+            return ULONG_MAX;
+        ret *= 3;
+    }
+    return ret - 1;
+}
+
+// Lays the entries out as a 2-3 tree with all leaves at the same black height: a 2-node is a single black node and
+// a 3-node is a black node with a red left child. A subtree of black height h holds between 2^h - 1 and 3^h - 1 entries,
+// and 3-nodes are used only where the entries would not fit under 2-nodes, which keeps them near the leaves.
+static llrb_tree_node *llrb_tree_build(const llrb_tree_data_type *data, unsigned long n, unsigned int height, unsigned int threads)
+{
+    unsigned long left;
+    unsigned long middle = 0;
+    unsigned long right;
+    int spawned = 0;
+    pthread_t thread;
+    llrb_tree_build_task task;
+    llrb_tree_node *root = NULL;
+    llrb_tree_node *red = NULL;
+    if (height == 0) {
+        assert(n == 0);
+        return NULL;
+    }
+    left = n >> 1;
+    right = n - 1 - left;
+    if (left > llrb_tree_max_size(height - 1)) {
+        left = n / 3;
+        middle = (n - 1) / 3;
+        right = (n - 2) / 3;
+        red = create_llrb_tree_node(&data[left]);
+        root = create_llrb_tree_node(&data[left + middle + 1]);
+        root->left = red;
+    } else {
+        root = create_llrb_tree_node(&data[left]);
+    }
+    root->color = BLACK;
+    task.data = data;
+    task.n = left;
+    task.height = height - 1;
+    task.threads = threads >> 1;
+    if (threads > 1 && n >= LLRB_TREE_MIN_REGION && pthread_create(&thread, NULL, llrb_tree_build_worker, &task) == 0) {
+        spawned = 1;
+        threads -= task.threads;
+    } else {
+        llrb_tree_build_worker(&task);
+        threads = 1;
+    }
+    if (red != NULL)
+        red->right = llrb_tree_build(data + left + 1, middle, height - 1, threads);
+    root->right = llrb_tree_build(data + n - right, right, height - 1, threads);
+    if (spawned)
+        pthread_join(thread, NULL);
+    if (red != NULL)
+        red->left = task.root;
+    else
+        root->left = task.root;
+    return root;
+}
+
+static void *llrb_tree_build_worker(void *arg)
+{
+    llrb_tree_build_task *task = (llrb_tree_build_task *)arg;
+    assert(task != NULL);
+    task->root = llrb_tree_build(task->data, task->n, task->height, task->threads);
+    return NULL;
+}
+
+// Replaces the contents with n entries sorted by strictly increasing key in O(n), splitting the work over up to threads threads.
+void llrb_tree_build_from_sorted(llrb_tree *tree, const llrb_tree_data_type *data, unsigned long n, unsigned int threads)
+{
+    unsigned int height = 0;
+    assert(tree != NULL);
+    assert(n == 0 || data != NULL);
+    assert(llrb_tree_sorted(data, n));
+    llrb_tree_clear(tree);
+    while ((n + 1) >> (height + 1))
+        ++height;
+    tree->root = llrb_tree_build(data, n, height, threads);
+}
+
 static void llrb_tree_node_clear(llrb_tree_node *root)
 {
     if (root != NULL) {
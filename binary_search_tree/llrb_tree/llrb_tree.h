@@ -32,6 +32,7 @@ llrb_tree_node *llrb_tree_find_min(llrb_tree *);
 llrb_tree_node *llrb_tree_find_max(llrb_tree *);
 void llrb_tree_insert(llrb_tree *, const llrb_tree_data_type *);
 void llrb_tree_delete(llrb_tree *, const llrb_tree_key_type *);
+void llrb_tree_build_from_sorted(llrb_tree *, const llrb_tree_data_type *, unsigned long, unsigned int);
 void llrb_tree_clear(llrb_tree *);
 
 #endif // __LLRB_TREE_H__
\ No newline at end of file
@@ -1,13 +1,21 @@
 #include "llrb_tree.h"
+#include "../../benchmark/benchmark.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
+#define CHECK_BUILD_MAXN 20011
+
 int max(int, int);
 int calc_height(llrb_tree_node *);
 int count_red(llrb_tree_node *);
 int count_black(llrb_tree_node *);
 void inorder(llrb_tree_node *);
+void check(int, const char *);
+int check_node(const llrb_tree_node *);
+unsigned long check_in_order(const llrb_tree_node *, const int *, unsigned long, unsigned long);
+void check_tree(llrb_tree *, const int *, unsigned long);
+void check_build(void);
 
 inline int max(int a, int b)
 {
@@ -38,60 +46,208 @@ void inorder(llrb_tree_node *root)
     }
 }
 
-#define MAXN (1 << 22)
+void check(int ok, const char *what)
+{
+    if (!ok) {
+        fprintf(stderr, "llrb_tree: check failed: %s\n", what);
+        exit(EXIT_FAILURE);
+    }
+}
 
-int main(void)
+// Returns the black height of the subtree after checking that red links lean left, that no red link follows
+// another and that every path down has the same number of black nodes.
+int check_node(const llrb_tree_node *root)
 {
-    int i;
+    int left_height;
+    int right_height;
+    if (root == NULL)
+        return 1;
+    check(root->right == NULL || root->right->color == BLACK, "red links lean left");
+    check(root->color == BLACK || root->left == NULL || root->left->color == BLACK, "no two red links in a row");
+    left_height = check_node(root->left);
+    right_height = check_node(root->right);
+    check(left_height == right_height, "equal black heights");
+    return left_height + (root->color == BLACK);
+}
+
+unsigned long check_in_order(const llrb_tree_node *root, const int *ref, unsigned long n, unsigned long pos)
+{
+    if (root == NULL)
+        return pos;
+    pos = check_in_order(root->left, ref, n, pos);
+    check(pos < n && root->data.key == ref[pos] && root->data.val == ref[pos], "in-order keys match the reference");
+    return check_in_order(root->right, ref, n, pos + 1);
+}
+
+// Every stored key is even, so each odd key falls strictly between two entries.
+void check_tree(llrb_tree *tree, const int *ref, unsigned long n)
+{
+    unsigned long i;
     int key;
-    int cnt = 0;
-    clock_t begin, end;
-    llrb_tree *tree = (llrb_tree *)malloc(sizeof(llrb_tree));
+    check(tree->root == NULL || tree->root->color == BLACK, "black root");
+    check_node(tree->root);
+    check(check_in_order(tree->root, ref, n, 0) == n, "the tree holds every reference key");
+    check(llrb_tree_empty(tree) == (n == 0), "empty");
+    if (n == 0) {
+        check(llrb_tree_find_min(tree) == NULL && llrb_tree_find_max(tree) == NULL, "find_min/find_max on an empty tree");
+        return;
+    }
+    check(llrb_tree_find_min(tree)->data.key == ref[0], "find_min");
+    check(llrb_tree_find_max(tree)->data.key == ref[n - 1], "find_max");
+    for (i = 0; i < n; ++i) {
+        check(llrb_tree_find(tree, &ref[i]) != NULL, "find of a stored key");
+        key = ref[i] + 1;
+        check(llrb_tree_find(tree, &key) == NULL, "find of a missing key");
+    }
+}
+
+// Builds cover the empty, tiny, single-region and forked cases, each replacing the previous contents.
+void check_build(void)
+{
+    static const unsigned long size[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 100, 1000, 4097, CHECK_BUILD_MAXN};
+    static const unsigned int threads[] = {1, 4};
+    unsigned long i;
+    unsigned long j;
+    unsigned long half = CHECK_BUILD_MAXN >> 1;
+    int *ref = (int *)malloc(sizeof(int) * CHECK_BUILD_MAXN);
+    llrb_tree_data_type *data = (llrb_tree_data_type *)malloc(sizeof(llrb_tree_data_type) * CHECK_BUILD_MAXN);
+    llrb_tree local;
+    llrb_tree *t = &local;
+    check(ref != NULL && data != NULL, "allocation");
+
+    for (i = 0; i < CHECK_BUILD_MAXN; ++i) {
+        ref[i] = (int)(i << 1);
+        data[i] = (llrb_tree_data_type){ref[i], ref[i]};
+    }
+    llrb_tree_init(t);
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+        for (j = 0; j < sizeof(size) / sizeof(size[0]); ++j) {
+            llrb_tree_build_from_sorted(t, data, size[j], threads[i]);
+            check_tree(t, ref, size[j]);
+        }
+    }
+
+    // A built tree has to keep working under ordinary deletes and inserts.
+    for (i = 0; i < half; ++i)
+        llrb_tree_delete(t, &ref[i]);
+    check_tree(t, ref + half, CHECK_BUILD_MAXN - half);
+    for (i = 0; i < half; ++i)
+        llrb_tree_insert(t, &data[i]);
+    check_tree(t, ref, CHECK_BUILD_MAXN);
+    llrb_tree_clear(t);
+    free(ref);
+    free(data);
+}
+
+#define MAXN (1 << 22)
+
+llrb_tree *tree;
+int *keys;
+llrb_tree_data_type *sorted;
+
+void setup_empty(void *arg)
+{
+    (void)arg;
     llrb_tree_init(tree);
-    srand((unsigned int)time(NULL));
-    begin = clock();
+}
+
+void setup_full(void *arg)
+{
+    int i;
+    setup_empty(arg);
+    for (i = 0; i < MAXN; ++i)
+        llrb_tree_insert(tree, &(llrb_tree_data_type){keys[i], keys[i]});
+}
+
+void setup_deleted(void *arg)
+{
+    int i;
+    setup_full(arg);
+    for (i = 0; i < (MAXN >> 1); ++i)
+        llrb_tree_delete(tree, &keys[i]);
+}
+
+void teardown(void *arg)
+{
+    (void)arg;
+    llrb_tree_clear(tree);
+}
+
+void insert_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < MAXN; ++i) {
-        if (i & 1)
-            key = i;
-        else
-            key = rand() + i;
-        llrb_tree_insert(tree, &(llrb_tree_data_type){key, key});
+        benchmark_op_begin(rec);
+        llrb_tree_insert(tree, &(llrb_tree_data_type){keys[i], keys[i]});
+        benchmark_op_end(rec);
     }
-    end = clock();
-    printf("%lldms\n", end - begin);
-    printf("height: %d\n", calc_height(tree->root));
-    printf("red node: %d\n", count_red(tree->root));
-    printf("black node: %d\n", count_black(tree->root));
+    rec->checksum = (unsigned long long)calc_height(tree->root);
+}
 
-    srand((unsigned int)time(NULL));
-    begin = clock();
+void delete_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < (MAXN >> 1); ++i) {
-        if (i & 1)
-            key = i;
-        else
-            key = rand() + i;
-        llrb_tree_delete(tree, &key);
+        benchmark_op_begin(rec);
+        llrb_tree_delete(tree, &keys[i]);
+        benchmark_op_end(rec);
     }
-    end = clock();
-    printf("%lldms\n", end - begin);
-    printf("height: %d\n", calc_height(tree->root));
-    printf("red node: %d\n", count_red(tree->root));
-    printf("black node: %d\n", count_black(tree->root));
-    
-    begin = clock();
+    rec->checksum = (unsigned long long)calc_height(tree->root);
+}
+
+void find_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < MAXN; ++i) {
-        if (i & 1)
-            key = i;
-        else
-            key = rand() + i;
-        if (llrb_tree_find(tree, &key) != NULL)
-            ++cnt;
+        benchmark_op_begin(rec);
+        if (llrb_tree_find(tree, &keys[i]) != NULL)
+            ++rec->checksum;
+        benchmark_op_end(rec);
     }
-    end = clock();
-    printf("%lldms\n", end - begin);
-    printf("%d\n", cnt);
+}
+
+void build_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    (void)thread;
+    benchmark_op_begin(rec);
+    llrb_tree_build_from_sorted(tree, sorted, MAXN, *(unsigned int *)arg);
+    benchmark_op_end(rec);
+    rec->checksum = (unsigned long long)calc_height(tree->root);
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+    benchmark b;
+    tree = (llrb_tree *)malloc(sizeof(llrb_tree));
+    keys = (int *)malloc(sizeof(int) * MAXN);
+    sorted = (llrb_tree_data_type *)malloc(sizeof(llrb_tree_data_type) * MAXN);
+    if (tree == NULL || keys == NULL || sorted == NULL)
+        exit(EXIT_FAILURE);
+
+    srand((unsigned int)time(NULL));
+    for (i = 0; i < MAXN; ++i)
+        keys[i] = i & 1 ? i : rand() + i;
+    for (i = 0; i < MAXN; ++i)
+        sorted[i] = (llrb_tree_data_type){i, i};
+    check_build();
+
+    benchmark_init(&b, "llrb_tree", argc, argv);
+    benchmark_run(&b, &(benchmark_case){"insert", 1, setup_empty, insert_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"delete", 1, setup_full, delete_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"find", 1, setup_deleted, find_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"build", 1, setup_empty, build_run, teardown, &(unsigned int){1}});
+    benchmark_run(&b, &(benchmark_case){"build_parallel", 1, setup_empty, build_run, teardown, &(unsigned int){4}});
+    benchmark_finish(&b);
 
-    llrb_tree_clear(tree);
     free(tree);
+    free(keys);
+    free(sorted);
     return 0;
 }
\ No newline at end of file
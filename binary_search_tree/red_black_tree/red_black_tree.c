@@ -1,6 +1,20 @@
 #include "red_black_tree.h"
 #include <stdlib.h>
 #include <assert.h>
+#include <pthread.h>
+
+// Bulk build hands a subtree to a new thread only when it holds at least this many entries.
+#define RED_BLACK_TREE_MIN_REGION 4096
+
+typedef struct RedBlackTreeBuildTask
+{
+    const red_black_tree_data_type *data;
+    unsigned long n;
+    unsigned int depth;
+    unsigned int red_depth;
+    unsigned int threads;
+    red_black_tree_node *root;
+} red_black_tree_build_task;
 
 static int is_red_node(const red_black_tree_node *);
 static int is_black_node(const red_black_tree_node *);
@@ -15,9 +29,13 @@ static red_black_tree_node *create_red_black_tree_node(const red_black_tree_data
 static red_black_tree_node *red_black_tree_node_find(red_black_tree_node *, const red_black_tree_key_type *);
 static red_black_tree_node *find_min_node(red_black_tree_node *);
 static red_black_tree_node *find_max_node(red_black_tree_node *);
+static red_black_tree_node *red_black_tree_node_bound(red_black_tree_node *, const red_black_tree_key_type *, int);
 static void fix_up_insertion(red_black_tree *, red_black_tree_node *);
 static void fix_up_deletion(red_black_tree *, red_black_tree_node *);
 static void red_black_tree_node_clear(red_black_tree_node *);
+static int red_black_tree_sorted(const red_black_tree_data_type *, unsigned long);
+static red_black_tree_node *red_black_tree_build(const red_black_tree_data_type *, unsigned long, unsigned int, unsigned int, unsigned int);
+static void *red_black_tree_build_worker(void *);
 
 static inline int is_red_node(const red_black_tree_node *root)
 {
@@ -189,6 +207,76 @@ inline red_black_tree_node *red_black_tree_find_max(red_black_tree *tree)
     return find_max_node(tree->root);
 }
 
+// Steps through the keys in order along the parent pointers; returns NULL past either end.
+red_black_tree_node *red_black_tree_successor(red_black_tree_node *node)
+{
+    assert(node != NULL);
+    if (node->right != NULL)
+        return find_min_node(node->right);
+    while (node->parent != NULL && node->parent->right == node)
+        node = node->parent;
+    return node->parent;
+}
+
+red_black_tree_node *red_black_tree_predecessor(red_black_tree_node *node)
+{
+    assert(node != NULL);
+    if (node->left != NULL)
+        return find_max_node(node->left);
+    while (node->parent != NULL && node->parent->left == node)
+        node = node->parent;
+    return node->parent;
+}
+
+// Returns the first node whose key is not less than the key, or greater than it when strict is set.
+static red_black_tree_node *red_black_tree_node_bound(red_black_tree_node *root, const red_black_tree_key_type *key_ptr, int strict)
+{
+    int cmp;
+    red_black_tree_node *ret = NULL;
+    assert(key_ptr != NULL);
+    while (root != NULL) {
+        cmp = red_black_tree_key_compare(&root->data.key, key_ptr);
+        if (cmp > 0 || (cmp == 0 && !strict)) {
+            ret = root;
+            root = root->left;
+        } else {
+            root = root->right;
+        }
+    }
+    return ret;
+}
+
+inline red_black_tree_node *red_black_tree_lower_bound(red_black_tree *tree, const red_black_tree_key_type *key_ptr)
+{
+    assert(tree != NULL);
+    assert(key_ptr != NULL);
+    return red_black_tree_node_bound(tree->root, key_ptr, 0);
+}
+
+inline red_black_tree_node *red_black_tree_upper_bound(red_black_tree *tree, const red_black_tree_key_type *key_ptr)
+{
+    assert(tree != NULL);
+    assert(key_ptr != NULL);
+    return red_black_tree_node_bound(tree->root, key_ptr, 1);
+}
+
+// Visits the keys in [low, high) in ascending order and returns their number.
+// The walk follows successor links, so it takes O(log n + k) time and no extra memory.
+unsigned long red_black_tree_for_each_range(red_black_tree *tree, const red_black_tree_key_type *low, const red_black_tree_key_type *high, red_black_tree_visit_func_type func, void *arg)
+{
+    unsigned long ret = 0;
+    red_black_tree_node *node = NULL;
+    assert(tree != NULL);
+    assert(low != NULL);
+    assert(high != NULL);
+    assert(func != NULL);
+    for (node = red_black_tree_node_bound(tree->root, low, 0); node != NULL && red_black_tree_key_compare(&node->data.key, high) < 0; node = red_black_tree_successor(node)) {
+        func(&node->data, arg);
+        ++ret;
+    }
+    return ret;
+}
+
 void red_black_tree_insert(red_black_tree *tree, const red_black_tree_data_type *data_ptr)
 {
     int cmp;
@@ -286,8 +374,10 @@ void red_black_tree_delete(red_black_tree *tree, const red_black_tree_key_type *
     } else if (delete_node->parent != NULL) {
         if (is_black_node(delete_node))
             fix_up_deletion(tree, delete_node);
-        if (delete_node->parent != NULL)
-            delete_node->parent->left = delete_node->parent->right = NULL;
+        if (delete_node->parent->left == delete_node)
+            delete_node->parent->left = NULL;
+        else
+            delete_node->parent->right = NULL;
     } else {
         tree->root = NULL;
     }
@@ -347,6 +437,70 @@ static void fix_up_deletion(red_black_tree *tree, red_black_tree_node *root)
     root->color = BLACK;
 }
 
+static inline int red_black_tree_sorted(const red_black_tree_data_type *data, unsigned long n)
+{
+    unsigned long i;
+    for (i = 1; i < n; ++i) {
+        if (red_black_tree_data_compare(&data[i - 1], &data[i]) >= 0)
+            return 0;
+    }
+    return 1;
+}
+
+// Splitting at the middle fills every level but the deepest one, which sits at red_depth.
+// Coloring only that level red gives every path the same number of black nodes.
+static red_black_tree_node *red_black_tree_build(const red_black_tree_data_type *data, unsigned long n, unsigned int depth, unsigned int red_depth, unsigned int threads)
+{
+    unsigned long mid;
+    pthread_t thread;
+    red_black_tree_build_task task;
+    red_black_tree_node *root = NULL;
+    if (n == 0)
+        return NULL;
+    mid = n >> 1;
+    root = create_red_black_tree_node(&data[mid]);
+    root->color = depth == red_depth && depth > 0 ? RED : BLACK;
+    task.data = data;
+    task.n = mid;
+    task.depth = depth + 1;
+    task.red_depth = red_depth;
+    task.threads = threads >> 1;
+    if (threads > 1 && n >= RED_BLACK_TREE_MIN_REGION && pthread_create(&thread, NULL, red_black_tree_build_worker, &task) == 0) {
+        root->right = red_black_tree_build(data + mid + 1, n - mid - 1, depth + 1, red_depth, threads - task.threads);
+        pthread_join(thread, NULL);
+        root->left = task.root;
+    } else {
+        root->left = red_black_tree_build(data, mid, depth + 1, red_depth, 1);
+        root->right = red_black_tree_build(data + mid + 1, n - mid - 1, depth + 1, red_depth, 1);
+    }
+    if (root->left != NULL)
+        root->left->parent = root;
+    if (root->right != NULL)
+        root->right->parent = root;
+    return root;
+}
+
+static void *red_black_tree_build_worker(void *arg)
+{
+    red_black_tree_build_task *task = (red_black_tree_build_task *)arg;
+    assert(task != NULL);
+    task->root = red_black_tree_build(task->data, task->n, task->depth, task->red_depth, task->threads);
+    return NULL;
+}
+
+// Replaces the contents with n entries sorted by strictly increasing key in O(n), splitting the work over up to threads threads.
+void red_black_tree_build_from_sorted(red_black_tree *tree, const red_black_tree_data_type *data, unsigned long n, unsigned int threads)
+{
+    unsigned int red_depth = 0;
+    assert(tree != NULL);
+    assert(n == 0 || data != NULL);
+    assert(red_black_tree_sorted(data, n));
+    red_black_tree_clear(tree);
+    while (n >> (red_depth + 1))
+        ++red_depth;
+    tree->root = red_black_tree_build(data, n, 0, red_depth, threads);
+}
+
 static void red_black_tree_node_clear(red_black_tree_node *root)
 {
     if (root != NULL) {
@@ -25,14 +25,21 @@ typedef struct RedBlackTree
 {
     red_black_tree_node *root;
 } red_black_tree;
+typedef void (*red_black_tree_visit_func_type)(red_black_tree_data_type *, void *);
 
 void red_black_tree_init(red_black_tree *);
 int red_black_tree_empty(const red_black_tree *);
 red_black_tree_node *red_black_tree_find(red_black_tree *, const red_black_tree_key_type *);
 red_black_tree_node *red_black_tree_find_min(red_black_tree *);
 red_black_tree_node *red_black_tree_find_max(red_black_tree *);
+red_black_tree_node *red_black_tree_successor(red_black_tree_node *);
+red_black_tree_node *red_black_tree_predecessor(red_black_tree_node *);
+red_black_tree_node *red_black_tree_lower_bound(red_black_tree *, const red_black_tree_key_type *);
+red_black_tree_node *red_black_tree_upper_bound(red_black_tree *, const red_black_tree_key_type *);
+unsigned long red_black_tree_for_each_range(red_black_tree *, const red_black_tree_key_type *, const red_black_tree_key_type *, red_black_tree_visit_func_type, void *);
 void red_black_tree_insert(red_black_tree *, const red_black_tree_data_type *);
 void red_black_tree_delete(red_black_tree *, const red_black_tree_key_type *);
+void red_black_tree_build_from_sorted(red_black_tree *, const red_black_tree_data_type *, unsigned long, unsigned int);
 void red_black_tree_clear(red_black_tree *);
 
 #endif // __RED_BLACK_TREE_H__
\ No newline at end of file
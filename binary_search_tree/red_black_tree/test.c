@@ -1,8 +1,22 @@
 #include "red_black_tree.h"
+#include "../../benchmark/benchmark.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <time.h>
 
+#define CHECKN 3001
+#define CHECK_BUILD_MAXN 20011
+
+// Walks a range scan along the sorted reference keys in [ref[pos], ref[end]).
+typedef struct CheckScan
+{
+    const int *ref;
+    unsigned long pos;
+    unsigned long end;
+    int ok;
+} check_scan;
+
 void preorder(red_black_tree_node *);
 void inorder(red_black_tree_node *);
 void postorder(red_black_tree_node *);
@@ -11,6 +25,17 @@ int count_red_node(red_black_tree_node *);
 int count_black_node(red_black_tree_node *);
 int max(int, int);
 int calc_height(red_black_tree_node *);
+void add_key(red_black_tree_data_type *, void *);
+void check(int, const char *);
+void check_visit(red_black_tree_data_type *, void *);
+unsigned long check_lower_bound(const int *, unsigned long, int);
+unsigned long check_collect(const char *, int *);
+int check_key_is(const red_black_tree_node *, const int *, unsigned long, unsigned long);
+void check_range(red_black_tree *, const int *, unsigned long, int, int);
+int check_node(const red_black_tree_node *, const red_black_tree_node *);
+void check_ordered(red_black_tree *, const int *, unsigned long);
+void check_ordered_queries(void);
+void check_build(void);
 
 void preorder(red_black_tree_node *root)
 {
@@ -71,61 +96,339 @@ int calc_height(red_black_tree_node *root)
     return root != NULL ? 1 + max(calc_height(root->left), calc_height(root->right)) : 0;
 }
 
-#define MAXN (1 << 22)
+void add_key(red_black_tree_data_type *data, void *arg)
+{
+    *(unsigned long long *)arg += (unsigned int)data->key;
+}
+
+void check(int ok, const char *what)
+{
+    if (!ok) {
+        fprintf(stderr, "red_black_tree: check failed: %s\n", what);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void check_visit(red_black_tree_data_type *data, void *arg)
+{
+    check_scan *scan = (check_scan *)arg;
+    if (scan->pos >= scan->end || data->key != scan->ref[scan->pos] || data->val != data->key)
+        scan->ok = 0;
+    ++scan->pos;
+}
 
-int main(void)
+unsigned long check_lower_bound(const int *ref, unsigned long n, int key)
+{
+    unsigned long low = 0;
+    unsigned long high = n;
+    unsigned long mid;
+    while (low < high) {
+        mid = low + ((high - low) >> 1);
+        if (ref[mid] < key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+unsigned long check_collect(const char *present, int *ref)
 {
     int i;
+    unsigned long n = 0;
+    for (i = 0; i < CHECKN; ++i) {
+        if (present[i])
+            ref[n++] = i << 1;
+    }
+    return n;
+}
+
+// A node is expected to hold ref[i], or to be NULL when i is past the end.
+int check_key_is(const red_black_tree_node *node, const int *ref, unsigned long n, unsigned long i)
+{
+    return i < n ? node != NULL && node->data.key == ref[i] : node == NULL;
+}
+
+void check_range(red_black_tree *tree, const int *ref, unsigned long n, int low, int high)
+{
+    unsigned long ret;
+    check_scan scan;
+    scan.ref = ref;
+    scan.pos = check_lower_bound(ref, n, low);
+    scan.end = check_lower_bound(ref, n, high);
+    scan.ok = 1;
+    ret = red_black_tree_for_each_range(tree, &low, &high, check_visit, &scan);
+    check(scan.ok && scan.pos == scan.end, "for_each_range visits [low, high) in order");
+    check(ret == scan.end - check_lower_bound(ref, n, low), "for_each_range returns the visit count");
+}
+
+// Returns the black height of the subtree after checking the parent links, that no red node has a red child
+// and that every path down has the same number of black nodes.
+int check_node(const red_black_tree_node *root, const red_black_tree_node *parent)
+{
+    int left_height;
+    int right_height;
+    if (root == NULL)
+        return 1;
+    check(root->parent == parent, "parent links");
+    check(root->color == BLACK || (root->parent != NULL && root->parent->color == BLACK), "no red node has a red parent");
+    left_height = check_node(root->left, root);
+    right_height = check_node(root->right, root);
+    check(left_height == right_height, "equal black heights");
+    return left_height + (root->color == BLACK);
+}
+
+// Every stored key is even, so each odd key falls strictly between two entries.
+void check_ordered(red_black_tree *tree, const int *ref, unsigned long n)
+{
+    unsigned long i;
+    unsigned long j;
+    int key;
+    red_black_tree_node *node = NULL;
+    check(tree->root == NULL || tree->root->color == BLACK, "black root");
+    check_node(tree->root, NULL);
+    node = red_black_tree_find_min(tree);
+    for (i = 0; node != NULL; ++i, node = red_black_tree_successor(node))
+        check(i < n && node->data.key == ref[i], "successor steps through the keys in order");
+    check(i == n, "successor reaches every key");
+    node = red_black_tree_find_max(tree);
+    for (i = n; node != NULL; --i, node = red_black_tree_predecessor(node))
+        check(i > 0 && node->data.key == ref[i - 1], "predecessor steps through the keys in reverse");
+    check(i == 0, "predecessor reaches every key");
+    if (n == 0) {
+        key = 0;
+        check(red_black_tree_lower_bound(tree, &key) == NULL && red_black_tree_upper_bound(tree, &key) == NULL, "bounds on an empty tree");
+        check_range(tree, ref, 0, INT_MIN, INT_MAX);
+        return;
+    }
+    key = ref[0] - 1;
+    check(check_key_is(red_black_tree_lower_bound(tree, &key), ref, n, 0), "lower_bound below the minimum");
+    check(check_key_is(red_black_tree_upper_bound(tree, &key), ref, n, 0), "upper_bound below the minimum");
+    for (i = 0; i < n; ++i) {
+        check(check_key_is(red_black_tree_lower_bound(tree, &ref[i]), ref, n, i), "lower_bound of a stored key");
+        check(check_key_is(red_black_tree_upper_bound(tree, &ref[i]), ref, n, i + 1), "upper_bound of a stored key");
+        key = ref[i] + 1;
+        check(check_key_is(red_black_tree_lower_bound(tree, &key), ref, n, i + 1), "lower_bound of a missing key");
+        check(check_key_is(red_black_tree_upper_bound(tree, &key), ref, n, i + 1), "upper_bound of a missing key");
+    }
+    check_range(tree, ref, n, INT_MIN, INT_MAX);
+    for (i = 0; i < n; i += 7) {
+        check_range(tree, ref, n, ref[i], ref[i]);
+        check_range(tree, ref, n, ref[i] - 1, ref[i] + 1);
+        for (j = i + 1; j < n && j <= i + 40; j += 13) {
+            // high lands exactly on a stored key, which must not be visited.
+            check_range(tree, ref, n, ref[i], ref[j]);
+            check_range(tree, ref, n, ref[i] + 1, ref[j] + 1);
+        }
+    }
+    check_range(tree, ref, n, ref[n - 1], INT_MAX);
+}
+
+void check_ordered_queries(void)
+{
+    int i;
+    int j;
     int key;
-    int cnt = 0;
-    clock_t begin;
-    clock_t end;
-    red_black_tree_node *tmp = NULL;
-    red_black_tree *tree = (red_black_tree *)malloc(sizeof(red_black_tree));
+    unsigned long n;
+    int order[CHECKN];
+    int ref[CHECKN];
+    char present[CHECKN];
+    red_black_tree local;
+    red_black_tree *t = &local;
 
+    for (i = 0; i < CHECKN; ++i)
+        order[i] = i;
+    for (i = CHECKN - 1; i > 0; --i) {
+        j = rand() % (i + 1);
+        key = order[i];
+        order[i] = order[j];
+        order[j] = key;
+    }
+    red_black_tree_init(t);
+    check_ordered(t, ref, 0);
+    for (i = 0; i < CHECKN; ++i) {
+        key = order[i] << 1;
+        red_black_tree_insert(t, &(red_black_tree_data_type){key, key});
+        present[order[i]] = 1;
+    }
+    n = check_collect(present, ref);
+    check_ordered(t, ref, n);
+
+    for (i = 0; i < CHECKN; ++i) {
+        if (i % 3 != 0) {
+            key = order[i] << 1;
+            red_black_tree_delete(t, &key);
+            present[order[i]] = 0;
+        }
+    }
+    n = check_collect(present, ref);
+    check_ordered(t, ref, n);
+    red_black_tree_clear(t);
+}
+
+// Builds cover the empty, tiny, single-region and forked cases, each replacing the previous contents.
+void check_build(void)
+{
+    static const unsigned long size[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 100, 1000, 4097, CHECK_BUILD_MAXN};
+    static const unsigned int threads[] = {1, 4};
+    unsigned long i;
+    unsigned long j;
+    unsigned long half = CHECK_BUILD_MAXN >> 1;
+    int *ref = (int *)malloc(sizeof(int) * CHECK_BUILD_MAXN);
+    red_black_tree_data_type *data = (red_black_tree_data_type *)malloc(sizeof(red_black_tree_data_type) * CHECK_BUILD_MAXN);
+    red_black_tree local;
+    red_black_tree *t = &local;
+    check(ref != NULL && data != NULL, "allocation");
+
+    for (i = 0; i < CHECK_BUILD_MAXN; ++i) {
+        ref[i] = (int)(i << 1);
+        data[i] = (red_black_tree_data_type){ref[i], ref[i]};
+    }
+    red_black_tree_init(t);
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+        for (j = 0; j < sizeof(size) / sizeof(size[0]); ++j) {
+            red_black_tree_build_from_sorted(t, data, size[j], threads[i]);
+            check_ordered(t, ref, size[j]);
+        }
+    }
+
+    // A built tree has to keep working under ordinary deletes and inserts.
+    for (i = 0; i < half; ++i)
+        red_black_tree_delete(t, &ref[i]);
+    check_ordered(t, ref + half, CHECK_BUILD_MAXN - half);
+    for (i = 0; i < half; ++i)
+        red_black_tree_insert(t, &data[i]);
+    check_ordered(t, ref, CHECK_BUILD_MAXN);
+    red_black_tree_clear(t);
+    free(ref);
+    free(data);
+}
+
+#define MAXN (1 << 22)
+
+red_black_tree *tree;
+int *keys;
+red_black_tree_data_type *sorted;
+
+void setup_empty(void *arg)
+{
+    (void)arg;
     red_black_tree_init(tree);
-    srand((unsigned int)time(NULL));
+}
 
-    begin = clock();
+void setup_full(void *arg)
+{
+    int i;
+    setup_empty(arg);
+    for (i = 0; i < MAXN; ++i)
+        red_black_tree_insert(tree, &(red_black_tree_data_type){keys[i], keys[i]});
+}
+
+void setup_deleted(void *arg)
+{
+    int i;
+    setup_full(arg);
+    for (i = 0; i < (MAXN >> 1); ++i)
+        red_black_tree_delete(tree, &keys[i]);
+}
+
+void teardown(void *arg)
+{
+    (void)arg;
+    red_black_tree_clear(tree);
+}
+
+void insert_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < MAXN; ++i) {
-        if (i & 1)
-            key = i;
-        else
-            key = rand() + i;
-        red_black_tree_insert(tree, &(red_black_tree_data_type){key, key});
+        benchmark_op_begin(rec);
+        red_black_tree_insert(tree, &(red_black_tree_data_type){keys[i], keys[i]});
+        benchmark_op_end(rec);
     }
-    end = clock();
-    printf("%lldms\n", end - begin);
-    printf("red node: %d black node: %d height: %d\n", count_red_node(tree->root), count_black_node(tree->root), calc_height(tree->root));
+    rec->checksum = (unsigned long long)calc_height(tree->root);
+}
 
-    srand((unsigned int)time(NULL));
-    begin = clock();
+void delete_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < (MAXN >> 1); ++i) {
-        if (i & 1)
-            key = i;
-        else
-            key = rand() + i;
-        red_black_tree_delete(tree, &key);
+        benchmark_op_begin(rec);
+        red_black_tree_delete(tree, &keys[i]);
+        benchmark_op_end(rec);
     }
-    end = clock();
-    printf("%lldms\n", end - begin);
-    printf("red node: %d black node: %d height: %d\n", count_red_node(tree->root), count_black_node(tree->root), calc_height(tree->root));
+    rec->checksum = (unsigned long long)calc_height(tree->root);
+}
 
-    srand((unsigned int)time(NULL));
-    begin = clock();
+void find_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < MAXN; ++i) {
-        if (i & 1)
-            key = i;
-        else
-            key = rand() + i;
-        if (red_black_tree_find(tree, &key) != NULL)
-            ++cnt;
-    }
-    end = clock();
-    printf("%lldms\n", end - begin);
-    printf("%d\n", cnt);
-   
-    red_black_tree_clear(tree);
+        benchmark_op_begin(rec);
+        if (red_black_tree_find(tree, &keys[i]) != NULL)
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+void build_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    (void)thread;
+    benchmark_op_begin(rec);
+    red_black_tree_build_from_sorted(tree, sorted, MAXN, *(unsigned int *)arg);
+    benchmark_op_end(rec);
+    rec->checksum = (unsigned long long)calc_height(tree->root);
+}
+
+void scan_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int high;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < (MAXN >> 4); ++i) {
+        high = keys[i] > INT_MAX - (1 << 16) ? INT_MAX : keys[i] + (1 << 16);
+        benchmark_op_begin(rec);
+        red_black_tree_for_each_range(tree, &keys[i], &high, add_key, &rec->checksum);
+        benchmark_op_end(rec);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+    benchmark b;
+    tree = (red_black_tree *)malloc(sizeof(red_black_tree));
+    keys = (int *)malloc(sizeof(int) * MAXN);
+    sorted = (red_black_tree_data_type *)malloc(sizeof(red_black_tree_data_type) * MAXN);
+    if (tree == NULL || keys == NULL || sorted == NULL)
+        exit(EXIT_FAILURE);
+
+    srand((unsigned int)time(NULL));
+    for (i = 0; i < MAXN; ++i)
+        keys[i] = i & 1 ? i : rand() + i;
+    for (i = 0; i < MAXN; ++i)
+        sorted[i] = (red_black_tree_data_type){i, i};
+    check_ordered_queries();
+    check_build();
+
+    benchmark_init(&b, "red_black_tree", argc, argv);
+    benchmark_run(&b, &(benchmark_case){"insert", 1, setup_empty, insert_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"delete", 1, setup_full, delete_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"find", 1, setup_deleted, find_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"build", 1, setup_empty, build_run, teardown, &(unsigned int){1}});
+    benchmark_run(&b, &(benchmark_case){"build_parallel", 1, setup_empty, build_run, teardown, &(unsigned int){4}});
+    benchmark_run(&b, &(benchmark_case){"scan", 1, setup_deleted, scan_run, teardown, NULL});
+    benchmark_finish(&b);
+
     free(tree);
+    free(keys);
+    free(sorted);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "blocked_bloom_filter.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define BLOCKED_BLOOM_FILTER_BLOCK_BITS (BLOCKED_BLOOM_FILTER_BLOCK_WORDS * 32)
+
+// Odd multipliers turn the low half of the hash into one bit index per word.
+static const unsigned int blocked_bloom_filter_salt[BLOCKED_BLOOM_FILTER_BLOCK_WORDS] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+static blocked_bloom_filter_hash_type blocked_bloom_filter_mix(blocked_bloom_filter_hash_type);
+static blocked_bloom_filter_hash_type blocked_bloom_filter_random_seed(const blocked_bloom_filter *);
+static blocked_bloom_filter_hash_type blocked_bloom_filter_get_hash(const blocked_bloom_filter *, const blocked_bloom_filter_key_type *);
+static blocked_bloom_filter_block *blocked_bloom_filter_get_block(const blocked_bloom_filter *, blocked_bloom_filter_hash_type);
+#if defined(__AVX2__)
+static __m256i blocked_bloom_filter_get_mask(blocked_bloom_filter_hash_type);
+#else
+static unsigned int blocked_bloom_filter_get_bit(blocked_bloom_filter_hash_type, unsigned int);
+#endif
+
+static inline blocked_bloom_filter_hash_type blocked_bloom_filter_mix(blocked_bloom_filter_hash_type hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static blocked_bloom_filter_hash_type blocked_bloom_filter_random_seed(const blocked_bloom_filter *bf)
+{
+    static blocked_bloom_filter_hash_type counter = 0;
+    blocked_bloom_filter_hash_type ret = (blocked_bloom_filter_hash_type)time(NULL);
+    ret ^= blocked_bloom_filter_mix((blocked_bloom_filter_hash_type)(size_t)bf + ++counter * 0x9e3779b97f4a7c15ULL);
+    ret ^= blocked_bloom_filter_mix((blocked_bloom_filter_hash_type)clock());
+    return blocked_bloom_filter_mix(ret);
+}
+
+blocked_bloom_filter_hash_type blocked_bloom_filter_default_hash(const blocked_bloom_filter_key_type *key_ptr, blocked_bloom_filter_hash_type seed)
+{
+    assert(key_ptr != NULL);
+    return blocked_bloom_filter_mix((blocked_bloom_filter_hash_type)(unsigned int)*key_ptr ^ seed);
+}
+
+inline void blocked_bloom_filter_init(blocked_bloom_filter *bf, unsigned long expected_size, double bits_per_key)
+{
+    blocked_bloom_filter_init_with_hash(bf, expected_size, bits_per_key, blocked_bloom_filter_default_hash);
+}
+
+void blocked_bloom_filter_init_with_hash(blocked_bloom_filter *bf, unsigned long expected_size, double bits_per_key, blocked_bloom_filter_hash_func_type hash_func)
+{
+    assert(bf != NULL);
+    assert(bits_per_key > 0);
+    bf->block_count = (unsigned long)((double)expected_size * bits_per_key / BLOCKED_BLOOM_FILTER_BLOCK_BITS) + 1;
+    bf->memory = malloc(bf->block_count * sizeof(blocked_bloom_filter_block) + BLOCKED_BLOOM_FILTER_CACHE_LINE - 1);
+    assert(bf->memory != NULL);
+    bf->block = (blocked_bloom_filter_block *)(((size_t)bf->memory + BLOCKED_BLOOM_FILTER_CACHE_LINE - 1) & ~(size_t)(BLOCKED_BLOOM_FILTER_CACHE_LINE - 1));
+    memset(bf->block, 0, bf->block_count * sizeof(blocked_bloom_filter_block));
+    bf->size = 0;
+    bf->hash_func = hash_func != NULL ? hash_func : blocked_bloom_filter_default_hash;
+    bf->seed = blocked_bloom_filter_random_seed(bf);
+}
+
+inline unsigned long blocked_bloom_filter_size(const blocked_bloom_filter *bf)
+{
+    assert(bf != NULL);
+    return bf->size;
+}
+
+inline unsigned long blocked_bloom_filter_bits(const blocked_bloom_filter *bf)
+{
+    assert(bf != NULL);
+    return bf->block_count * BLOCKED_BLOOM_FILTER_BLOCK_BITS;
+}
+
+inline int blocked_bloom_filter_empty(const blocked_bloom_filter *bf)
+{
+    assert(bf != NULL);
+    return bf->size == 0;
+}
+
+static inline blocked_bloom_filter_hash_type blocked_bloom_filter_get_hash(const blocked_bloom_filter *bf, const blocked_bloom_filter_key_type *key_ptr)
+{
+    assert(bf != NULL);
+    assert(key_ptr != NULL);
+    return bf->hash_func(key_ptr, bf->seed);
+}
+
+static inline blocked_bloom_filter_block *blocked_bloom_filter_get_block(const blocked_bloom_filter *bf, blocked_bloom_filter_hash_type hash)
+{
+    assert(bf != NULL);
+    return &bf->block[(unsigned long)(((hash >> 32) * bf->block_count) >> 32)];
+}
+
+#if defined(__AVX2__)
+static inline __m256i blocked_bloom_filter_get_mask(blocked_bloom_filter_hash_type hash)
+{
+    __m256i bits = _mm256_mullo_epi32(_mm256_set1_epi32((int)(unsigned int)hash), _mm256_loadu_si256((const __m256i *)blocked_bloom_filter_salt));
+    return _mm256_sllv_epi32(_mm256_set1_epi32(1), _mm256_srli_epi32(bits, 27));
+}
+#else
+static inline unsigned int blocked_bloom_filter_get_bit(blocked_bloom_filter_hash_type hash, unsigned int i)
+{
+    return 1u << (((unsigned int)hash * blocked_bloom_filter_salt[i]) >> 27);
+}
+#endif
+
+void blocked_bloom_filter_insert(blocked_bloom_filter *bf, const blocked_bloom_filter_key_type *key_ptr)
+{
+    blocked_bloom_filter_hash_type hash;
+    blocked_bloom_filter_block *block = NULL;
+#if !defined(__AVX2__)
+    unsigned int i;
+#endif
+    assert(bf != NULL);
+    assert(key_ptr != NULL);
+    hash = blocked_bloom_filter_get_hash(bf, key_ptr);
+    block = blocked_bloom_filter_get_block(bf, hash);
+#if defined(__AVX2__)
+    _mm256_store_si256((__m256i *)block->word, _mm256_or_si256(_mm256_load_si256((const __m256i *)block->word), blocked_bloom_filter_get_mask(hash)));
+#else
+    for (i = 0; i < BLOCKED_BLOOM_FILTER_BLOCK_WORDS; ++i)
+        block->word[i] |= blocked_bloom_filter_get_bit(hash, i);
+#endif
+    ++bf->size;
+}
+
+int blocked_bloom_filter_contains(const blocked_bloom_filter *bf, const blocked_bloom_filter_key_type *key_ptr)
+{
+    blocked_bloom_filter_hash_type hash;
+    const blocked_bloom_filter_block *block = NULL;
+#if !defined(__AVX2__)
+    unsigned int i;
+#endif
+    assert(bf != NULL);
+    assert(key_ptr != NULL);
+    hash = blocked_bloom_filter_get_hash(bf, key_ptr);
+    block = blocked_bloom_filter_get_block(bf, hash);
+#if defined(__AVX2__)
+    return _mm256_testc_si256(_mm256_load_si256((const __m256i *)block->word), blocked_bloom_filter_get_mask(hash));
+#else
+    for (i = 0; i < BLOCKED_BLOOM_FILTER_BLOCK_WORDS; ++i) {
+        if (!(block->word[i] & blocked_bloom_filter_get_bit(hash, i)))
+            return 0;
+    }
+    return 1;
+#endif
+}
+
+inline void blocked_bloom_filter_clear(blocked_bloom_filter *bf)
+{
+    assert(bf != NULL);
+    memset(bf->block, 0, bf->block_count * sizeof(blocked_bloom_filter_block));
+    bf->size = 0;
+}
+
+inline void blocked_bloom_filter_destroy(blocked_bloom_filter *bf)
+{
+    assert(bf != NULL);
+    free(bf->memory);
+    bf->memory = NULL;
+    bf->block = NULL;
+    bf->block_count = bf->size = 0;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef __BLOCKED_BLOOM_FILTER_H__
+#define __BLOCKED_BLOOM_FILTER_H__
+
+// Each key sets one bit in every word of a single block, so an insert or a lookup touches one cache line.
+// A zero from blocked_bloom_filter_contains is a definite miss; put it in front of a table or tree lookup to skip the probe.
+#define BLOCKED_BLOOM_FILTER_CACHE_LINE 64
+#define BLOCKED_BLOOM_FILTER_BLOCK_WORDS 8
+
+typedef int blocked_bloom_filter_key_type;
+typedef unsigned long long blocked_bloom_filter_hash_type;
+typedef blocked_bloom_filter_hash_type (*blocked_bloom_filter_hash_func_type)(const blocked_bloom_filter_key_type *, blocked_bloom_filter_hash_type);
+typedef struct BlockedBloomFilterBlock
+{
+    unsigned int word[BLOCKED_BLOOM_FILTER_BLOCK_WORDS];
+} blocked_bloom_filter_block;
+typedef struct BlockedBloomFilter
+{
+    blocked_bloom_filter_block *block;
+    void *memory;
+    unsigned long block_count;
+    unsigned long size;
+    blocked_bloom_filter_hash_func_type hash_func;
+    blocked_bloom_filter_hash_type seed;
+} blocked_bloom_filter;
+
+blocked_bloom_filter_hash_type blocked_bloom_filter_default_hash(const blocked_bloom_filter_key_type *, blocked_bloom_filter_hash_type);
+void blocked_bloom_filter_init(blocked_bloom_filter *, unsigned long, double);
+void blocked_bloom_filter_init_with_hash(blocked_bloom_filter *, unsigned long, double, blocked_bloom_filter_hash_func_type);
+unsigned long blocked_bloom_filter_size(const blocked_bloom_filter *);
+unsigned long blocked_bloom_filter_bits(const blocked_bloom_filter *);
+int blocked_bloom_filter_empty(const blocked_bloom_filter *);
+void blocked_bloom_filter_insert(blocked_bloom_filter *, const blocked_bloom_filter_key_type *);
+int blocked_bloom_filter_contains(const blocked_bloom_filter *, const blocked_bloom_filter_key_type *);
+void blocked_bloom_filter_clear(blocked_bloom_filter *);
+void blocked_bloom_filter_destroy(blocked_bloom_filter *);
+
+#endif // __BLOCKED_BLOOM_FILTER_H__
\ No newline at end of file
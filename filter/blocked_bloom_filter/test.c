@@ -0,0 +1,93 @@
+#include "blocked_bloom_filter.h"
+#include "../../benchmark/benchmark.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MAXN (1 << 24)
+#define BITS_PER_KEY 10
+
+blocked_bloom_filter *bf;
+
+void setup_empty(void *arg)
+{
+    (void)arg;
+    blocked_bloom_filter_init(bf, MAXN, BITS_PER_KEY);
+}
+
+void setup_full(void *arg)
+{
+    int i;
+    int key;
+    setup_empty(arg);
+    for (i = 0; i < MAXN; ++i) {
+        key = i << 1;
+        blocked_bloom_filter_insert(bf, &key);
+    }
+}
+
+void teardown(void *arg)
+{
+    (void)arg;
+    blocked_bloom_filter_destroy(bf);
+}
+
+void insert_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int key;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        key = i << 1;
+        benchmark_op_begin(rec);
+        blocked_bloom_filter_insert(bf, &key);
+        benchmark_op_end(rec);
+    }
+    rec->checksum = blocked_bloom_filter_size(bf);
+}
+
+void contains_hit_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int key;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        key = i << 1;
+        benchmark_op_begin(rec);
+        if (blocked_bloom_filter_contains(bf, &key))
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+void contains_miss_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int key;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        key = i << 1 | 1;
+        benchmark_op_begin(rec);
+        if (blocked_bloom_filter_contains(bf, &key))
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    benchmark b;
+    bf = (blocked_bloom_filter *)malloc(sizeof(blocked_bloom_filter));
+
+    benchmark_init(&b, "blocked_bloom_filter", argc, argv);
+    benchmark_run(&b, &(benchmark_case){"insert", 1, setup_empty, insert_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"contains_hit", 1, setup_full, contains_hit_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"contains_miss", 1, setup_full, contains_miss_run, teardown, NULL});
+    benchmark_finish(&b);
+
+    free(bf);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "counting_bloom_filter.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#define COUNTING_BLOOM_FILTER_BLOCK_BITS (COUNTING_BLOOM_FILTER_BLOCK_WORDS * 64)
+#define COUNTING_BLOOM_FILTER_COUNTER_MAX 15ULL
+#define COUNTING_BLOOM_FILTER_COUNTER_BITS 4
+#define COUNTING_BLOOM_FILTER_MAX_HASHES 8
+#define COUNTING_BLOOM_FILTER_LN2 0.6931471805599453
+
+// Odd multipliers turn the low half of the hash into one 7-bit counter index per hash.
+static const unsigned int counting_bloom_filter_salt[COUNTING_BLOOM_FILTER_MAX_HASHES] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+static counting_bloom_filter_hash_type counting_bloom_filter_mix(counting_bloom_filter_hash_type);
+static counting_bloom_filter_hash_type counting_bloom_filter_random_seed(const counting_bloom_filter *);
+static counting_bloom_filter_hash_type counting_bloom_filter_get_hash(const counting_bloom_filter *, const counting_bloom_filter_key_type *);
+static counting_bloom_filter_block *counting_bloom_filter_get_block(const counting_bloom_filter *, counting_bloom_filter_hash_type);
+static unsigned int counting_bloom_filter_get_counter(counting_bloom_filter_hash_type, unsigned int);
+static int counting_bloom_filter_block_contains(const counting_bloom_filter_block *, counting_bloom_filter_hash_type, unsigned int);
+
+static inline counting_bloom_filter_hash_type counting_bloom_filter_mix(counting_bloom_filter_hash_type hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static counting_bloom_filter_hash_type counting_bloom_filter_random_seed(const counting_bloom_filter *cbf)
+{
+    static counting_bloom_filter_hash_type counter = 0;
+    counting_bloom_filter_hash_type ret = (counting_bloom_filter_hash_type)time(NULL);
+    ret ^= counting_bloom_filter_mix((counting_bloom_filter_hash_type)(size_t)cbf + ++counter * 0x9e3779b97f4a7c15ULL);
+    ret ^= counting_bloom_filter_mix((counting_bloom_filter_hash_type)clock());
+    return counting_bloom_filter_mix(ret);
+}
+
+counting_bloom_filter_hash_type counting_bloom_filter_default_hash(const counting_bloom_filter_key_type *key_ptr, counting_bloom_filter_hash_type seed)
+{
+    assert(key_ptr != NULL);
+    return counting_bloom_filter_mix((counting_bloom_filter_hash_type)(unsigned int)*key_ptr ^ seed);
+}
+
+inline void counting_bloom_filter_init(counting_bloom_filter *cbf, unsigned long expected_size, double bits_per_key)
+{
+    counting_bloom_filter_init_with_hash(cbf, expected_size, bits_per_key, counting_bloom_filter_default_hash);
+}
+
+void counting_bloom_filter_init_with_hash(counting_bloom_filter *cbf, unsigned long expected_size, double bits_per_key, counting_bloom_filter_hash_func_type hash_func)
+{
+    double hash_count;
+    assert(cbf != NULL);
+    assert(bits_per_key > 0);
+    hash_count = bits_per_key / COUNTING_BLOOM_FILTER_COUNTER_BITS * COUNTING_BLOOM_FILTER_LN2 + 0.5;
+    cbf->hash_count = hash_count < 1 ? 1 : hash_count > COUNTING_BLOOM_FILTER_MAX_HASHES ? COUNTING_BLOOM_FILTER_MAX_HASHES : (unsigned int)hash_count;
+    cbf->block_count = (unsigned long)((double)expected_size * bits_per_key / COUNTING_BLOOM_FILTER_BLOCK_BITS) + 1;
+    cbf->memory = malloc(cbf->block_count * sizeof(counting_bloom_filter_block) + COUNTING_BLOOM_FILTER_CACHE_LINE - 1);
+    assert(cbf->memory != NULL);
+    cbf->block = (counting_bloom_filter_block *)(((size_t)cbf->memory + COUNTING_BLOOM_FILTER_CACHE_LINE - 1) & ~(size_t)(COUNTING_BLOOM_FILTER_CACHE_LINE - 1));
+    memset(cbf->block, 0, cbf->block_count * sizeof(counting_bloom_filter_block));
+    cbf->size = 0;
+    cbf->hash_func = hash_func != NULL ? hash_func : counting_bloom_filter_default_hash;
+    cbf->seed = counting_bloom_filter_random_seed(cbf);
+}
+
+inline unsigned long counting_bloom_filter_size(const counting_bloom_filter *cbf)
+{
+    assert(cbf != NULL);
+    return cbf->size;
+}
+
+inline unsigned long counting_bloom_filter_bits(const counting_bloom_filter *cbf)
+{
+    assert(cbf != NULL);
+    return cbf->block_count * COUNTING_BLOOM_FILTER_BLOCK_BITS;
+}
+
+inline int counting_bloom_filter_empty(const counting_bloom_filter *cbf)
+{
+    assert(cbf != NULL);
+    return cbf->size == 0;
+}
+
+static inline counting_bloom_filter_hash_type counting_bloom_filter_get_hash(const counting_bloom_filter *cbf, const counting_bloom_filter_key_type *key_ptr)
+{
+    assert(cbf != NULL);
+    assert(key_ptr != NULL);
+    return cbf->hash_func(key_ptr, cbf->seed);
+}
+
+static inline counting_bloom_filter_block *counting_bloom_filter_get_block(const counting_bloom_filter *cbf, counting_bloom_filter_hash_type hash)
+{
+    assert(cbf != NULL);
+    return &cbf->block[(unsigned long)(((hash >> 32) * cbf->block_count) >> 32)];
+}
+
+// The top 3 bits of the index pick the word and the low 4 bits pick the counter inside it.
+static inline unsigned int counting_bloom_filter_get_counter(counting_bloom_filter_hash_type hash, unsigned int i)
+{
+    return ((unsigned int)hash * counting_bloom_filter_salt[i]) >> 25;
+}
+
+static int counting_bloom_filter_block_contains(const counting_bloom_filter_block *block, counting_bloom_filter_hash_type hash, unsigned int hash_count)
+{
+    unsigned int i;
+    unsigned int counter;
+    assert(block != NULL);
+    for (i = 0; i < hash_count; ++i) {
+        counter = counting_bloom_filter_get_counter(hash, i);
+        if (!((block->word[counter >> 4] >> ((counter & 15) << 2)) & COUNTING_BLOOM_FILTER_COUNTER_MAX))
+            return 0;
+    }
+    return 1;
+}
+
+void counting_bloom_filter_insert(counting_bloom_filter *cbf, const counting_bloom_filter_key_type *key_ptr)
+{
+    unsigned int i;
+    unsigned int counter;
+    unsigned int shift;
+    counting_bloom_filter_hash_type hash;
+    counting_bloom_filter_block *block = NULL;
+    assert(cbf != NULL);
+    assert(key_ptr != NULL);
+    hash = counting_bloom_filter_get_hash(cbf, key_ptr);
+    block = counting_bloom_filter_get_block(cbf, hash);
+    for (i = 0; i < cbf->hash_count; ++i) {
+        counter = counting_bloom_filter_get_counter(hash, i);
+        shift = (counter & 15) << 2;
+        if (((block->word[counter >> 4] >> shift) & COUNTING_BLOOM_FILTER_COUNTER_MAX) != COUNTING_BLOOM_FILTER_COUNTER_MAX)
+            block->word[counter >> 4] += 1ULL << shift;
+    }
+    ++cbf->size;
+}
+
+void counting_bloom_filter_delete(counting_bloom_filter *cbf, const counting_bloom_filter_key_type *key_ptr)
+{
+    unsigned int i;
+    unsigned int counter;
+    unsigned int shift;
+    counting_bloom_filter_hash_type hash;
+    counting_bloom_filter_block *block = NULL;
+    assert(cbf != NULL);
+    assert(key_ptr != NULL);
+    hash = counting_bloom_filter_get_hash(cbf, key_ptr);
+    block = counting_bloom_filter_get_block(cbf, hash);
+    if (!counting_bloom_filter_block_contains(block, hash, cbf->hash_count))
+        return;
+    for (i = 0; i < cbf->hash_count; ++i) {
+        counter = counting_bloom_filter_get_counter(hash, i);
+        shift = (counter & 15) << 2;
+        if (((block->word[counter >> 4] >> shift) & COUNTING_BLOOM_FILTER_COUNTER_MAX) != COUNTING_BLOOM_FILTER_COUNTER_MAX)
+            block->word[counter >> 4] -= 1ULL << shift;
+    }
+    --cbf->size;
+}
+
+int counting_bloom_filter_contains(const counting_bloom_filter *cbf, const counting_bloom_filter_key_type *key_ptr)
+{
+    counting_bloom_filter_hash_type hash;
+    assert(cbf != NULL);
+    assert(key_ptr != NULL);
+    hash = counting_bloom_filter_get_hash(cbf, key_ptr);
+    return counting_bloom_filter_block_contains(counting_bloom_filter_get_block(cbf, hash), hash, cbf->hash_count);
+}
+
+inline void counting_bloom_filter_clear(counting_bloom_filter *cbf)
+{
+    assert(cbf != NULL);
+    memset(cbf->block, 0, cbf->block_count * sizeof(counting_bloom_filter_block));
+    cbf->size = 0;
+}
+
+inline void counting_bloom_filter_destroy(counting_bloom_filter *cbf)
+{
+    assert(cbf != NULL);
+    free(cbf->memory);
+    cbf->memory = NULL;
+    cbf->block = NULL;
+    cbf->block_count = cbf->size = 0;
+    cbf->hash_count = 0;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef __COUNTING_BLOOM_FILTER_H__
+#define __COUNTING_BLOOM_FILTER_H__
+
+// Each key bumps k of the 128 4-bit counters in a single cache-line block; counters stick once they reach 15.
+// A counter costs 4 bits, so budget about 4x the bits per key a plain Bloom filter would need for the same false-positive rate;
+// k is derived from the counters per key (bits_per_key / 4) and clamped to 1..8.
+// Only keys that were inserted may be deleted. A zero from counting_bloom_filter_contains is a definite miss.
+#define COUNTING_BLOOM_FILTER_CACHE_LINE 64
+#define COUNTING_BLOOM_FILTER_BLOCK_WORDS 8
+
+typedef int counting_bloom_filter_key_type;
+typedef unsigned long long counting_bloom_filter_hash_type;
+typedef counting_bloom_filter_hash_type (*counting_bloom_filter_hash_func_type)(const counting_bloom_filter_key_type *, counting_bloom_filter_hash_type);
+typedef struct CountingBloomFilterBlock
+{
+    unsigned long long word[COUNTING_BLOOM_FILTER_BLOCK_WORDS];
+} counting_bloom_filter_block;
+typedef struct CountingBloomFilter
+{
+    counting_bloom_filter_block *block;
+    void *memory;
+    unsigned long block_count;
+    unsigned long size;
+    unsigned int hash_count;
+    counting_bloom_filter_hash_func_type hash_func;
+    counting_bloom_filter_hash_type seed;
+} counting_bloom_filter;
+
+counting_bloom_filter_hash_type counting_bloom_filter_default_hash(const counting_bloom_filter_key_type *, counting_bloom_filter_hash_type);
+void counting_bloom_filter_init(counting_bloom_filter *, unsigned long, double);
+void counting_bloom_filter_init_with_hash(counting_bloom_filter *, unsigned long, double, counting_bloom_filter_hash_func_type);
+unsigned long counting_bloom_filter_size(const counting_bloom_filter *);
+unsigned long counting_bloom_filter_bits(const counting_bloom_filter *);
+int counting_bloom_filter_empty(const counting_bloom_filter *);
+void counting_bloom_filter_insert(counting_bloom_filter *, const counting_bloom_filter_key_type *);
+void counting_bloom_filter_delete(counting_bloom_filter *, const counting_bloom_filter_key_type *);
+int counting_bloom_filter_contains(const counting_bloom_filter *, const counting_bloom_filter_key_type *);
+void counting_bloom_filter_clear(counting_bloom_filter *);
+void counting_bloom_filter_destroy(counting_bloom_filter *);
+
+#endif // __COUNTING_BLOOM_FILTER_H__
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "counting_bloom_filter.h"
+#include "../../benchmark/benchmark.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MAXN (1 << 24)
+#define BITS_PER_KEY 40
+
+counting_bloom_filter *cbf;
+
+void setup_empty(void *arg)
+{
+    (void)arg;
+    counting_bloom_filter_init(cbf, MAXN, BITS_PER_KEY);
+}
+
+void setup_full(void *arg)
+{
+    int i;
+    int key;
+    setup_empty(arg);
+    for (i = 0; i < MAXN; ++i) {
+        key = i << 1;
+        counting_bloom_filter_insert(cbf, &key);
+    }
+}
+
+void setup_deleted(void *arg)
+{
+    int i;
+    int key;
+    setup_full(arg);
+    for (i = 0; i < (MAXN >> 1); ++i) {
+        key = i << 1;
+        counting_bloom_filter_delete(cbf, &key);
+    }
+}
+
+void teardown(void *arg)
+{
+    (void)arg;
+    counting_bloom_filter_destroy(cbf);
+}
+
+void insert_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int key;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        key = i << 1;
+        benchmark_op_begin(rec);
+        counting_bloom_filter_insert(cbf, &key);
+        benchmark_op_end(rec);
+    }
+    rec->checksum = counting_bloom_filter_size(cbf);
+}
+
+void delete_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int key;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < (MAXN >> 1); ++i) {
+        key = i << 1;
+        benchmark_op_begin(rec);
+        counting_bloom_filter_delete(cbf, &key);
+        benchmark_op_end(rec);
+    }
+    rec->checksum = counting_bloom_filter_size(cbf);
+}
+
+void contains_hit_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int key;
+    (void)thread;
+    (void)arg;
+    for (i = (MAXN >> 1); i < MAXN; ++i) {
+        key = i << 1;
+        benchmark_op_begin(rec);
+        if (counting_bloom_filter_contains(cbf, &key))
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+void contains_miss_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int key;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        key = i < (MAXN >> 1) ? i << 1 : i << 1 | 1;
+        benchmark_op_begin(rec);
+        if (counting_bloom_filter_contains(cbf, &key))
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    benchmark b;
+    cbf = (counting_bloom_filter *)malloc(sizeof(counting_bloom_filter));
+
+    benchmark_init(&b, "counting_bloom_filter", argc, argv);
+    benchmark_run(&b, &(benchmark_case){"insert", 1, setup_empty, insert_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"delete", 1, setup_full, delete_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"contains_hit", 1, setup_deleted, contains_hit_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"contains_miss", 1, setup_deleted, contains_miss_run, teardown, NULL});
+    benchmark_finish(&b);
+
+    free(cbf);
+    return 0;
+}
\ No newline at end of file
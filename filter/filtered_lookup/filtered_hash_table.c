@@ -0,0 +1,52 @@
+#include "filtered_hash_table.h"
+#include <stdlib.h>
+#include <assert.h>
+
+inline void filtered_hash_table_init(filtered_hash_table *fht, double load_factor, unsigned long expected_size, double bits_per_key)
+{
+    assert(fht != NULL);
+    hash_table_init(&fht->table, load_factor);
+    counting_bloom_filter_init(&fht->filter, expected_size, bits_per_key);
+}
+
+inline unsigned long filtered_hash_table_size(const filtered_hash_table *fht)
+{
+    assert(fht != NULL);
+    return hash_table_size(&fht->table);
+}
+
+inline hash_table_val_type *filtered_hash_table_find(filtered_hash_table *fht, const hash_table_key_type *key_ptr)
+{
+    assert(fht != NULL);
+    assert(key_ptr != NULL);
+    if (!counting_bloom_filter_contains(&fht->filter, key_ptr))
+        return NULL;
+    return hash_table_find(&fht->table, key_ptr);
+}
+
+void filtered_hash_table_insert(filtered_hash_table *fht, const hash_table_data_type *data_ptr)
+{
+    assert(fht != NULL);
+    assert(data_ptr != NULL);
+    // Count the key only when it is new, so one delete takes it back out of the filter.
+    if (filtered_hash_table_find(fht, &data_ptr->key) == NULL)
+        counting_bloom_filter_insert(&fht->filter, &data_ptr->key);
+    hash_table_insert(&fht->table, data_ptr);
+}
+
+void filtered_hash_table_delete(filtered_hash_table *fht, const hash_table_key_type *key_ptr)
+{
+    assert(fht != NULL);
+    assert(key_ptr != NULL);
+    if (filtered_hash_table_find(fht, key_ptr) == NULL)
+        return;
+    hash_table_delete(&fht->table, key_ptr);
+    counting_bloom_filter_delete(&fht->filter, key_ptr);
+}
+
+inline void filtered_hash_table_destroy(filtered_hash_table *fht)
+{
+    assert(fht != NULL);
+    hash_table_destroy(&fht->table);
+    counting_bloom_filter_destroy(&fht->filter);
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#ifndef __FILTERED_HASH_TABLE_H__
+#define __FILTERED_HASH_TABLE_H__
+
+#include "../../hash_table/seperate_chaining/hash_table.h"
+#include "../counting_bloom_filter/counting_bloom_filter.h"
+
+// A counting Bloom filter in front of the separate chaining table, so a find on a definite miss never hashes into a bucket.
+// The filter holds every distinct key once; keys evicted by the cache mode stay in it as false positives. Needs int keys.
+typedef struct FilteredHashTable
+{
+    hash_table table;
+    counting_bloom_filter filter;
+} filtered_hash_table;
+
+void filtered_hash_table_init(filtered_hash_table *, double, unsigned long, double);
+unsigned long filtered_hash_table_size(const filtered_hash_table *);
+hash_table_val_type *filtered_hash_table_find(filtered_hash_table *, const hash_table_key_type *);
+void filtered_hash_table_insert(filtered_hash_table *, const hash_table_data_type *);
+void filtered_hash_table_delete(filtered_hash_table *, const hash_table_key_type *);
+void filtered_hash_table_destroy(filtered_hash_table *);
+
+#endif // __FILTERED_HASH_TABLE_H__
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include "filtered_red_black_tree.h"
+#include <stdlib.h>
+#include <assert.h>
+
+inline void filtered_red_black_tree_init(filtered_red_black_tree *frbt, unsigned long expected_size, double bits_per_key)
+{
+    assert(frbt != NULL);
+    red_black_tree_init(&frbt->tree);
+    counting_bloom_filter_init(&frbt->filter, expected_size, bits_per_key);
+}
+
+inline red_black_tree_node *filtered_red_black_tree_find(filtered_red_black_tree *frbt, const red_black_tree_key_type *key_ptr)
+{
+    assert(frbt != NULL);
+    assert(key_ptr != NULL);
+    if (!counting_bloom_filter_contains(&frbt->filter, key_ptr))
+        return NULL;
+    return red_black_tree_find(&frbt->tree, key_ptr);
+}
+
+void filtered_red_black_tree_insert(filtered_red_black_tree *frbt, const red_black_tree_data_type *data_ptr)
+{
+    assert(frbt != NULL);
+    assert(data_ptr != NULL);
+    // Count the key only when it is new, so one delete takes it back out of the filter.
+    if (filtered_red_black_tree_find(frbt, &data_ptr->key) == NULL)
+        counting_bloom_filter_insert(&frbt->filter, &data_ptr->key);
+    red_black_tree_insert(&frbt->tree, data_ptr);
+}
+
+void filtered_red_black_tree_delete(filtered_red_black_tree *frbt, const red_black_tree_key_type *key_ptr)
+{
+    assert(frbt != NULL);
+    assert(key_ptr != NULL);
+    if (filtered_red_black_tree_find(frbt, key_ptr) == NULL)
+        return;
+    red_black_tree_delete(&frbt->tree, key_ptr);
+    counting_bloom_filter_delete(&frbt->filter, key_ptr);
+}
+
+inline void filtered_red_black_tree_destroy(filtered_red_black_tree *frbt)
+{
+    assert(frbt != NULL);
+    red_black_tree_clear(&frbt->tree);
+    counting_bloom_filter_destroy(&frbt->filter);
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef __FILTERED_RED_BLACK_TREE_H__
+#define __FILTERED_RED_BLACK_TREE_H__
+
+#include "../../binary_search_tree/red_black_tree/red_black_tree.h"
+#include "../counting_bloom_filter/counting_bloom_filter.h"
+
+// A counting Bloom filter in front of the red-black tree, so a find on a definite miss never walks down from the root.
+// The filter holds every key in the tree once; the ordered queries go to the tree directly.
+typedef struct FilteredRedBlackTree
+{
+    red_black_tree tree;
+    counting_bloom_filter filter;
+} filtered_red_black_tree;
+
+void filtered_red_black_tree_init(filtered_red_black_tree *, unsigned long, double);
+red_black_tree_node *filtered_red_black_tree_find(filtered_red_black_tree *, const red_black_tree_key_type *);
+void filtered_red_black_tree_insert(filtered_red_black_tree *, const red_black_tree_data_type *);
+void filtered_red_black_tree_delete(filtered_red_black_tree *, const red_black_tree_key_type *);
+void filtered_red_black_tree_destroy(filtered_red_black_tree *);
+
+#endif // __FILTERED_RED_BLACK_TREE_H__
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "filtered_hash_table.h"
+#include "filtered_red_black_tree.h"
+#include "../../benchmark/benchmark.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MAXN (1 << 22)
+#define LOAD_FACTOR 0.5
+// Forty bits are ten 4-bit counters per key, which keeps false positives near 1.5%.
+#define BITS_PER_KEY 40
+
+// Stored keys are even and shuffled; key + 1 is always a miss.
+int *keys;
+filtered_hash_table *fht;
+filtered_red_black_tree *frbt;
+
+void init_keys(void)
+{
+    int i;
+    int j;
+    int tmp;
+    srand((unsigned int)time(NULL));
+    for (i = 0; i < MAXN; ++i)
+        keys[i] = i << 1;
+    for (i = MAXN - 1; i > 0; --i) {
+        j = (int)(((unsigned long)rand() * (RAND_MAX + 1UL) + (unsigned long)rand()) % (unsigned long)(i + 1));
+        tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+}
+
+void setup_hash_table(void *arg)
+{
+    int i;
+    hash_table_data_type data;
+    (void)arg;
+    filtered_hash_table_init(fht, LOAD_FACTOR, MAXN, BITS_PER_KEY);
+    for (i = 0; i < MAXN; ++i) {
+        data.key = keys[i];
+        data.val = i;
+        filtered_hash_table_insert(fht, &data);
+    }
+}
+
+void teardown_hash_table(void *arg)
+{
+    (void)arg;
+    filtered_hash_table_destroy(fht);
+}
+
+void setup_red_black_tree(void *arg)
+{
+    int i;
+    red_black_tree_data_type data;
+    (void)arg;
+    filtered_red_black_tree_init(frbt, MAXN, BITS_PER_KEY);
+    for (i = 0; i < MAXN; ++i) {
+        data.key = keys[i];
+        data.val = i;
+        filtered_red_black_tree_insert(frbt, &data);
+    }
+}
+
+void teardown_red_black_tree(void *arg)
+{
+    (void)arg;
+    filtered_red_black_tree_destroy(frbt);
+}
+
+void hash_table_miss_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int key;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        key = keys[i] + 1;
+        benchmark_op_begin(rec);
+        if (hash_table_find(&fht->table, &key) != NULL)
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+void filtered_hash_table_miss_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int key;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        key = keys[i] + 1;
+        benchmark_op_begin(rec);
+        if (filtered_hash_table_find(fht, &key) != NULL)
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+void filtered_hash_table_hit_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        benchmark_op_begin(rec);
+        if (filtered_hash_table_find(fht, &keys[i]) != NULL)
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+void red_black_tree_miss_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int key;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        key = keys[i] + 1;
+        benchmark_op_begin(rec);
+        if (red_black_tree_find(&frbt->tree, &key) != NULL)
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+void filtered_red_black_tree_miss_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    int key;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        key = keys[i] + 1;
+        benchmark_op_begin(rec);
+        if (filtered_red_black_tree_find(frbt, &key) != NULL)
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+void filtered_red_black_tree_hit_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        benchmark_op_begin(rec);
+        if (filtered_red_black_tree_find(frbt, &keys[i]) != NULL)
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    benchmark b;
+    keys = (int *)malloc(sizeof(int) * MAXN);
+    fht = (filtered_hash_table *)malloc(sizeof(filtered_hash_table));
+    frbt = (filtered_red_black_tree *)malloc(sizeof(filtered_red_black_tree));
+    init_keys();
+
+    benchmark_init(&b, "filtered_lookup", argc, argv);
+    benchmark_run(&b, &(benchmark_case){"hash_table_miss", 1, setup_hash_table, hash_table_miss_run, teardown_hash_table, NULL});
+    benchmark_run(&b, &(benchmark_case){"filtered_hash_table_miss", 1, setup_hash_table, filtered_hash_table_miss_run, teardown_hash_table, NULL});
+    benchmark_run(&b, &(benchmark_case){"filtered_hash_table_hit", 1, setup_hash_table, filtered_hash_table_hit_run, teardown_hash_table, NULL});
+    benchmark_run(&b, &(benchmark_case){"red_black_tree_miss", 1, setup_red_black_tree, red_black_tree_miss_run, teardown_red_black_tree, NULL});
+    benchmark_run(&b, &(benchmark_case){"filtered_red_black_tree_miss", 1, setup_red_black_tree, filtered_red_black_tree_miss_run, teardown_red_black_tree, NULL});
+    benchmark_run(&b, &(benchmark_case){"filtered_red_black_tree_hit", 1, setup_red_black_tree, filtered_red_black_tree_hit_run, teardown_red_black_tree, NULL});
+    benchmark_finish(&b);
+
+    free(frbt);
+    free(fht);
+    free(keys);
+    return 0;
+}
\ No newline at end of file
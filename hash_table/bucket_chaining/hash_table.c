@@ -0,0 +1,305 @@
+#include "hash_table.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+static int hash_table_key_compare(const hash_table_key_type *, const hash_table_key_type *);
+static void hash_table_val_copy(hash_table_val_type *, const hash_table_val_type *);
+static void hash_table_data_copy(hash_table_data_type *, const hash_table_data_type *);
+static hash_table_block *create_hash_table_block(void);
+static hash_table_hash_type hash_table_mix(hash_table_hash_type);
+static hash_table_hash_type hash_table_random_seed(const hash_table *);
+static int hash_table_overload(const hash_table *);
+static hash_table_hash_type hash_table_get_hash(const hash_table *, const hash_table_key_type *);
+static hash_table_block *hash_table_get_bucket(const hash_table *, hash_table_hash_type);
+static unsigned long hash_table_min_bucket_count(const hash_table *, unsigned long);
+static hash_table_data_type *hash_table_block_find(hash_table_block *, const hash_table_key_type *);
+static void hash_table_block_append(hash_table_block *, const hash_table_data_type *);
+static void hash_table_block_erase(hash_table_block *, hash_table_block *, unsigned int);
+static void hash_table_block_release(hash_table_block *);
+static void hash_table_allocate(hash_table *, unsigned long);
+static void hash_table_resize(hash_table *, unsigned long);
+
+static inline int hash_table_key_compare(const hash_table_key_type *lhs, const hash_table_key_type *rhs)
+{
+    assert(lhs != NULL);
+    assert(rhs != NULL);
+    if (*lhs < *rhs)
+        return -1;
+    if (*lhs > *rhs)
+        return 1;
+    return 0;
+}
+
+static inline void hash_table_val_copy(hash_table_val_type *dest, const hash_table_val_type *source)
+{
+    assert(dest != NULL);
+    assert(source != NULL);
+    *dest = *source;
+}
+
+static inline void hash_table_data_copy(hash_table_data_type *dest, const hash_table_data_type *source)
+{
+    assert(dest != NULL);
+    assert(source != NULL);
+    dest->key = source->key;
+    hash_table_val_copy(&dest->val, &source->val);
+}
+
+static inline hash_table_block *create_hash_table_block(void)
+{
+    hash_table_block *ret = (hash_table_block *)malloc(sizeof(hash_table_block));
+    assert(ret != NULL);
+    ret->count = 0;
+    ret->next = NULL;
+    return ret;
+}
+
+static inline hash_table_hash_type hash_table_mix(hash_table_hash_type hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static hash_table_hash_type hash_table_random_seed(const hash_table *ht)
+{
+    static hash_table_hash_type counter = 0;
+    hash_table_hash_type ret = (hash_table_hash_type)time(NULL);
+    ret ^= hash_table_mix((hash_table_hash_type)(size_t)ht + ++counter * 0x9e3779b97f4a7c15ULL);
+    ret ^= hash_table_mix((hash_table_hash_type)clock());
+    return hash_table_mix(ret);
+}
+
+hash_table_hash_type hash_table_default_hash(const hash_table_key_type *key_ptr, hash_table_hash_type seed)
+{
+    assert(key_ptr != NULL);
+    return hash_table_mix((hash_table_hash_type)(unsigned int)*key_ptr ^ seed);
+}
+
+inline void hash_table_init(hash_table *ht, double init_load_factor)
+{
+    hash_table_init_with_hash(ht, init_load_factor, hash_table_default_hash);
+}
+
+void hash_table_init_with_hash(hash_table *ht, double init_load_factor, hash_table_hash_func_type hash_func)
+{
+    assert(ht != NULL);
+    assert(init_load_factor > 0);
+    ht->bucket = NULL;
+    ht->memory = NULL;
+    ht->bucket_count = ht->size = ht->capacity = 0;
+    ht->load_factor = init_load_factor;
+    ht->hash_func = hash_func != NULL ? hash_func : hash_table_default_hash;
+    ht->seed = hash_table_random_seed(ht);
+}
+
+inline unsigned long hash_table_capacity(const hash_table *ht)
+{
+    assert(ht != NULL);
+    return ht->capacity;
+}
+
+inline unsigned long hash_table_size(const hash_table *ht)
+{
+    assert(ht != NULL);
+    return ht->size;
+}
+
+inline int hash_table_empty(const hash_table *ht)
+{
+    assert(ht != NULL);
+    return ht->size == 0;
+}
+
+static inline int hash_table_overload(const hash_table *ht)
+{
+    assert(ht != NULL);
+    return ht->capacity == 0 || (double)ht->size > (double)ht->capacity * ht->load_factor;
+}
+
+static inline hash_table_hash_type hash_table_get_hash(const hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    return ht->hash_func(key_ptr, ht->seed);
+}
+
+static inline hash_table_block *hash_table_get_bucket(const hash_table *ht, hash_table_hash_type hash)
+{
+    assert(ht != NULL);
+    return &ht->bucket[(unsigned long)hash & ht->mask];
+}
+
+static unsigned long hash_table_min_bucket_count(const hash_table *ht, unsigned long size)
+{
+    unsigned long ret = 1;
+    assert(ht != NULL);
+    while ((double)(ret * HASH_TABLE_BLOCK_WIDTH) * ht->load_factor < 1 || (double)size > (double)(ret * HASH_TABLE_BLOCK_WIDTH) * ht->load_factor)
+        ret <<= 1;
+    return ret;
+}
+
+static hash_table_data_type *hash_table_block_find(hash_table_block *block, const hash_table_key_type *key_ptr)
+{
+    unsigned int i;
+    assert(key_ptr != NULL);
+    for (; block != NULL; block = block->next) {
+        for (i = 0; i < block->count; ++i) {
+            if (hash_table_key_compare(&block->data[i].key, key_ptr) == 0)
+                return &block->data[i];
+        }
+    }
+    return NULL;
+}
+
+static void hash_table_block_append(hash_table_block *block, const hash_table_data_type *data_ptr)
+{
+    assert(block != NULL);
+    assert(data_ptr != NULL);
+    while (block->count == HASH_TABLE_BLOCK_WIDTH) {
+        if (block->next == NULL)
+            block->next = create_hash_table_block();
+        block = block->next;
+    }
+    hash_table_data_copy(&block->data[block->count++], data_ptr);
+}
+
+static void hash_table_block_erase(hash_table_block *head, hash_table_block *block, unsigned int index)
+{
+    hash_table_block *last = head;
+    hash_table_block *prev = NULL;
+    assert(head != NULL);
+    assert(block != NULL);
+    while (last->next != NULL) {
+        prev = last;
+        last = last->next;
+    }
+    hash_table_data_copy(&block->data[index], &last->data[--last->count]);
+    if (last->count == 0 && prev != NULL) {
+        free(last);
+        prev->next = NULL;
+    }
+}
+
+static void hash_table_block_release(hash_table_block *head)
+{
+    hash_table_block *tmp = NULL;
+    assert(head != NULL);
+    while (head->next != NULL) {
+        tmp = head->next;
+        head->next = tmp->next;
+        free(tmp);
+    }
+    head->count = 0;
+}
+
+static void hash_table_allocate(hash_table *ht, unsigned long bucket_count)
+{
+    unsigned long i;
+    assert(ht != NULL);
+    ht->memory = malloc(bucket_count * sizeof(hash_table_block) + HASH_TABLE_CACHE_LINE - 1);
+    assert(ht->memory != NULL);
+    ht->bucket = (hash_table_block *)(((size_t)ht->memory + HASH_TABLE_CACHE_LINE - 1) & ~(size_t)(HASH_TABLE_CACHE_LINE - 1));
+    for (i = 0; i < bucket_count; ++i) {
+        ht->bucket[i].count = 0;
+        ht->bucket[i].next = NULL;
+    }
+    ht->bucket_count = bucket_count;
+    ht->capacity = bucket_count * HASH_TABLE_BLOCK_WIDTH;
+    ht->mask = bucket_count - 1;
+}
+
+static void hash_table_resize(hash_table *ht, unsigned long new_bucket_count)
+{
+    unsigned long i;
+    unsigned int j;
+    hash_table old_table;
+    hash_table_block *block = NULL;
+    assert(ht != NULL);
+    old_table = *ht;
+    hash_table_allocate(ht, new_bucket_count);
+    for (i = 0; i < old_table.bucket_count; ++i) {
+        for (block = &old_table.bucket[i]; block != NULL; block = block->next) {
+            for (j = 0; j < block->count; ++j)
+                hash_table_block_append(hash_table_get_bucket(ht, hash_table_get_hash(ht, &block->data[j].key)), &block->data[j]);
+        }
+        hash_table_block_release(&old_table.bucket[i]);
+    }
+    free(old_table.memory);
+}
+
+hash_table_val_type *hash_table_find(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    hash_table_data_type *ptr = NULL;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    if (ht->capacity == 0)
+        return NULL;
+    ptr = hash_table_block_find(hash_table_get_bucket(ht, hash_table_get_hash(ht, key_ptr)), key_ptr);
+    return ptr != NULL ? &ptr->val : NULL;
+}
+
+void hash_table_insert(hash_table *ht, const hash_table_data_type *data_ptr)
+{
+    hash_table_hash_type hash;
+    hash_table_data_type *ptr = NULL;
+    assert(ht != NULL);
+    assert(data_ptr != NULL);
+    hash = hash_table_get_hash(ht, &data_ptr->key);
+    if (ht->capacity) {
+        ptr = hash_table_block_find(hash_table_get_bucket(ht, hash), &data_ptr->key);
+        if (ptr != NULL) {
+            hash_table_val_copy(&ptr->val, &data_ptr->val);
+            return;
+        }
+    }
+    if (hash_table_overload(ht))
+        hash_table_resize(ht, ht->bucket_count ? ht->bucket_count << 1 : hash_table_min_bucket_count(ht, 0));
+    hash_table_block_append(hash_table_get_bucket(ht, hash), data_ptr);
+    ++ht->size;
+}
+
+void hash_table_delete(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    unsigned int i;
+    hash_table_block *head = NULL;
+    hash_table_block *block = NULL;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    if (ht->capacity == 0)
+        return;
+    head = hash_table_get_bucket(ht, hash_table_get_hash(ht, key_ptr));
+    for (block = head; block != NULL; block = block->next) {
+        for (i = 0; i < block->count; ++i) {
+            if (hash_table_key_compare(&block->data[i].key, key_ptr) == 0) {
+                hash_table_block_erase(head, block, i);
+                --ht->size;
+                return;
+            }
+        }
+    }
+}
+
+void hash_table_clear(hash_table *ht)
+{
+    unsigned long i;
+    assert(ht != NULL);
+    for (i = 0; i < ht->bucket_count; ++i)
+        hash_table_block_release(&ht->bucket[i]);
+    ht->size = 0;
+}
+
+inline void hash_table_destroy(hash_table *ht)
+{
+    assert(ht != NULL);
+    hash_table_clear(ht);
+    free(ht->memory);
+    ht->memory = NULL;
+    ht->bucket = NULL;
+    ht->bucket_count = ht->capacity = 0;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef __HASH_TABLE_H__
+#define __HASH_TABLE_H__
+
+// Each bucket is one cache line of inline entries, chained to overflow blocks of the same shape when it fills up.
+#define HASH_TABLE_CACHE_LINE 64
+
+typedef int hash_table_key_type;
+typedef int hash_table_val_type;
+typedef unsigned long long hash_table_hash_type;
+typedef hash_table_hash_type (*hash_table_hash_func_type)(const hash_table_key_type *, hash_table_hash_type);
+typedef struct HashTableDataNode
+{
+    hash_table_key_type key;
+    hash_table_val_type val;
+} hash_table_data_type;
+#define HASH_TABLE_BLOCK_WIDTH ((HASH_TABLE_CACHE_LINE - sizeof(void *) - sizeof(unsigned int)) / sizeof(hash_table_data_type))
+typedef struct HashTableBlock
+{
+    hash_table_data_type data[HASH_TABLE_BLOCK_WIDTH];
+    unsigned int count;
+    struct HashTableBlock *next;
+} hash_table_block;
+typedef struct HashTable
+{
+    hash_table_block *bucket;
+    void *memory;
+    unsigned long bucket_count;
+    unsigned long size;
+    unsigned long capacity;
+    unsigned long mask;
+    double load_factor;
+    hash_table_hash_func_type hash_func;
+    hash_table_hash_type seed;
+} hash_table;
+
+hash_table_hash_type hash_table_default_hash(const hash_table_key_type *, hash_table_hash_type);
+void hash_table_init(hash_table *, double);
+void hash_table_init_with_hash(hash_table *, double, hash_table_hash_func_type);
+unsigned long hash_table_size(const hash_table *);
+unsigned long hash_table_capacity(const hash_table *);
+int hash_table_empty(const hash_table *);
+hash_table_val_type *hash_table_find(hash_table *, const hash_table_key_type *);
+void hash_table_insert(hash_table *, const hash_table_data_type *);
+void hash_table_delete(hash_table *, const hash_table_key_type *);
+void hash_table_clear(hash_table *);
+void hash_table_destroy(hash_table *);
+
+#endif // __HASH_TABLE_H__
\ No newline at end of file
@@ -0,0 +1,378 @@
+#include "hash_table.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <sched.h>
+
+#define HASH_TABLE_RECLAIM_THRESHOLD 1024
+
+static int hash_table_key_compare(const hash_table_key_type *, const hash_table_key_type *);
+static void hash_table_data_copy(hash_table_data_type *, const hash_table_data_type *);
+static hash_table_list_node *create_hash_table_list_node(const hash_table_data_type *);
+static hash_table_bucket_array *create_hash_table_bucket_array(unsigned long);
+static hash_table_hash_type hash_table_mix(hash_table_hash_type);
+static hash_table_hash_type hash_table_random_seed(const hash_table *);
+static hash_table_hash_type hash_table_get_hash(const hash_table *, const hash_table_key_type *);
+static pthread_mutex_t *hash_table_get_stripe(hash_table *, hash_table_hash_type);
+static unsigned long hash_table_pin(hash_table *);
+static void hash_table_unpin(hash_table *, unsigned long);
+static void hash_table_retire_push(hash_table *, void *);
+static void hash_table_reclaim(hash_table *);
+static void hash_table_retire(hash_table *, void *);
+static void hash_table_rehash(hash_table *);
+
+static _Thread_local unsigned long hash_table_slot_hint = HASH_TABLE_EPOCH_SLOTS;
+
+static inline int hash_table_key_compare(const hash_table_key_type *lhs, const hash_table_key_type *rhs)
+{
+    assert(lhs != NULL);
+    assert(rhs != NULL);
+    if (*lhs < *rhs)
+        return -1;
+    if (*lhs > *rhs)
+        return 1;
+    return 0;
+}
+
+static inline void hash_table_data_copy(hash_table_data_type *dest, const hash_table_data_type *source)
+{
+    assert(dest != NULL);
+    assert(source != NULL);
+    dest->key = source->key;
+    dest->val = source->val;
+}
+
+static inline hash_table_list_node *create_hash_table_list_node(const hash_table_data_type *data_ptr)
+{
+    hash_table_list_node *ret = NULL;
+    assert(data_ptr != NULL);
+    ret = (hash_table_list_node *)malloc(sizeof(hash_table_list_node));
+    assert(ret != NULL);
+    hash_table_data_copy(&ret->data, data_ptr);
+    atomic_init(&ret->next, NULL);
+    return ret;
+}
+
+static hash_table_bucket_array *create_hash_table_bucket_array(unsigned long capacity)
+{
+    unsigned long i;
+    hash_table_bucket_array *ret = NULL;
+    ret = (hash_table_bucket_array *)malloc(sizeof(hash_table_bucket_array) + capacity * sizeof(_Atomic(hash_table_list_node *)));
+    assert(ret != NULL);
+    ret->capacity = capacity;
+    ret->mask = capacity - 1;
+    for (i = 0; i < capacity; ++i)
+        atomic_init(&ret->hash_list[i], NULL);
+    return ret;
+}
+
+static inline hash_table_hash_type hash_table_mix(hash_table_hash_type hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static hash_table_hash_type hash_table_random_seed(const hash_table *ht)
+{
+    static atomic_ulong counter = 0;
+    hash_table_hash_type ret = (hash_table_hash_type)time(NULL);
+    ret ^= hash_table_mix((hash_table_hash_type)(size_t)ht + (atomic_fetch_add(&counter, 1) + 1) * 0x9e3779b97f4a7c15ULL);
+    ret ^= hash_table_mix((hash_table_hash_type)clock());
+    return hash_table_mix(ret);
+}
+
+hash_table_hash_type hash_table_default_hash(const hash_table_key_type *key_ptr, hash_table_hash_type seed)
+{
+    assert(key_ptr != NULL);
+    return hash_table_mix((hash_table_hash_type)(unsigned int)*key_ptr ^ seed);
+}
+
+inline void hash_table_init(hash_table *ht, double init_load_factor)
+{
+    hash_table_init_with_hash(ht, init_load_factor, hash_table_default_hash);
+}
+
+void hash_table_init_with_hash(hash_table *ht, double init_load_factor, hash_table_hash_func_type hash_func)
+{
+    unsigned long i;
+    assert(ht != NULL);
+    assert(init_load_factor > 0);
+    atomic_init(&ht->array, create_hash_table_bucket_array(HASH_TABLE_STRIPES));
+    for (i = 0; i < HASH_TABLE_STRIPES; ++i)
+        pthread_mutex_init(&ht->stripe[i].mutex, NULL);
+    for (i = 0; i < HASH_TABLE_EPOCH_SLOTS; ++i)
+        atomic_init(&ht->slot[i].epoch, 0);
+    atomic_init(&ht->epoch, 1);
+    atomic_init(&ht->size, 0);
+    pthread_mutex_init(&ht->retire_mutex, NULL);
+    ht->retired = NULL;
+    ht->retired_size = ht->retired_capacity = 0;
+    ht->load_factor = init_load_factor;
+    ht->hash_func = hash_func != NULL ? hash_func : hash_table_default_hash;
+    ht->seed = hash_table_random_seed(ht);
+}
+
+inline unsigned long hash_table_capacity(hash_table *ht)
+{
+    assert(ht != NULL);
+    return atomic_load(&ht->array)->capacity;
+}
+
+inline unsigned long hash_table_size(hash_table *ht)
+{
+    assert(ht != NULL);
+    return atomic_load(&ht->size);
+}
+
+inline int hash_table_empty(hash_table *ht)
+{
+    assert(ht != NULL);
+    return atomic_load(&ht->size) == 0;
+}
+
+static inline hash_table_hash_type hash_table_get_hash(const hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    return ht->hash_func(key_ptr, ht->seed);
+}
+
+static inline pthread_mutex_t *hash_table_get_stripe(hash_table *ht, hash_table_hash_type hash)
+{
+    assert(ht != NULL);
+    return &ht->stripe[(unsigned long)hash & (HASH_TABLE_STRIPES - 1)].mutex;
+}
+
+static unsigned long hash_table_pin(hash_table *ht)
+{
+    unsigned long i;
+    unsigned long expected;
+    assert(ht != NULL);
+    if (hash_table_slot_hint >= HASH_TABLE_EPOCH_SLOTS)
+        hash_table_slot_hint = (unsigned long)(hash_table_mix((hash_table_hash_type)(size_t)&hash_table_slot_hint) % HASH_TABLE_EPOCH_SLOTS);
+    for (i = hash_table_slot_hint;; i = (i + 1) % HASH_TABLE_EPOCH_SLOTS) {
+        expected = 0;
+        if (atomic_compare_exchange_strong(&ht->slot[i].epoch, &expected, atomic_load(&ht->epoch)))
+            break;
+        if ((i + 1) % HASH_TABLE_EPOCH_SLOTS == hash_table_slot_hint)
+            sched_yield();
+    }
+    hash_table_slot_hint = i;
+    return i;
+}
+
+static inline void hash_table_unpin(hash_table *ht, unsigned long slot)
+{
+    assert(ht != NULL);
+    atomic_store(&ht->slot[slot].epoch, 0);
+}
+
+static void hash_table_retire_push(hash_table *ht, void *ptr)
+{
+    assert(ht != NULL);
+    if (ht->retired_size == ht->retired_capacity) {
+        ht->retired_capacity = ht->retired_capacity ? ht->retired_capacity << 1 : HASH_TABLE_RECLAIM_THRESHOLD;
+        ht->retired = (hash_table_retired *)realloc(ht->retired, ht->retired_capacity * sizeof(hash_table_retired));
+        assert(ht->retired != NULL);
+    }
+    ht->retired[ht->retired_size].ptr = ptr;
+    ht->retired[ht->retired_size].epoch = atomic_load(&ht->epoch);
+    ++ht->retired_size;
+}
+
+static void hash_table_reclaim(hash_table *ht)
+{
+    unsigned long i;
+    unsigned long j;
+    unsigned long epoch;
+    unsigned long safe;
+    assert(ht != NULL);
+    safe = atomic_fetch_add(&ht->epoch, 1);
+    for (i = 0; i < HASH_TABLE_EPOCH_SLOTS; ++i) {
+        epoch = atomic_load(&ht->slot[i].epoch);
+        if (epoch && epoch < safe)
+            safe = epoch;
+    }
+    for (i = j = 0; i < ht->retired_size; ++i) {
+        if (ht->retired[i].epoch < safe)
+            free(ht->retired[i].ptr);
+        else
+            ht->retired[j++] = ht->retired[i];
+    }
+    ht->retired_size = j;
+}
+
+static void hash_table_retire(hash_table *ht, void *ptr)
+{
+    assert(ht != NULL);
+    pthread_mutex_lock(&ht->retire_mutex);
+    hash_table_retire_push(ht, ptr);
+    if (ht->retired_size >= HASH_TABLE_RECLAIM_THRESHOLD && ht->retired_size == ht->retired_capacity)
+        hash_table_reclaim(ht);
+    pthread_mutex_unlock(&ht->retire_mutex);
+}
+
+static void hash_table_rehash(hash_table *ht)
+{
+    unsigned long i;
+    unsigned long addr;
+    hash_table_bucket_array *old_array = NULL;
+    hash_table_bucket_array *new_array = NULL;
+    hash_table_list_node *ptr = NULL;
+    hash_table_list_node *node = NULL;
+    assert(ht != NULL);
+    for (i = 0; i < HASH_TABLE_STRIPES; ++i)
+        pthread_mutex_lock(&ht->stripe[i].mutex);
+    old_array = atomic_load(&ht->array);
+    if ((double)atomic_load(&ht->size) > (double)old_array->capacity * ht->load_factor) {
+        new_array = create_hash_table_bucket_array(old_array->capacity << 1);
+        for (i = 0; i < old_array->capacity; ++i) {
+            for (ptr = atomic_load(&old_array->hash_list[i]); ptr != NULL; ptr = atomic_load(&ptr->next)) {
+                node = create_hash_table_list_node(&ptr->data);
+                addr = (unsigned long)hash_table_get_hash(ht, &ptr->data.key) & new_array->mask;
+                atomic_store_explicit(&node->next, atomic_load_explicit(&new_array->hash_list[addr], memory_order_relaxed), memory_order_relaxed);
+                atomic_store_explicit(&new_array->hash_list[addr], node, memory_order_relaxed);
+            }
+        }
+        atomic_store(&ht->array, new_array);
+        pthread_mutex_lock(&ht->retire_mutex);
+        for (i = 0; i < old_array->capacity; ++i) {
+            for (ptr = atomic_load(&old_array->hash_list[i]); ptr != NULL; ptr = atomic_load(&ptr->next))
+                hash_table_retire_push(ht, ptr);
+        }
+        hash_table_retire_push(ht, old_array);
+        hash_table_reclaim(ht);
+        pthread_mutex_unlock(&ht->retire_mutex);
+    }
+    for (i = HASH_TABLE_STRIPES; i > 0; --i)
+        pthread_mutex_unlock(&ht->stripe[i - 1].mutex);
+}
+
+int hash_table_find(hash_table *ht, const hash_table_key_type *key_ptr, hash_table_val_type *val_ptr)
+{
+    int found = 0;
+    unsigned long slot;
+    hash_table_hash_type hash;
+    hash_table_bucket_array *array = NULL;
+    hash_table_list_node *ptr = NULL;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    hash = hash_table_get_hash(ht, key_ptr);
+    slot = hash_table_pin(ht);
+    array = atomic_load(&ht->array);
+    for (ptr = atomic_load(&array->hash_list[(unsigned long)hash & array->mask]); ptr != NULL; ptr = atomic_load(&ptr->next)) {
+        if (hash_table_key_compare(&ptr->data.key, key_ptr) == 0) {
+            if (val_ptr != NULL)
+                *val_ptr = ptr->data.val;
+            found = 1;
+            break;
+        }
+    }
+    hash_table_unpin(ht, slot);
+    return found;
+}
+
+void hash_table_insert(hash_table *ht, const hash_table_data_type *data_ptr)
+{
+    int overload;
+    hash_table_hash_type hash;
+    pthread_mutex_t *stripe = NULL;
+    hash_table_bucket_array *array = NULL;
+    _Atomic(hash_table_list_node *) *prev = NULL;
+    hash_table_list_node *ptr = NULL;
+    hash_table_list_node *node = NULL;
+    assert(ht != NULL);
+    assert(data_ptr != NULL);
+    hash = hash_table_get_hash(ht, &data_ptr->key);
+    node = create_hash_table_list_node(data_ptr);
+    stripe = hash_table_get_stripe(ht, hash);
+    pthread_mutex_lock(stripe);
+    array = atomic_load(&ht->array);
+    prev = &array->hash_list[(unsigned long)hash & array->mask];
+    for (ptr = atomic_load(prev); ptr != NULL; prev = &ptr->next, ptr = atomic_load(prev)) {
+        if (hash_table_key_compare(&ptr->data.key, &data_ptr->key) == 0)
+            break;
+    }
+    if (ptr != NULL) {
+        atomic_store(&node->next, atomic_load(&ptr->next));
+        atomic_store(prev, node);
+        pthread_mutex_unlock(stripe);
+        hash_table_retire(ht, ptr);
+        return;
+    }
+    prev = &array->hash_list[(unsigned long)hash & array->mask];
+    atomic_store(&node->next, atomic_load(prev));
+    atomic_store(prev, node);
+    overload = (double)(atomic_fetch_add(&ht->size, 1) + 1) > (double)array->capacity * ht->load_factor;
+    pthread_mutex_unlock(stripe);
+    if (overload)
+        hash_table_rehash(ht);
+}
+
+void hash_table_delete(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    hash_table_hash_type hash;
+    pthread_mutex_t *stripe = NULL;
+    hash_table_bucket_array *array = NULL;
+    _Atomic(hash_table_list_node *) *prev = NULL;
+    hash_table_list_node *ptr = NULL;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    hash = hash_table_get_hash(ht, key_ptr);
+    stripe = hash_table_get_stripe(ht, hash);
+    pthread_mutex_lock(stripe);
+    array = atomic_load(&ht->array);
+    prev = &array->hash_list[(unsigned long)hash & array->mask];
+    for (ptr = atomic_load(prev); ptr != NULL; prev = &ptr->next, ptr = atomic_load(prev)) {
+        if (hash_table_key_compare(&ptr->data.key, key_ptr) == 0)
+            break;
+    }
+    if (ptr == NULL) {
+        pthread_mutex_unlock(stripe);
+        return;
+    }
+    atomic_store(prev, atomic_load(&ptr->next));
+    atomic_fetch_sub(&ht->size, 1);
+    pthread_mutex_unlock(stripe);
+    hash_table_retire(ht, ptr);
+}
+
+void hash_table_clear(hash_table *ht)
+{
+    unsigned long i;
+    hash_table_bucket_array *array = NULL;
+    hash_table_list_node *ptr = NULL;
+    hash_table_list_node *tmp = NULL;
+    assert(ht != NULL);
+    array = atomic_load(&ht->array);
+    for (i = 0; i < array->capacity; ++i) {
+        for (ptr = atomic_load(&array->hash_list[i]); ptr != NULL; ptr = tmp) {
+            tmp = atomic_load(&ptr->next);
+            free(ptr);
+        }
+        atomic_store(&array->hash_list[i], NULL);
+    }
+    for (i = 0; i < ht->retired_size; ++i)
+        free(ht->retired[i].ptr);
+    ht->retired_size = 0;
+    atomic_store(&ht->size, 0);
+}
+
+void hash_table_destroy(hash_table *ht)
+{
+    unsigned long i;
+    assert(ht != NULL);
+    hash_table_clear(ht);
+    free(atomic_load(&ht->array));
+    atomic_store(&ht->array, NULL);
+    free(ht->retired);
+    ht->retired = NULL;
+    ht->retired_capacity = 0;
+    for (i = 0; i < HASH_TABLE_STRIPES; ++i)
+        pthread_mutex_destroy(&ht->stripe[i].mutex);
+    pthread_mutex_destroy(&ht->retire_mutex);
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef __HASH_TABLE_H__
+#define __HASH_TABLE_H__
+
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Writers serialize on one of HASH_TABLE_STRIPES locks chosen by hash; readers never lock.
+// Unlinked nodes and bucket arrays are freed once no reader slot can still hold them.
+#define HASH_TABLE_STRIPES 64
+#define HASH_TABLE_EPOCH_SLOTS 128
+#define HASH_TABLE_CACHE_LINE 64
+
+typedef int hash_table_key_type;
+typedef int hash_table_val_type;
+typedef unsigned long long hash_table_hash_type;
+typedef hash_table_hash_type (*hash_table_hash_func_type)(const hash_table_key_type *, hash_table_hash_type);
+typedef struct HashTableDataNode
+{
+    hash_table_key_type key;
+    hash_table_val_type val;
+} hash_table_data_type;
+typedef struct HashTableListNode
+{
+    hash_table_data_type data;
+    _Atomic(struct HashTableListNode *) next;
+} hash_table_list_node;
+typedef struct HashTableBucketArray
+{
+    unsigned long capacity;
+    unsigned long mask;
+    _Atomic(hash_table_list_node *) hash_list[];
+} hash_table_bucket_array;
+typedef union HashTableStripe
+{
+    pthread_mutex_t mutex;
+    char pad[HASH_TABLE_CACHE_LINE];
+} hash_table_stripe;
+typedef union HashTableEpochSlot
+{
+    atomic_ulong epoch;
+    char pad[HASH_TABLE_CACHE_LINE];
+} hash_table_epoch_slot;
+typedef struct HashTableRetired
+{
+    void *ptr;
+    unsigned long epoch;
+} hash_table_retired;
+typedef struct HashTable
+{
+    _Atomic(hash_table_bucket_array *) array;
+    hash_table_stripe stripe[HASH_TABLE_STRIPES];
+    hash_table_epoch_slot slot[HASH_TABLE_EPOCH_SLOTS];
+    atomic_ulong epoch;
+    atomic_ulong size;
+    pthread_mutex_t retire_mutex;
+    hash_table_retired *retired;
+    unsigned long retired_size;
+    unsigned long retired_capacity;
+    double load_factor;
+    hash_table_hash_func_type hash_func;
+    hash_table_hash_type seed;
+} hash_table;
+
+hash_table_hash_type hash_table_default_hash(const hash_table_key_type *, hash_table_hash_type);
+void hash_table_init(hash_table *, double);
+void hash_table_init_with_hash(hash_table *, double, hash_table_hash_func_type);
+unsigned long hash_table_size(hash_table *);
+unsigned long hash_table_capacity(hash_table *);
+int hash_table_empty(hash_table *);
+int hash_table_find(hash_table *, const hash_table_key_type *, hash_table_val_type *);
+void hash_table_insert(hash_table *, const hash_table_data_type *);
+void hash_table_delete(hash_table *, const hash_table_key_type *);
+void hash_table_clear(hash_table *);
+void hash_table_destroy(hash_table *);
+
+#endif // __HASH_TABLE_H__
\ No newline at end of file
@@ -0,0 +1,555 @@
+#include "hash_table.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <sched.h>
+
+// A slot word keeps the state in its high 32 bits and the key in its low 32 bits.
+// Frozen states mark slots that a resize has already copied into the next array.
+#define HASH_TABLE_STATE_EMPTY 0u
+#define HASH_TABLE_STATE_RESERVED 1u
+#define HASH_TABLE_STATE_LIVE 2u
+#define HASH_TABLE_STATE_DEAD 3u
+#define HASH_TABLE_STATE_FROZEN 4u
+#define HASH_TABLE_STATE_FROZEN_DEAD 5u
+#define HASH_TABLE_STATE_FROZEN_EMPTY 6u
+#define HASH_TABLE_MIN_CAPACITY 16
+#define HASH_TABLE_MIGRATE_CHUNK 1024
+
+_Static_assert(sizeof(hash_table_key_type) <= sizeof(unsigned int), "hash_table_key_type must fit in 32 bits");
+
+static hash_table_hash_type hash_table_mix(hash_table_hash_type);
+static hash_table_hash_type hash_table_random_seed(const hash_table *);
+static hash_table_slot_type hash_table_make_slot(unsigned int, const hash_table_key_type *);
+static unsigned int hash_table_slot_state(hash_table_slot_type);
+static hash_table_key_type hash_table_slot_key(hash_table_slot_type);
+static int hash_table_slot_match(hash_table_slot_type, const hash_table_key_type *);
+static hash_table_array *hash_table_array_create(unsigned long);
+static void hash_table_array_destroy(hash_table_array *);
+static int hash_table_overload(const hash_table *, hash_table_array *);
+static hash_table_hash_type hash_table_get_hash(const hash_table *, const hash_table_key_type *);
+static unsigned long hash_table_get_address(const hash_table_array *, hash_table_hash_type);
+static unsigned long linear_probing(const hash_table_array *, unsigned long);
+static void hash_table_place(hash_table *, hash_table_array *, const hash_table_key_type *, hash_table_val_type);
+static void hash_table_migrate_slot(hash_table *, hash_table_array *, hash_table_array *, unsigned long);
+static void hash_table_start_resize(hash_table *, hash_table_array *);
+static void hash_table_help_resize(hash_table *, hash_table_array *);
+static unsigned long hash_table_pin(hash_table *);
+static void hash_table_unpin(hash_table *, unsigned long);
+static void hash_table_retire_push(hash_table *, hash_table_array *);
+static void hash_table_reclaim(hash_table *);
+static void hash_table_retire(hash_table *, hash_table_array *);
+static int hash_table_pinned_find(hash_table *, const hash_table_key_type *, hash_table_val_type *);
+static void hash_table_pinned_insert(hash_table *, const hash_table_data_type *);
+static void hash_table_pinned_delete(hash_table *, const hash_table_key_type *);
+
+static _Thread_local unsigned long hash_table_slot_hint = HASH_TABLE_EPOCH_SLOTS;
+
+static inline hash_table_hash_type hash_table_mix(hash_table_hash_type hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static hash_table_hash_type hash_table_random_seed(const hash_table *ht)
+{
+    static atomic_ulong counter = 0;
+    hash_table_hash_type ret = (hash_table_hash_type)time(NULL);
+    ret ^= hash_table_mix((hash_table_hash_type)(size_t)ht + (atomic_fetch_add(&counter, 1) + 1) * 0x9e3779b97f4a7c15ULL);
+    ret ^= hash_table_mix((hash_table_hash_type)clock());
+    return hash_table_mix(ret);
+}
+
+hash_table_hash_type hash_table_default_hash(const hash_table_key_type *key_ptr, hash_table_hash_type seed)
+{
+    assert(key_ptr != NULL);
+    return hash_table_mix((hash_table_hash_type)(unsigned int)*key_ptr ^ seed);
+}
+
+static inline hash_table_slot_type hash_table_make_slot(unsigned int state, const hash_table_key_type *key_ptr)
+{
+    assert(key_ptr != NULL);
+    return (hash_table_slot_type)state << 32 | (hash_table_slot_type)(unsigned int)*key_ptr;
+}
+
+static inline unsigned int hash_table_slot_state(hash_table_slot_type slot)
+{
+    return (unsigned int)(slot >> 32);
+}
+
+static inline hash_table_key_type hash_table_slot_key(hash_table_slot_type slot)
+{
+    return (hash_table_key_type)(unsigned int)slot;
+}
+
+static inline int hash_table_slot_match(hash_table_slot_type slot, const hash_table_key_type *key_ptr)
+{
+    assert(key_ptr != NULL);
+    return (unsigned int)slot == (unsigned int)*key_ptr;
+}
+
+static hash_table_array *hash_table_array_create(unsigned long capacity)
+{
+    hash_table_array *array = (hash_table_array *)malloc(sizeof(hash_table_array));
+    assert(array != NULL);
+    array->slot = (_Atomic hash_table_slot_type *)calloc(capacity, sizeof(hash_table_slot_type));
+    assert(array->slot != NULL);
+    array->val = (_Atomic hash_table_val_type *)calloc(capacity, sizeof(hash_table_val_type));
+    assert(array->val != NULL);
+    array->capacity = capacity;
+    array->mask = capacity - 1;
+    atomic_init(&array->used, 0);
+    atomic_init(&array->next, NULL);
+    atomic_init(&array->migrate_pos, 0);
+    atomic_init(&array->migrated, 0);
+    array->retired_next = NULL;
+    return array;
+}
+
+static inline void hash_table_array_destroy(hash_table_array *array)
+{
+    assert(array != NULL);
+    free((void *)array->slot);
+    free((void *)array->val);
+    free(array);
+}
+
+inline void hash_table_init(hash_table *ht, double init_load_factor)
+{
+    hash_table_init_with_hash(ht, init_load_factor, hash_table_default_hash);
+}
+
+void hash_table_init_with_hash(hash_table *ht, double init_load_factor, hash_table_hash_func_type hash_func)
+{
+    unsigned long i;
+    unsigned long capacity = HASH_TABLE_MIN_CAPACITY;
+    assert(ht != NULL);
+    assert(init_load_factor > 0);
+    assert(init_load_factor < 1);
+    while ((double)capacity * init_load_factor < 1)
+        capacity <<= 1;
+    atomic_init(&ht->array, hash_table_array_create(capacity));
+    atomic_init(&ht->retired, NULL);
+    for (i = 0; i < HASH_TABLE_EPOCH_SLOTS; ++i)
+        atomic_init(&ht->slot[i].epoch, 0);
+    atomic_init(&ht->epoch, 1);
+    atomic_init(&ht->size, 0);
+    ht->load_factor = init_load_factor;
+    ht->hash_func = hash_func != NULL ? hash_func : hash_table_default_hash;
+    ht->seed = hash_table_random_seed(ht);
+}
+
+unsigned long hash_table_capacity(hash_table *ht)
+{
+    unsigned long ret;
+    unsigned long slot;
+    assert(ht != NULL);
+    slot = hash_table_pin(ht);
+    ret = atomic_load(&ht->array)->capacity;
+    hash_table_unpin(ht, slot);
+    return ret;
+}
+
+inline unsigned long hash_table_size(hash_table *ht)
+{
+    assert(ht != NULL);
+    return atomic_load(&ht->size);
+}
+
+inline int hash_table_empty(hash_table *ht)
+{
+    assert(ht != NULL);
+    return atomic_load(&ht->size) == 0;
+}
+
+static inline int hash_table_overload(const hash_table *ht, hash_table_array *array)
+{
+    assert(ht != NULL);
+    assert(array != NULL);
+    return (double)(atomic_load(&array->used) + 1) > (double)array->capacity * ht->load_factor;
+}
+
+static inline hash_table_hash_type hash_table_get_hash(const hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    return ht->hash_func(key_ptr, ht->seed);
+}
+
+static inline unsigned long hash_table_get_address(const hash_table_array *array, hash_table_hash_type hash)
+{
+    assert(array != NULL);
+    return (unsigned long)hash & array->mask;
+}
+
+static inline unsigned long linear_probing(const hash_table_array *array, unsigned long addr)
+{
+    assert(array != NULL);
+    return (addr + 1) & array->mask;
+}
+
+static void hash_table_place(hash_table *ht, hash_table_array *array, const hash_table_key_type *key_ptr, hash_table_val_type val)
+{
+    hash_table_slot_type empty;
+    unsigned long addr;
+    assert(ht != NULL);
+    assert(array != NULL);
+    assert(key_ptr != NULL);
+    addr = hash_table_get_address(array, hash_table_get_hash(ht, key_ptr));
+    for (;;) {
+        empty = 0;
+        if (atomic_compare_exchange_strong(&array->slot[addr], &empty, hash_table_make_slot(HASH_TABLE_STATE_LIVE, key_ptr)))
+            break;
+        addr = linear_probing(array, addr);
+    }
+    atomic_store(&array->val[addr], val);
+    atomic_fetch_add(&array->used, 1);
+}
+
+static void hash_table_migrate_slot(hash_table *ht, hash_table_array *array, hash_table_array *next, unsigned long addr)
+{
+    hash_table_slot_type slot;
+    hash_table_key_type key;
+    unsigned int state;
+    assert(ht != NULL);
+    assert(array != NULL);
+    assert(next != NULL);
+    for (;;) {
+        slot = atomic_load(&array->slot[addr]);
+        state = hash_table_slot_state(slot);
+        key = hash_table_slot_key(slot);
+        if (state == HASH_TABLE_STATE_RESERVED) {
+            sched_yield();
+            continue;
+        }
+        if (state == HASH_TABLE_STATE_EMPTY) {
+            if (atomic_compare_exchange_strong(&array->slot[addr], &slot, hash_table_make_slot(HASH_TABLE_STATE_FROZEN_EMPTY, &key)))
+                return;
+            continue;
+        }
+        if (state == HASH_TABLE_STATE_DEAD) {
+            if (atomic_compare_exchange_strong(&array->slot[addr], &slot, hash_table_make_slot(HASH_TABLE_STATE_FROZEN_DEAD, &key)))
+                return;
+            continue;
+        }
+        assert(state == HASH_TABLE_STATE_LIVE);
+        if (atomic_compare_exchange_strong(&array->slot[addr], &slot, hash_table_make_slot(HASH_TABLE_STATE_FROZEN, &key))) {
+            hash_table_place(ht, next, &key, atomic_load(&array->val[addr]));
+            return;
+        }
+    }
+}
+
+static void hash_table_start_resize(hash_table *ht, hash_table_array *array)
+{
+    hash_table_array *next;
+    hash_table_array *expected = NULL;
+    unsigned long capacity;
+    assert(ht != NULL);
+    assert(array != NULL);
+    if (atomic_load(&array->next) != NULL)
+        return;
+    capacity = array->capacity;
+    if (atomic_load(&ht->size) * 2 >= atomic_load(&array->used))
+        capacity <<= 1;
+    next = hash_table_array_create(capacity);
+    if (!atomic_compare_exchange_strong(&array->next, &expected, next))
+        hash_table_array_destroy(next);
+}
+
+static void hash_table_help_resize(hash_table *ht, hash_table_array *array)
+{
+    hash_table_array *next;
+    hash_table_array *expected = array;
+    unsigned long chunks, chunk, addr, end;
+    assert(ht != NULL);
+    assert(array != NULL);
+    next = atomic_load(&array->next);
+    assert(next != NULL);
+    chunks = (array->capacity + HASH_TABLE_MIGRATE_CHUNK - 1) / HASH_TABLE_MIGRATE_CHUNK;
+    while ((chunk = atomic_fetch_add(&array->migrate_pos, 1)) < chunks) {
+        end = (chunk + 1) * HASH_TABLE_MIGRATE_CHUNK;
+        if (end > array->capacity)
+            end = array->capacity;
+        for (addr = chunk * HASH_TABLE_MIGRATE_CHUNK; addr < end; ++addr)
+            hash_table_migrate_slot(ht, array, next, addr);
+        atomic_fetch_add(&array->migrated, 1);
+    }
+    while (atomic_load(&array->migrated) < chunks)
+        sched_yield();
+    if (atomic_compare_exchange_strong(&ht->array, &expected, next))
+        hash_table_retire(ht, array);
+}
+
+static unsigned long hash_table_pin(hash_table *ht)
+{
+    unsigned long i;
+    unsigned long expected;
+    assert(ht != NULL);
+    if (hash_table_slot_hint >= HASH_TABLE_EPOCH_SLOTS)
+        hash_table_slot_hint = (unsigned long)(hash_table_mix((hash_table_hash_type)(size_t)&hash_table_slot_hint) % HASH_TABLE_EPOCH_SLOTS);
+    for (i = hash_table_slot_hint;; i = (i + 1) % HASH_TABLE_EPOCH_SLOTS) {
+        expected = 0;
+        if (atomic_compare_exchange_strong(&ht->slot[i].epoch, &expected, atomic_load(&ht->epoch)))
+            break;
+        if ((i + 1) % HASH_TABLE_EPOCH_SLOTS == hash_table_slot_hint)
+            sched_yield();
+    }
+    hash_table_slot_hint = i;
+    return i;
+}
+
+static inline void hash_table_unpin(hash_table *ht, unsigned long slot)
+{
+    assert(ht != NULL);
+    atomic_store(&ht->slot[slot].epoch, 0);
+}
+
+static void hash_table_retire_push(hash_table *ht, hash_table_array *array)
+{
+    assert(ht != NULL);
+    assert(array != NULL);
+    array->retired_next = atomic_load(&ht->retired);
+    while (!atomic_compare_exchange_weak(&ht->retired, &array->retired_next, array))
+        ;
+}
+
+// Takes the whole retired list, so concurrent reclaims never see the same array, and pushes back what is still pinned.
+static void hash_table_reclaim(hash_table *ht)
+{
+    unsigned long i;
+    unsigned long epoch;
+    unsigned long safe;
+    hash_table_array *array;
+    hash_table_array *next;
+    assert(ht != NULL);
+    safe = atomic_fetch_add(&ht->epoch, 1);
+    for (i = 0; i < HASH_TABLE_EPOCH_SLOTS; ++i) {
+        epoch = atomic_load(&ht->slot[i].epoch);
+        if (epoch && epoch < safe)
+            safe = epoch;
+    }
+    for (array = atomic_exchange(&ht->retired, NULL); array != NULL; array = next) {
+        next = array->retired_next;
+        if (array->retired_epoch < safe)
+            hash_table_array_destroy(array);
+        else
+            hash_table_retire_push(ht, array);
+    }
+}
+
+static void hash_table_retire(hash_table *ht, hash_table_array *array)
+{
+    assert(ht != NULL);
+    assert(array != NULL);
+    array->retired_epoch = atomic_load(&ht->epoch);
+    hash_table_retire_push(ht, array);
+    hash_table_reclaim(ht);
+}
+
+int hash_table_find(hash_table *ht, const hash_table_key_type *key_ptr, hash_table_val_type *val_ptr)
+{
+    int ret;
+    unsigned long slot;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    slot = hash_table_pin(ht);
+    ret = hash_table_pinned_find(ht, key_ptr, val_ptr);
+    hash_table_unpin(ht, slot);
+    return ret;
+}
+
+void hash_table_insert(hash_table *ht, const hash_table_data_type *data_ptr)
+{
+    unsigned long slot;
+    assert(ht != NULL);
+    assert(data_ptr != NULL);
+    slot = hash_table_pin(ht);
+    hash_table_pinned_insert(ht, data_ptr);
+    hash_table_unpin(ht, slot);
+}
+
+void hash_table_delete(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    unsigned long slot;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    slot = hash_table_pin(ht);
+    hash_table_pinned_delete(ht, key_ptr);
+    hash_table_unpin(ht, slot);
+}
+
+static int hash_table_pinned_find(hash_table *ht, const hash_table_key_type *key_ptr, hash_table_val_type *val_ptr)
+{
+    hash_table_array *array;
+    hash_table_slot_type slot;
+    hash_table_hash_type hash;
+    hash_table_val_type val = 0;
+    unsigned long addr, probe;
+    unsigned int state;
+    int found;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    hash = hash_table_get_hash(ht, key_ptr);
+    for (;;) {
+        array = atomic_load(&ht->array);
+        addr = hash_table_get_address(array, hash);
+        found = 0;
+        for (probe = 0; probe < array->capacity; ++probe) {
+            slot = atomic_load(&array->slot[addr]);
+            state = hash_table_slot_state(slot);
+            if (state == HASH_TABLE_STATE_EMPTY || state == HASH_TABLE_STATE_FROZEN_EMPTY)
+                break;
+            if (hash_table_slot_match(slot, key_ptr)) {
+                if (state == HASH_TABLE_STATE_LIVE || state == HASH_TABLE_STATE_FROZEN) {
+                    val = atomic_load(&array->val[addr]);
+                    found = 1;
+                }
+                break;
+            }
+            addr = linear_probing(array, addr);
+        }
+        if (atomic_load(&ht->array) == array)
+            break;
+    }
+    if (found && val_ptr != NULL)
+        *val_ptr = val;
+    return found;
+}
+
+static void hash_table_pinned_insert(hash_table *ht, const hash_table_data_type *data_ptr)
+{
+    hash_table_array *array;
+    hash_table_slot_type slot;
+    hash_table_hash_type hash;
+    unsigned long addr, probe;
+    unsigned int state;
+    assert(ht != NULL);
+    assert(data_ptr != NULL);
+    hash = hash_table_get_hash(ht, &data_ptr->key);
+    for (;;) {
+        array = atomic_load(&ht->array);
+        if (atomic_load(&array->next) != NULL) {
+            hash_table_help_resize(ht, array);
+            continue;
+        }
+        addr = hash_table_get_address(array, hash);
+        for (probe = 0; probe < array->capacity;) {
+            slot = atomic_load(&array->slot[addr]);
+            state = hash_table_slot_state(slot);
+            if (state >= HASH_TABLE_STATE_FROZEN)
+                break;
+            if (state == HASH_TABLE_STATE_EMPTY) {
+                if (hash_table_overload(ht, array))
+                    break;
+                if (atomic_compare_exchange_strong(&array->slot[addr], &slot, hash_table_make_slot(HASH_TABLE_STATE_RESERVED, &data_ptr->key))) {
+                    atomic_fetch_add(&array->used, 1);
+                    atomic_store(&array->val[addr], data_ptr->val);
+                    atomic_store(&array->slot[addr], hash_table_make_slot(HASH_TABLE_STATE_LIVE, &data_ptr->key));
+                    atomic_fetch_add(&ht->size, 1);
+                    return;
+                }
+                continue;
+            }
+            if (!hash_table_slot_match(slot, &data_ptr->key)) {
+                addr = linear_probing(array, addr);
+                ++probe;
+                continue;
+            }
+            if (state == HASH_TABLE_STATE_RESERVED) {
+                sched_yield();
+                continue;
+            }
+            if (state == HASH_TABLE_STATE_LIVE) {
+                atomic_store(&array->val[addr], data_ptr->val);
+                if (hash_table_slot_state(atomic_load(&array->slot[addr])) == HASH_TABLE_STATE_LIVE)
+                    return;
+                continue;
+            }
+            if (atomic_compare_exchange_strong(&array->slot[addr], &slot, hash_table_make_slot(HASH_TABLE_STATE_RESERVED, &data_ptr->key))) {
+                atomic_store(&array->val[addr], data_ptr->val);
+                atomic_store(&array->slot[addr], hash_table_make_slot(HASH_TABLE_STATE_LIVE, &data_ptr->key));
+                atomic_fetch_add(&ht->size, 1);
+                return;
+            }
+        }
+        hash_table_start_resize(ht, array);
+        hash_table_help_resize(ht, array);
+    }
+}
+
+static void hash_table_pinned_delete(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    hash_table_array *array;
+    hash_table_slot_type slot;
+    hash_table_hash_type hash;
+    unsigned long addr, probe;
+    unsigned int state;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    hash = hash_table_get_hash(ht, key_ptr);
+    for (;;) {
+        array = atomic_load(&ht->array);
+        if (atomic_load(&array->next) != NULL) {
+            hash_table_help_resize(ht, array);
+            continue;
+        }
+        addr = hash_table_get_address(array, hash);
+        for (probe = 0; probe < array->capacity;) {
+            slot = atomic_load(&array->slot[addr]);
+            state = hash_table_slot_state(slot);
+            if (state >= HASH_TABLE_STATE_FROZEN)
+                break;
+            if (state == HASH_TABLE_STATE_EMPTY)
+                return;
+            if (!hash_table_slot_match(slot, key_ptr)) {
+                addr = linear_probing(array, addr);
+                ++probe;
+                continue;
+            }
+            if (state == HASH_TABLE_STATE_RESERVED) {
+                sched_yield();
+                continue;
+            }
+            if (state == HASH_TABLE_STATE_DEAD)
+                return;
+            if (atomic_compare_exchange_strong(&array->slot[addr], &slot, hash_table_make_slot(HASH_TABLE_STATE_DEAD, key_ptr))) {
+                atomic_fetch_sub(&ht->size, 1);
+                return;
+            }
+        }
+        if (probe == array->capacity)
+            return;
+        hash_table_help_resize(ht, array);
+    }
+}
+
+void hash_table_clear(hash_table *ht)
+{
+    hash_table_array *array;
+    hash_table_array *retired;
+    unsigned long addr;
+    assert(ht != NULL);
+    array = atomic_load(&ht->array);
+    assert(atomic_load(&array->next) == NULL);
+    for (addr = 0; addr < array->capacity; ++addr)
+        atomic_store_explicit(&array->slot[addr], 0, memory_order_relaxed);
+    atomic_store(&array->used, 0);
+    atomic_store(&ht->size, 0);
+    while ((retired = atomic_load(&ht->retired)) != NULL) {
+        atomic_store(&ht->retired, retired->retired_next);
+        hash_table_array_destroy(retired);
+    }
+}
+
+inline void hash_table_destroy(hash_table *ht)
+{
+    assert(ht != NULL);
+    hash_table_clear(ht);
+    hash_table_array_destroy(atomic_load(&ht->array));
+    atomic_store(&ht->array, NULL);
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef __HASH_TABLE_H__
+#define __HASH_TABLE_H__
+
+#include <stdatomic.h>
+
+// Keys are packed into the low 32 bits of a slot word next to the slot state, so they must fit in 32 bits.
+// Every operation pins an epoch slot; arrays replaced by a resize are freed once no pinned operation can still hold them.
+#define HASH_TABLE_EPOCH_SLOTS 128
+#define HASH_TABLE_CACHE_LINE 64
+
+typedef int hash_table_key_type;
+typedef int hash_table_val_type;
+typedef unsigned long long hash_table_hash_type;
+typedef hash_table_hash_type (*hash_table_hash_func_type)(const hash_table_key_type *, hash_table_hash_type);
+typedef unsigned long long hash_table_slot_type;
+typedef struct HashTableDataNode
+{
+    hash_table_key_type key;
+    hash_table_val_type val;
+} hash_table_data_type;
+typedef struct HashTableArray
+{
+    _Atomic hash_table_slot_type *slot;
+    _Atomic hash_table_val_type *val;
+    unsigned long capacity;
+    unsigned long mask;
+    atomic_ulong used;
+    _Atomic(struct HashTableArray *) next;
+    atomic_ulong migrate_pos;
+    atomic_ulong migrated;
+    struct HashTableArray *retired_next;
+    unsigned long retired_epoch;
+} hash_table_array;
+typedef union HashTableEpochSlot
+{
+    atomic_ulong epoch;
+    char pad[HASH_TABLE_CACHE_LINE];
+} hash_table_epoch_slot;
+typedef struct HashTable
+{
+    _Atomic(hash_table_array *) array;
+    _Atomic(hash_table_array *) retired;
+    hash_table_epoch_slot slot[HASH_TABLE_EPOCH_SLOTS];
+    atomic_ulong epoch;
+    atomic_ulong size;
+    double load_factor;
+    hash_table_hash_func_type hash_func;
+    hash_table_hash_type seed;
+} hash_table;
+
+hash_table_hash_type hash_table_default_hash(const hash_table_key_type *, hash_table_hash_type);
+void hash_table_init(hash_table *, double);
+void hash_table_init_with_hash(hash_table *, double, hash_table_hash_func_type);
+unsigned long hash_table_size(hash_table *);
+unsigned long hash_table_capacity(hash_table *);
+int hash_table_empty(hash_table *);
+int hash_table_find(hash_table *, const hash_table_key_type *, hash_table_val_type *);
+void hash_table_insert(hash_table *, const hash_table_data_type *);
+void hash_table_delete(hash_table *, const hash_table_key_type *);
+void hash_table_clear(hash_table *);
+void hash_table_destroy(hash_table *);
+
+#endif // __HASH_TABLE_H__
\ No newline at end of file
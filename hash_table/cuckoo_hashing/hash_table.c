@@ -0,0 +1,394 @@
+#include "hash_table.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#define HASH_TABLE_CTRL_EMPTY ((hash_table_ctrl_type)-128)
+#define HASH_TABLE_MIN_BUCKET_COUNT 2
+#define HASH_TABLE_MAX_KICKS 500
+
+static int hash_table_key_compare(const hash_table_key_type *, const hash_table_key_type *);
+static void hash_table_val_copy(hash_table_val_type *, const hash_table_val_type *);
+static void hash_table_data_copy(hash_table_data_type *, const hash_table_data_type *);
+static void hash_table_data_swap(hash_table_data_type *, hash_table_data_type *);
+static hash_table_hash_type hash_table_mix(hash_table_hash_type);
+static hash_table_hash_type hash_table_random_seed(const hash_table *);
+static unsigned long hash_table_random(hash_table *);
+static int hash_table_overload(const hash_table *);
+static hash_table_hash_type hash_table_get_hash(const hash_table *, const hash_table_key_type *);
+static unsigned long hash_table_get_address(const hash_table *, hash_table_hash_type);
+static unsigned long hash_table_get_alternate(const hash_table *, hash_table_hash_type);
+static hash_table_ctrl_type hash_table_get_fragment(hash_table_hash_type);
+static hash_table_data_type *hash_table_bucket_find(hash_table_bucket *, const hash_table_key_type *, hash_table_ctrl_type);
+static int hash_table_bucket_place(hash_table_bucket *, const hash_table_data_type *, hash_table_ctrl_type);
+static int hash_table_place(hash_table *, hash_table_data_type *, hash_table_hash_type);
+static void hash_table_allocate(hash_table *, unsigned long);
+static void hash_table_resize(hash_table *, unsigned long);
+static void hash_table_unstash(hash_table *, unsigned long);
+static hash_table_data_type *hash_table_lookup(hash_table *, const hash_table_key_type *, hash_table_hash_type);
+
+static inline int hash_table_key_compare(const hash_table_key_type *lhs, const hash_table_key_type *rhs)
+{
+    assert(lhs != NULL);
+    assert(rhs != NULL);
+    if (*lhs < *rhs)
+        return -1;
+    if (*lhs > *rhs)
+        return 1;
+    return 0;
+}
+
+static inline void hash_table_val_copy(hash_table_val_type *dest, const hash_table_val_type *source)
+{
+    assert(dest != NULL);
+    assert(source != NULL);
+    *dest = *source;
+}
+
+static inline void hash_table_data_copy(hash_table_data_type *dest, const hash_table_data_type *source)
+{
+    assert(dest != NULL);
+    assert(source != NULL);
+    dest->key = source->key;
+    hash_table_val_copy(&dest->val, &source->val);
+}
+
+static inline void hash_table_data_swap(hash_table_data_type *lhs, hash_table_data_type *rhs)
+{
+    hash_table_data_type tmp;
+    assert(lhs != NULL);
+    assert(rhs != NULL);
+    hash_table_data_copy(&tmp, lhs);
+    hash_table_data_copy(lhs, rhs);
+    hash_table_data_copy(rhs, &tmp);
+}
+
+static inline hash_table_hash_type hash_table_mix(hash_table_hash_type hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static hash_table_hash_type hash_table_random_seed(const hash_table *ht)
+{
+    static hash_table_hash_type counter = 0;
+    hash_table_hash_type ret = (hash_table_hash_type)time(NULL);
+    ret ^= hash_table_mix((hash_table_hash_type)(size_t)ht + ++counter * 0x9e3779b97f4a7c15ULL);
+    ret ^= hash_table_mix((hash_table_hash_type)clock());
+    return hash_table_mix(ret);
+}
+
+static inline unsigned long hash_table_random(hash_table *ht)
+{
+    assert(ht != NULL);
+    ht->random ^= ht->random << 13;
+    ht->random ^= ht->random >> 7;
+    ht->random ^= ht->random << 17;
+    return (unsigned long)(ht->random >> 32);
+}
+
+hash_table_hash_type hash_table_default_hash(const hash_table_key_type *key_ptr, hash_table_hash_type seed)
+{
+    assert(key_ptr != NULL);
+    return hash_table_mix((hash_table_hash_type)(unsigned int)*key_ptr ^ seed);
+}
+
+inline void hash_table_init(hash_table *ht, double init_load_factor)
+{
+    hash_table_init_with_hash(ht, init_load_factor, hash_table_default_hash);
+}
+
+void hash_table_init_with_hash(hash_table *ht, double init_load_factor, hash_table_hash_func_type hash_func)
+{
+    assert(ht != NULL);
+    assert(init_load_factor > 0);
+    assert(init_load_factor < 1);
+    ht->bucket = NULL;
+    ht->memory = NULL;
+    ht->stash_size = ht->bucket_count = ht->capacity = ht->size = 0;
+    ht->load_factor = init_load_factor;
+    ht->hash_func = hash_func != NULL ? hash_func : hash_table_default_hash;
+    ht->seed = hash_table_random_seed(ht);
+    ht->random = ht->seed | 1;
+}
+
+inline unsigned long hash_table_capacity(const hash_table *ht)
+{
+    assert(ht != NULL);
+    return ht->capacity;
+}
+
+inline unsigned long hash_table_size(const hash_table *ht)
+{
+    assert(ht != NULL);
+    return ht->size;
+}
+
+inline int hash_table_empty(const hash_table *ht)
+{
+    assert(ht != NULL);
+    return ht->size == 0;
+}
+
+static inline int hash_table_overload(const hash_table *ht)
+{
+    assert(ht != NULL);
+    return ht->capacity == 0 || (double)(ht->size + 1) > (double)ht->capacity * ht->load_factor;
+}
+
+static inline hash_table_hash_type hash_table_get_hash(const hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    return ht->hash_func(key_ptr, ht->seed);
+}
+
+static inline unsigned long hash_table_get_address(const hash_table *ht, hash_table_hash_type hash)
+{
+    assert(ht != NULL);
+    return (unsigned long)hash & ht->mask;
+}
+
+static inline unsigned long hash_table_get_alternate(const hash_table *ht, hash_table_hash_type hash)
+{
+    assert(ht != NULL);
+    return (unsigned long)(hash >> 32) & ht->mask;
+}
+
+static inline hash_table_ctrl_type hash_table_get_fragment(hash_table_hash_type hash)
+{
+    return (hash_table_ctrl_type)(hash >> 57);
+}
+
+static inline hash_table_data_type *hash_table_bucket_find(hash_table_bucket *bucket, const hash_table_key_type *key_ptr, hash_table_ctrl_type fragment)
+{
+    unsigned long i;
+    assert(bucket != NULL);
+    assert(key_ptr != NULL);
+    for (i = 0; i < HASH_TABLE_BUCKET_WIDTH; ++i) {
+        if (bucket->ctrl[i] == fragment && hash_table_key_compare(&bucket->data[i].key, key_ptr) == 0)
+            return &bucket->data[i];
+    }
+    return NULL;
+}
+
+static inline int hash_table_bucket_place(hash_table_bucket *bucket, const hash_table_data_type *data_ptr, hash_table_ctrl_type fragment)
+{
+    unsigned long i;
+    assert(bucket != NULL);
+    assert(data_ptr != NULL);
+    for (i = 0; i < HASH_TABLE_BUCKET_WIDTH; ++i) {
+        if (bucket->ctrl[i] == HASH_TABLE_CTRL_EMPTY) {
+            bucket->ctrl[i] = fragment;
+            hash_table_data_copy(&bucket->data[i], data_ptr);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int hash_table_place(hash_table *ht, hash_table_data_type *data_ptr, hash_table_hash_type hash)
+{
+    unsigned long i;
+    unsigned long addr;
+    unsigned long slot;
+    hash_table_ctrl_type fragment;
+    assert(ht != NULL);
+    assert(data_ptr != NULL);
+    fragment = hash_table_get_fragment(hash);
+    addr = hash_table_get_address(ht, hash);
+    if (hash_table_bucket_place(&ht->bucket[addr], data_ptr, fragment))
+        return 1;
+    if (hash_table_bucket_place(&ht->bucket[hash_table_get_alternate(ht, hash)], data_ptr, fragment))
+        return 1;
+    if (hash_table_random(ht) & 1)
+        addr = hash_table_get_alternate(ht, hash);
+    for (i = 0; i < HASH_TABLE_MAX_KICKS; ++i) {
+        slot = hash_table_random(ht) % HASH_TABLE_BUCKET_WIDTH;
+        hash_table_data_swap(data_ptr, &ht->bucket[addr].data[slot]);
+        ht->bucket[addr].ctrl[slot] = fragment;
+        hash = hash_table_get_hash(ht, &data_ptr->key);
+        fragment = hash_table_get_fragment(hash);
+        addr = hash_table_get_address(ht, hash) == addr ? hash_table_get_alternate(ht, hash) : hash_table_get_address(ht, hash);
+        if (hash_table_bucket_place(&ht->bucket[addr], data_ptr, fragment))
+            return 1;
+    }
+    if (ht->stash_size == HASH_TABLE_STASH_SIZE)
+        return 0;
+    hash_table_data_copy(&ht->stash[ht->stash_size++], data_ptr);
+    return 1;
+}
+
+static void hash_table_allocate(hash_table *ht, unsigned long bucket_count)
+{
+    unsigned long i;
+    assert(ht != NULL);
+    ht->memory = malloc(bucket_count * sizeof(hash_table_bucket) + HASH_TABLE_CACHE_LINE - 1);
+    assert(ht->memory != NULL);
+    ht->bucket = (hash_table_bucket *)(((size_t)ht->memory + HASH_TABLE_CACHE_LINE - 1) & ~(size_t)(HASH_TABLE_CACHE_LINE - 1));
+    for (i = 0; i < bucket_count; ++i)
+        memset(ht->bucket[i].ctrl, HASH_TABLE_CTRL_EMPTY, sizeof(ht->bucket[i].ctrl));
+    ht->bucket_count = bucket_count;
+    ht->capacity = bucket_count * HASH_TABLE_BUCKET_WIDTH;
+    ht->mask = bucket_count - 1;
+    ht->stash_size = 0;
+}
+
+static void hash_table_resize(hash_table *ht, unsigned long new_bucket_count)
+{
+    unsigned long i;
+    unsigned long j;
+    int placed = 1;
+    hash_table old_table;
+    hash_table_data_type data;
+    assert(ht != NULL);
+    old_table = *ht;
+    for (;;) {
+        hash_table_allocate(ht, new_bucket_count);
+        for (i = 0; placed && i < old_table.bucket_count; ++i) {
+            for (j = 0; placed && j < HASH_TABLE_BUCKET_WIDTH; ++j) {
+                if (old_table.bucket[i].ctrl[j] == HASH_TABLE_CTRL_EMPTY)
+                    continue;
+                hash_table_data_copy(&data, &old_table.bucket[i].data[j]);
+                placed = hash_table_place(ht, &data, hash_table_get_hash(ht, &data.key));
+            }
+        }
+        for (i = 0; placed && i < old_table.stash_size; ++i) {
+            hash_table_data_copy(&data, &old_table.stash[i]);
+            placed = hash_table_place(ht, &data, hash_table_get_hash(ht, &data.key));
+        }
+        if (placed)
+            break;
+        free(ht->memory);
+        new_bucket_count <<= 1;
+        placed = 1;
+    }
+    free(old_table.memory);
+}
+
+static void hash_table_unstash(hash_table *ht, unsigned long addr)
+{
+    unsigned long i;
+    hash_table_hash_type hash;
+    assert(ht != NULL);
+    for (i = 0; i < ht->stash_size; ++i) {
+        hash = hash_table_get_hash(ht, &ht->stash[i].key);
+        if (hash_table_get_address(ht, hash) != addr && hash_table_get_alternate(ht, hash) != addr)
+            continue;
+        hash_table_bucket_place(&ht->bucket[addr], &ht->stash[i], hash_table_get_fragment(hash));
+        hash_table_data_copy(&ht->stash[i], &ht->stash[--ht->stash_size]);
+        return;
+    }
+}
+
+static hash_table_data_type *hash_table_lookup(hash_table *ht, const hash_table_key_type *key_ptr, hash_table_hash_type hash)
+{
+    unsigned long i;
+    hash_table_data_type *ptr = NULL;
+    hash_table_ctrl_type fragment;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    if (ht->capacity == 0)
+        return NULL;
+    fragment = hash_table_get_fragment(hash);
+    ptr = hash_table_bucket_find(&ht->bucket[hash_table_get_address(ht, hash)], key_ptr, fragment);
+    if (ptr != NULL)
+        return ptr;
+    ptr = hash_table_bucket_find(&ht->bucket[hash_table_get_alternate(ht, hash)], key_ptr, fragment);
+    if (ptr != NULL)
+        return ptr;
+    for (i = 0; i < ht->stash_size; ++i) {
+        if (hash_table_key_compare(&ht->stash[i].key, key_ptr) == 0)
+            return &ht->stash[i];
+    }
+    return NULL;
+}
+
+hash_table_val_type *hash_table_find(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    hash_table_data_type *ptr = NULL;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    ptr = hash_table_lookup(ht, key_ptr, hash_table_get_hash(ht, key_ptr));
+    return ptr != NULL ? &ptr->val : NULL;
+}
+
+void hash_table_insert(hash_table *ht, const hash_table_data_type *data_ptr)
+{
+    hash_table_data_type *ptr = NULL;
+    hash_table_data_type data;
+    hash_table_hash_type hash;
+    assert(ht != NULL);
+    assert(data_ptr != NULL);
+    hash = hash_table_get_hash(ht, &data_ptr->key);
+    ptr = hash_table_lookup(ht, &data_ptr->key, hash);
+    if (ptr != NULL) {
+        hash_table_val_copy(&ptr->val, &data_ptr->val);
+        return;
+    }
+    if (hash_table_overload(ht))
+        hash_table_resize(ht, ht->bucket_count ? ht->bucket_count << 1 : HASH_TABLE_MIN_BUCKET_COUNT);
+    hash_table_data_copy(&data, data_ptr);
+    while (!hash_table_place(ht, &data, hash)) {
+        hash_table_resize(ht, ht->bucket_count << 1);
+        hash = hash_table_get_hash(ht, &data.key);
+    }
+    ++ht->size;
+}
+
+void hash_table_delete(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    unsigned long i;
+    unsigned long addr;
+    hash_table_hash_type hash;
+    hash_table_ctrl_type fragment;
+    hash_table_data_type *ptr = NULL;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    if (ht->capacity == 0)
+        return;
+    hash = hash_table_get_hash(ht, key_ptr);
+    fragment = hash_table_get_fragment(hash);
+    addr = hash_table_get_address(ht, hash);
+    ptr = hash_table_bucket_find(&ht->bucket[addr], key_ptr, fragment);
+    if (ptr == NULL) {
+        addr = hash_table_get_alternate(ht, hash);
+        ptr = hash_table_bucket_find(&ht->bucket[addr], key_ptr, fragment);
+    }
+    if (ptr != NULL) {
+        ht->bucket[addr].ctrl[ptr - ht->bucket[addr].data] = HASH_TABLE_CTRL_EMPTY;
+        --ht->size;
+        hash_table_unstash(ht, addr);
+        return;
+    }
+    for (i = 0; i < ht->stash_size; ++i) {
+        if (hash_table_key_compare(&ht->stash[i].key, key_ptr) == 0) {
+            hash_table_data_copy(&ht->stash[i], &ht->stash[--ht->stash_size]);
+            --ht->size;
+            return;
+        }
+    }
+}
+
+inline void hash_table_clear(hash_table *ht)
+{
+    unsigned long i;
+    assert(ht != NULL);
+    for (i = 0; i < ht->bucket_count; ++i)
+        memset(ht->bucket[i].ctrl, HASH_TABLE_CTRL_EMPTY, sizeof(ht->bucket[i].ctrl));
+    ht->stash_size = ht->size = 0;
+}
+
+inline void hash_table_destroy(hash_table *ht)
+{
+    assert(ht != NULL);
+    free(ht->memory);
+    ht->memory = NULL;
+    ht->bucket = NULL;
+    ht->stash_size = ht->bucket_count = ht->capacity = ht->size = 0;
+}
\ No newline at end of file
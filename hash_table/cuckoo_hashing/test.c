@@ -0,0 +1,100 @@
+#include "hash_table.h"
+#include "../../benchmark/benchmark.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MAXN (1 << 24)
+#define OFFSET 5211314
+
+hash_table *ht;
+int *keys;
+
+void setup_empty(void *arg)
+{
+    (void)arg;
+    hash_table_init(ht, 0.95);
+}
+
+void setup_full(void *arg)
+{
+    int i;
+    setup_empty(arg);
+    for (i = 0; i < MAXN; ++i)
+        hash_table_insert(ht, &(hash_table_data_type){keys[i], i});
+}
+
+void setup_deleted(void *arg)
+{
+    int i;
+    setup_full(arg);
+    for (i = 0; i < (MAXN >> 2); ++i)
+        hash_table_delete(ht, &keys[i]);
+}
+
+void teardown(void *arg)
+{
+    (void)arg;
+    hash_table_destroy(ht);
+}
+
+void insert_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < MAXN; ++i) {
+        benchmark_op_begin(rec);
+        hash_table_insert(ht, &(hash_table_data_type){keys[i], i});
+        benchmark_op_end(rec);
+    }
+    rec->checksum = hash_table_size(ht);
+}
+
+void delete_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < (MAXN >> 2); ++i) {
+        benchmark_op_begin(rec);
+        hash_table_delete(ht, &keys[i]);
+        benchmark_op_end(rec);
+    }
+    rec->checksum = hash_table_size(ht);
+}
+
+void find_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
+    for (i = 0; i < (MAXN >> 1); ++i) {
+        benchmark_op_begin(rec);
+        if (hash_table_find(ht, &keys[i]) != NULL)
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+    benchmark b;
+    ht = (hash_table *)malloc(sizeof(hash_table));
+    keys = (int *)malloc(sizeof(int) * MAXN);
+
+    srand((unsigned int)time(NULL));
+    for (i = 0; i < MAXN; ++i)
+        keys[i] = (rand() << 8) - OFFSET + (i & 1 ? i : -i);
+
+    benchmark_init(&b, "cuckoo_hashing", argc, argv);
+    benchmark_run(&b, &(benchmark_case){"insert", 1, setup_empty, insert_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"delete", 1, setup_full, delete_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"find", 1, setup_deleted, find_run, teardown, NULL});
+    benchmark_finish(&b);
+
+    free(ht);
+    free(keys);
+    return 0;
+}
\ No newline at end of file
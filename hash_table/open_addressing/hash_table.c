@@ -1,27 +1,181 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
 #include "hash_table.h"
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
+#include <stdio.h>
+#include <pthread.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#ifndef HASH_TABLE_BYTE_KEYS
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#endif
+
+// ctrl[i] holds the 7-bit key fragment of a full slot, or one of the negative states below.
+// ctrl[capacity, capacity + GROUP_WIDTH - 1) mirrors the head so that a group can be loaded at any slot.
+#define HASH_TABLE_GROUP_WIDTH 16
+#define HASH_TABLE_CTRL_EMPTY ((hash_table_ctrl_type)-128)
+#define HASH_TABLE_CTRL_DELETED ((hash_table_ctrl_type)-2)
+#define HASH_TABLE_MIGRATE_STEP 64
+#define HASH_TABLE_DEFAULT_PURGE_FACTOR 0.25
+#define HASH_TABLE_GROW_FILL (25.0 / 32.0)
+#define HASH_TABLE_BATCH_SIZE 16
+#define HASH_TABLE_ARENA_MIN_CAPACITY 4096
+#define HASH_TABLE_ARENA_MAX_CAPACITY (1 << 20)
+#define HASH_TABLE_SNAPSHOT_MAGIC "HTSNAPOA"
+#define HASH_TABLE_SNAPSHOT_VERSION 1
+#define HASH_TABLE_SNAPSHOT_ALIGN 64
+#define HASH_TABLE_SNAPSHOT_ROBIN_HOOD 1u
+#define HASH_TABLE_MAX_THREADS 64
+#define HASH_TABLE_MIN_REGION 4096
+
+#if defined(__GNUC__)
+#define HASH_TABLE_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+#define HASH_TABLE_PREFETCH(ptr) ((void)(ptr))
+#endif
+
+#ifdef HASH_TABLE_STATS
+#define HASH_TABLE_STATS_RECORD(histogram, length) ++(histogram)[(length) < HASH_TABLE_STATS_HISTOGRAM_SIZE ? (length) : HASH_TABLE_STATS_HISTOGRAM_SIZE - 1]
+#else
+#define HASH_TABLE_STATS_RECORD(histogram, length)
+#endif
+
+// Bulk build splits the table into one address region per thread; each thread fills its region through a private copy of the table header.
+typedef struct HashTableBuildItem
+{
+    hash_table_hash_type hash;
+    unsigned long index;
+} hash_table_build_item;
+typedef struct HashTableBuildTask
+{
+    hash_table local;
+    const hash_table_data_type *data;
+    hash_table_build_item *items;
+    unsigned long *offset;
+    unsigned long begin;
+    unsigned long end;
+    unsigned long region_begin;
+    unsigned long region_end;
+    unsigned long slot_begin;
+    unsigned long slot_end;
+    unsigned long deferred;
+    unsigned int shift;
+} hash_table_build_task;
+// Parallel scans give each thread the same share of the group range in the old table and in the current one.
+typedef struct HashTableScanTask
+{
+    hash_table *ht;
+    hash_table_visit_func_type func;
+    void *arg;
+    unsigned int index;
+    unsigned int threads;
+} hash_table_scan_task;
 
 static int hash_table_key_compare(const hash_table_key_type *, const hash_table_key_type *);
 static int hash_table_data_compare(const hash_table_data_type *, const hash_table_data_type *);
+static int hash_table_key_match(const hash_table_key_type *, const hash_table_key_type *, hash_table_hash_type);
 static void hash_table_key_copy(hash_table_key_type *, const hash_table_key_type *);
 static void hash_table_val_copy(hash_table_val_type *, const hash_table_val_type *);
 static void hash_table_data_copy(hash_table_data_type *, const hash_table_data_type *);
+static hash_table_hash_type hash_table_mix(hash_table_hash_type);
+static hash_table_hash_type hash_table_random_seed(const hash_table *);
 static int hash_table_overload(const hash_table *);
-static unsigned long hash_table_get_address(const hash_table *, const hash_table_key_type *);
+static int hash_table_need_grow(const hash_table *);
+static unsigned long hash_table_min_capacity(const hash_table *, unsigned long);
+static hash_table_hash_type hash_table_get_hash(const hash_table *, const hash_table_key_type *);
+static hash_table_hash_type hash_table_get_entry_hash(const hash_table *, const hash_table_key_type *);
+static unsigned long hash_table_get_address(const hash_table *, hash_table_hash_type);
+static hash_table_ctrl_type hash_table_get_fragment(hash_table_hash_type);
 static unsigned long linear_probing(const hash_table *, unsigned long);
+static unsigned int trailing_zeros(unsigned int);
+static unsigned int leading_zeros(unsigned int);
+static unsigned int group_match(const hash_table_ctrl_type *, hash_table_ctrl_type);
+static unsigned int group_match_empty(const hash_table_ctrl_type *);
+static unsigned int group_match_empty_or_deleted(const hash_table_ctrl_type *);
+static unsigned int group_match_full(const hash_table_ctrl_type *);
+static void hash_table_set_ctrl(hash_table *, unsigned long, hash_table_ctrl_type);
+static unsigned long hash_table_find_slot(hash_table *, const hash_table_key_type *, hash_table_hash_type, unsigned long *);
+#ifndef HASH_TABLE_ROBIN_HOOD
+static unsigned long hash_table_find_free_slot(const hash_table *, unsigned long);
+#endif
+static void hash_table_place(hash_table *, const hash_table_data_type *, hash_table_hash_type);
+static void hash_table_erase(hash_table *, unsigned long);
+#ifndef HASH_TABLE_ROBIN_HOOD
+static int hash_table_need_purge(const hash_table *);
+static void hash_table_purge(hash_table *);
+#endif
+static void hash_table_resize(hash_table *, unsigned long);
 static void hash_table_rehash(hash_table *);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+static void hash_table_migrate(hash_table *, unsigned long);
+#endif
+static hash_table_data_type *hash_table_lookup(hash_table *, const hash_table_key_type *, hash_table_hash_type, unsigned long *);
+static void hash_table_insert_hash(hash_table *, const hash_table_data_type *, hash_table_hash_type);
+static unsigned int hash_table_threads(const hash_table *, unsigned int);
+static void hash_table_run(void *, size_t, unsigned int, void *(*)(void *));
+static void *hash_table_build_count(void *);
+static void *hash_table_build_scatter(void *);
+static int hash_table_build_place(hash_table *, const hash_table_data_type *, hash_table_hash_type, unsigned long);
+static void *hash_table_build_fill(void *);
+static void hash_table_build_merge(hash_table *, hash_table *);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+static unsigned long hash_table_erase_if_old(hash_table *, hash_table_pred_func_type, void *);
+#endif
+static unsigned int hash_table_iterator_load(const hash_table_iterator *);
+static void hash_table_scan(hash_table *, unsigned long, unsigned long, hash_table_visit_func_type, void *);
+static void hash_table_scan_part(hash_table *, unsigned int, unsigned int, hash_table_visit_func_type, void *);
+static void *hash_table_scan_worker(void *);
+#ifdef HASH_TABLE_BYTE_KEYS
+static void hash_table_arena_grow(hash_table *, unsigned long);
+static void hash_table_arena_release(hash_table_arena *);
+static const char *hash_table_arena_copy(hash_table *, const char *, unsigned long);
+static void hash_table_arena_move(hash_table *, hash_table *);
+static void hash_table_arena_compact(hash_table *);
+static void hash_table_key_store(hash_table *, hash_table_key_type *, hash_table_hash_type);
+static void hash_table_key_discard(hash_table *, const hash_table_key_type *);
+static void hash_table_arena_splice(hash_table *, hash_table_arena *);
+#else
+static unsigned long long hash_table_snapshot_align(unsigned long long);
+static unsigned int hash_table_snapshot_flags(void);
+static void hash_table_snapshot_layout(hash_table_snapshot_header *, unsigned long long);
+static int hash_table_write_padding(FILE *, unsigned long long, unsigned long long);
+static void *hash_table_map_file(const char *, unsigned long long *);
+static void hash_table_unmap_file(void *, unsigned long long);
+static void hash_table_snapshot_unmap(hash_table *);
+#endif
+#ifdef HASH_TABLE_STATS
+static double hash_table_stats_now(void);
+static unsigned long hash_table_bytes_allocated(const hash_table *);
+static void hash_table_stats_merge(hash_table_stats *, const hash_table_stats *);
+#endif
 
 static inline int hash_table_key_compare(const hash_table_key_type *lhs, const hash_table_key_type *rhs)
 {
     assert(lhs != NULL);
     assert(rhs != NULL);
+#ifdef HASH_TABLE_BYTE_KEYS
+    if (lhs->size != rhs->size)
+        return lhs->size < rhs->size ? -1 : 1;
+    return lhs->size ? memcmp(lhs->data, rhs->data, lhs->size) : 0;
+#else
     if (*lhs < *rhs)
         return -1;
     if (*lhs > *rhs)
         return 1;
     return 0;
+#endif
 }
 
 static inline int hash_table_data_compare(const hash_table_data_type *lhs, const hash_table_data_type *rhs)
@@ -31,6 +185,19 @@ static inline int hash_table_data_compare(const hash_table_data_type *lhs, const
     return hash_table_key_compare(&lhs->key, &rhs->key);
 }
 
+static inline int hash_table_key_match(const hash_table_key_type *entry, const hash_table_key_type *key_ptr, hash_table_hash_type hash)
+{
+    assert(entry != NULL);
+    assert(key_ptr != NULL);
+#ifdef HASH_TABLE_BYTE_KEYS
+    if (entry->hash != hash)
+        return 0;
+#else
+    (void)hash;
+#endif
+    return hash_table_key_compare(entry, key_ptr) == 0;
+}
+
 static inline void hash_table_key_copy(hash_table_key_type *dest, const hash_table_key_type *source)
 {
     assert(dest != NULL);
@@ -50,18 +217,84 @@ static inline void hash_table_data_copy(hash_table_data_type *dest, const hash_t
     assert(dest != NULL);
     assert(source != NULL);
     hash_table_key_copy(&dest->key, &source->key);
-    hash_table_val_copy(&dest->val, &dest->val);
+    hash_table_val_copy(&dest->val, &source->val);
+}
+
+static inline hash_table_hash_type hash_table_mix(hash_table_hash_type hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static hash_table_hash_type hash_table_random_seed(const hash_table *ht)
+{
+    static hash_table_hash_type counter = 0;
+    hash_table_hash_type ret = (hash_table_hash_type)time(NULL);
+    ret ^= hash_table_mix((hash_table_hash_type)(size_t)ht + ++counter * 0x9e3779b97f4a7c15ULL);
+    ret ^= hash_table_mix((hash_table_hash_type)clock());
+    return hash_table_mix(ret);
+}
+
+hash_table_hash_type hash_table_default_hash(const hash_table_key_type *key_ptr, hash_table_hash_type seed)
+{
+#ifdef HASH_TABLE_BYTE_KEYS
+    unsigned long i;
+    hash_table_hash_type word;
+    hash_table_hash_type ret;
+    assert(key_ptr != NULL);
+    ret = seed ^ (hash_table_hash_type)key_ptr->size * 0x9e3779b97f4a7c15ULL;
+    for (i = 0; i + sizeof(word) <= key_ptr->size; i += sizeof(word)) {
+        memcpy(&word, key_ptr->data + i, sizeof(word));
+        ret = hash_table_mix(ret ^ word);
+    }
+    word = 0;
+    if (i < key_ptr->size)
+        memcpy(&word, key_ptr->data + i, key_ptr->size - i);
+    return hash_table_mix(ret ^ word);
+#else
+    assert(key_ptr != NULL);
+    return hash_table_mix((hash_table_hash_type)(unsigned int)*key_ptr ^ seed);
+#endif
 }
 
 inline void hash_table_init(hash_table *ht, double init_load_factor)
+{
+    hash_table_init_with_hash(ht, init_load_factor, hash_table_default_hash);
+}
+
+void hash_table_init_with_hash(hash_table *ht, double init_load_factor, hash_table_hash_func_type hash_func)
 {
     assert(ht != NULL);
     assert(init_load_factor > 0);
-    assert(init_load_factor < 2);
+    assert(init_load_factor < 1);
     ht->data = NULL;
-    ht->occupation = NULL;
-    ht->capacity = ht->size = 0;
+    ht->ctrl = NULL;
+#ifdef HASH_TABLE_ROBIN_HOOD
+    ht->dist = NULL;
+#endif
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    ht->old_table = NULL;
+    ht->migrate_pos = 0;
+#endif
+    ht->capacity = ht->size = ht->deleted = 0;
     ht->load_factor = init_load_factor;
+    ht->purge_factor = HASH_TABLE_DEFAULT_PURGE_FACTOR;
+    ht->hash_func = hash_func != NULL ? hash_func : hash_table_default_hash;
+    ht->seed = hash_table_random_seed(ht);
+#ifdef HASH_TABLE_STATS
+    memset(&ht->stats, 0, sizeof(hash_table_stats));
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+    ht->arena = NULL;
+    ht->arena_size = ht->arena_garbage = 0;
+#else
+    ht->snapshot = NULL;
+    ht->snapshot_size = 0;
+#endif
 }
 
 inline unsigned long hash_table_capacity(const hash_table *ht)
@@ -82,138 +315,1406 @@ inline int hash_table_empty(const hash_table *ht)
     return ht->size == 0;
 }
 
+// A table opened from a snapshot maps its arrays read-only, so every write is refused at run time, not only under assert.
+inline int hash_table_read_only(const hash_table *ht)
+{
+    assert(ht != NULL);
+#ifdef HASH_TABLE_BYTE_KEYS
+    return 0;
+#else
+    return ht->snapshot != NULL;
+#endif
+}
+
+inline void hash_table_set_purge_factor(hash_table *ht, double purge_factor)
+{
+    assert(ht != NULL);
+    assert(purge_factor > 0);
+    ht->purge_factor = purge_factor;
+}
+
 static inline int hash_table_overload(const hash_table *ht)
 {
     assert(ht != NULL);
     return ht->capacity == 0 || (double)ht->size > (double)ht->capacity * ht->load_factor;
 }
 
-static inline unsigned long hash_table_get_address(const hash_table *ht, const hash_table_key_type *key_ptr)
+// Tombstones past the load budget are purged in place, unless live entries hold most of it; then a purge would
+// free too little and run again a few inserts later, so the table doubles instead.
+static inline int hash_table_need_grow(const hash_table *ht)
+{
+    assert(ht != NULL);
+    return (double)(ht->size + ht->deleted) > (double)ht->capacity * ht->load_factor
+        && (double)ht->size > (double)ht->capacity * ht->load_factor * HASH_TABLE_GROW_FILL;
+}
+
+static unsigned long hash_table_min_capacity(const hash_table *ht, unsigned long size)
+{
+    unsigned long ret = HASH_TABLE_GROUP_WIDTH;
+    assert(ht != NULL);
+    while ((double)ret * ht->load_factor < 1 || (double)size > (double)ret * ht->load_factor)
+        ret <<= 1;
+    return ret;
+}
+
+static inline hash_table_hash_type hash_table_get_hash(const hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    return ht->hash_func(key_ptr, ht->seed);
+}
+
+static inline hash_table_hash_type hash_table_get_entry_hash(const hash_table *ht, const hash_table_key_type *key_ptr)
 {
     assert(ht != NULL);
     assert(key_ptr != NULL);
-    return *key_ptr & ht->mask;
+#ifdef HASH_TABLE_BYTE_KEYS
+    return key_ptr->hash;
+#else
+    return hash_table_get_hash(ht, key_ptr);
+#endif
+}
+
+static inline unsigned long hash_table_get_address(const hash_table *ht, hash_table_hash_type hash)
+{
+    assert(ht != NULL);
+    return (unsigned long)hash & ht->mask;
+}
+
+static inline hash_table_ctrl_type hash_table_get_fragment(hash_table_hash_type hash)
+{
+    return (hash_table_ctrl_type)(hash >> 57);
 }
 
 static inline unsigned long linear_probing(const hash_table *ht, unsigned long addr)
 {
     assert(ht != NULL);
-    return (addr + 1) & ht->mask;
+    return (addr + HASH_TABLE_GROUP_WIDTH) & ht->mask;
+}
+
+static inline unsigned int trailing_zeros(unsigned int bits)
+{
+    assert(bits != 0);
+#if defined(__GNUC__)
+    return (unsigned int)__builtin_ctz(bits);
+#else
+    unsigned int ret = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        ++ret;
+    }
+    return ret;
+#endif
+}
+
+static inline unsigned int leading_zeros(unsigned int bits)
+{
+    assert(bits != 0);
+#if defined(__GNUC__)
+    return (unsigned int)__builtin_clz(bits) - (sizeof(unsigned int) * 8 - HASH_TABLE_GROUP_WIDTH);
+#else
+    unsigned int ret = 0;
+    while (!(bits & (1u << (HASH_TABLE_GROUP_WIDTH - 1)))) {
+        bits <<= 1;
+        ++ret;
+    }
+    return ret;
+#endif
+}
+
+static inline unsigned int group_match(const hash_table_ctrl_type *group, hash_table_ctrl_type fragment)
+{
+#if defined(__SSE2__)
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(fragment)));
+#else
+    unsigned int i;
+    unsigned int ret = 0;
+    for (i = 0; i < HASH_TABLE_GROUP_WIDTH; ++i) {
+        if (group[i] == fragment)
+            ret |= 1u << i;
+    }
+    return ret;
+#endif
+}
+
+static inline unsigned int group_match_empty(const hash_table_ctrl_type *group)
+{
+    return group_match(group, HASH_TABLE_CTRL_EMPTY);
+}
+
+static inline unsigned int group_match_empty_or_deleted(const hash_table_ctrl_type *group)
+{
+#if defined(__SSE2__)
+    return (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    unsigned int i;
+    unsigned int ret = 0;
+    for (i = 0; i < HASH_TABLE_GROUP_WIDTH; ++i) {
+        if (group[i] < 0)
+            ret |= 1u << i;
+    }
+    return ret;
+#endif
+}
+
+static inline unsigned int group_match_full(const hash_table_ctrl_type *group)
+{
+    return ~group_match_empty_or_deleted(group) & ((1u << HASH_TABLE_GROUP_WIDTH) - 1);
+}
+
+static inline void hash_table_set_ctrl(hash_table *ht, unsigned long addr, hash_table_ctrl_type ctrl)
+{
+    assert(ht != NULL);
+    ht->ctrl[addr] = ctrl;
+    if (addr < HASH_TABLE_GROUP_WIDTH - 1)
+        ht->ctrl[ht->capacity + addr] = ctrl;
 }
 
-static void hash_table_rehash(hash_table *ht)
+// Adds the groups scanned to *probe_ptr; only the public find paths record the count, so find_probes leaves out inserts and deletes.
+static unsigned long hash_table_find_slot(hash_table *ht, const hash_table_key_type *key_ptr, hash_table_hash_type hash, unsigned long *probe_ptr)
 {
     unsigned long i;
     unsigned long addr;
-    unsigned long new_capacity;
-    hash_table_data_type *new_data = NULL;
-    hash_table_bool_type *new_occupation = NULL;
+    unsigned long slot;
+    unsigned int match;
+    hash_table_ctrl_type fragment;
     assert(ht != NULL);
-    if (ht->capacity) {
-        new_capacity = ht->capacity << 1;
-        new_data = (hash_table_data_type *)malloc(new_capacity * sizeof(hash_table_data_type));
-        assert(new_data != NULL);
-        new_occupation = (hash_table_bool_type *)calloc(new_capacity, sizeof(hash_table_bool_type));
-        assert(new_occupation != NULL);
-        ht->mask = new_capacity - 1;
-        for (i = 0; i < ht->capacity; ++i) {
-            if (ht->occupation[i] && !ht->remove_flag[i]) {
-                addr = hash_table_get_address(ht, &ht->data[i].key);
-                while (new_occupation[addr])
-                    addr = linear_probing(ht, addr);
-                hash_table_data_copy(&new_data[addr], &ht->data[i]);
-                new_occupation[addr] = 1;
+    assert(key_ptr != NULL);
+    assert(probe_ptr != NULL);
+    if (ht->capacity == 0)
+        return ht->capacity;
+    addr = hash_table_get_address(ht, hash);
+    fragment = hash_table_get_fragment(hash);
+    for (i = 0; i < ht->capacity; i += HASH_TABLE_GROUP_WIDTH) {
+        for (match = group_match(ht->ctrl + addr, fragment); match; match &= match - 1) {
+            slot = (addr + trailing_zeros(match)) & ht->mask;
+            if (hash_table_key_match(&ht->data[slot].key, key_ptr, hash)) {
+                *probe_ptr += i / HASH_TABLE_GROUP_WIDTH;
+                return slot;
             }
         }
-        free(ht->data);
-        ht->data = new_data;
-        free(ht->occupation);
-        ht->occupation = new_occupation;
-        ht->remove_flag = (hash_table_bool_type *)realloc(ht->remove_flag, new_capacity * sizeof(hash_table_bool_type));
-        assert(ht->remove_flag != NULL);
-        memset(ht->remove_flag, 0, new_capacity * sizeof(hash_table_bool_type));
-        ht->capacity = new_capacity;
+        if (group_match_empty(ht->ctrl + addr))
+            break;
+#ifdef HASH_TABLE_ROBIN_HOOD
+        slot = (addr + HASH_TABLE_GROUP_WIDTH - 1) & ht->mask;
+        if (ht->dist[slot] < i + HASH_TABLE_GROUP_WIDTH - 1)
+            break;
+#endif
+        addr = linear_probing(ht, addr);
+    }
+    *probe_ptr += i / HASH_TABLE_GROUP_WIDTH;
+    return ht->capacity;
+}
+
+#ifndef HASH_TABLE_ROBIN_HOOD
+static unsigned long hash_table_find_free_slot(const hash_table *ht, unsigned long addr)
+{
+    unsigned long i;
+    unsigned int match;
+    assert(ht != NULL);
+    for (i = 0; i < ht->capacity; i += HASH_TABLE_GROUP_WIDTH) {
+        match = group_match_empty_or_deleted(ht->ctrl + addr);
+        if (match)
+            return (addr + trailing_zeros(match)) & ht->mask;
+        addr = linear_probing(ht, addr);
+    }
+    return ht->capacity;
+}
+
+static void hash_table_place(hash_table *ht, const hash_table_data_type *data_ptr, hash_table_hash_type hash)
+{
+    unsigned long addr;
+    assert(ht != NULL);
+    assert(data_ptr != NULL);
+    addr = hash_table_find_free_slot(ht, hash_table_get_address(ht, hash));
+    assert(addr != ht->capacity);
+    HASH_TABLE_STATS_RECORD(ht->stats.insert_probes, ((addr - hash_table_get_address(ht, hash)) & ht->mask) / HASH_TABLE_GROUP_WIDTH);
+    if (ht->ctrl[addr] == HASH_TABLE_CTRL_DELETED)
+        --ht->deleted;
+    hash_table_data_copy(&ht->data[addr], data_ptr);
+    hash_table_set_ctrl(ht, addr, hash_table_get_fragment(hash));
+}
+
+static void hash_table_erase(hash_table *ht, unsigned long addr)
+{
+    unsigned int empty_before;
+    unsigned int empty_after;
+    assert(ht != NULL);
+    empty_before = group_match_empty(ht->ctrl + ((addr - HASH_TABLE_GROUP_WIDTH) & ht->mask));
+    empty_after = group_match_empty(ht->ctrl + addr);
+    if (empty_before && empty_after && trailing_zeros(empty_after) + leading_zeros(empty_before) < HASH_TABLE_GROUP_WIDTH) {
+        hash_table_set_ctrl(ht, addr, HASH_TABLE_CTRL_EMPTY);
     } else {
-        ht->capacity = 1;
-        while ((double)ht->capacity * ht->load_factor < 1)
-            ht->capacity <<= 1;
-        ht->mask = ht->capacity - 1;
-        ht->data = (hash_table_data_type *)malloc(ht->capacity * sizeof(hash_table_data_type));
-        assert(ht->data != NULL);
-        ht->occupation = (hash_table_bool_type *)calloc(ht->capacity, sizeof(hash_table_bool_type));
-        assert(ht->occupation != NULL);
-        ht->remove_flag = (hash_table_bool_type *)calloc(ht->capacity, sizeof(hash_table_bool_type));
-        assert(ht->remove_flag != NULL);
+        hash_table_set_ctrl(ht, addr, HASH_TABLE_CTRL_DELETED);
+        ++ht->deleted;
     }
 }
 
-hash_table_val_type *hash_table_find(hash_table *ht, const hash_table_key_type *key_ptr)
+static inline int hash_table_need_purge(const hash_table *ht)
+{
+    assert(ht != NULL);
+    return (double)ht->deleted > (double)ht->capacity * ht->purge_factor
+        || (double)(ht->size + ht->deleted) > (double)ht->capacity * ht->load_factor;
+}
+
+static void hash_table_purge(hash_table *ht)
 {
+    unsigned long i;
+    unsigned long home;
     unsigned long addr;
+    hash_table_hash_type hash;
+    hash_table_data_type tmp;
     assert(ht != NULL);
-    assert(key_ptr != NULL);
-    addr = hash_table_get_address(ht, key_ptr);
-    while (ht->occupation[addr]) {
-        if (!ht->remove_flag[addr] && hash_table_key_compare(&ht->data[addr].key, key_ptr) == 0)
-            return &ht->data[addr].val;
-        addr = linear_probing(ht, addr);
+    for (i = 0; i < ht->capacity; ++i)
+        ht->ctrl[i] = ht->ctrl[i] >= 0 ? HASH_TABLE_CTRL_DELETED : HASH_TABLE_CTRL_EMPTY;
+    memcpy(ht->ctrl + ht->capacity, ht->ctrl, (HASH_TABLE_GROUP_WIDTH - 1) * sizeof(hash_table_ctrl_type));
+    for (i = 0; i < ht->capacity; ++i) {
+        if (ht->ctrl[i] != HASH_TABLE_CTRL_DELETED)
+            continue;
+        hash = hash_table_get_entry_hash(ht, &ht->data[i].key);
+        home = hash_table_get_address(ht, hash);
+        addr = hash_table_find_free_slot(ht, home);
+        if (((addr - home) & ht->mask) / HASH_TABLE_GROUP_WIDTH == ((i - home) & ht->mask) / HASH_TABLE_GROUP_WIDTH) {
+            hash_table_set_ctrl(ht, i, hash_table_get_fragment(hash));
+        } else if (ht->ctrl[addr] == HASH_TABLE_CTRL_EMPTY) {
+            hash_table_data_copy(&ht->data[addr], &ht->data[i]);
+            hash_table_set_ctrl(ht, addr, hash_table_get_fragment(hash));
+            hash_table_set_ctrl(ht, i, HASH_TABLE_CTRL_EMPTY);
+        } else {
+            hash_table_data_copy(&tmp, &ht->data[addr]);
+            hash_table_data_copy(&ht->data[addr], &ht->data[i]);
+            hash_table_data_copy(&ht->data[i], &tmp);
+            hash_table_set_ctrl(ht, addr, hash_table_get_fragment(hash));
+            --i;
+        }
     }
-    return NULL;
+    ht->deleted = 0;
+}
+#else
+static void hash_table_place(hash_table *ht, const hash_table_data_type *data_ptr, hash_table_hash_type hash)
+{
+    unsigned long addr;
+    hash_table_dist_type dist = 0;
+    hash_table_dist_type tmp_dist;
+    hash_table_ctrl_type fragment;
+    hash_table_ctrl_type tmp_fragment;
+    hash_table_data_type data;
+    hash_table_data_type tmp_data;
+    assert(ht != NULL);
+    assert(data_ptr != NULL);
+    hash_table_data_copy(&data, data_ptr);
+    addr = hash_table_get_address(ht, hash);
+    fragment = hash_table_get_fragment(hash);
+    while (ht->ctrl[addr] != HASH_TABLE_CTRL_EMPTY) {
+        if (ht->dist[addr] < dist) {
+            hash_table_data_copy(&tmp_data, &ht->data[addr]);
+            hash_table_data_copy(&ht->data[addr], &data);
+            hash_table_data_copy(&data, &tmp_data);
+            tmp_fragment = ht->ctrl[addr];
+            hash_table_set_ctrl(ht, addr, fragment);
+            fragment = tmp_fragment;
+            tmp_dist = ht->dist[addr];
+            ht->dist[addr] = dist;
+            dist = tmp_dist;
+        }
+        addr = (addr + 1) & ht->mask;
+        ++dist;
+    }
+    hash_table_data_copy(&ht->data[addr], &data);
+    hash_table_set_ctrl(ht, addr, fragment);
+    ht->dist[addr] = dist;
+    HASH_TABLE_STATS_RECORD(ht->stats.insert_probes, ((addr - hash_table_get_address(ht, hash)) & ht->mask) / HASH_TABLE_GROUP_WIDTH);
 }
 
-void hash_table_insert(hash_table *ht, const hash_table_data_type *data_ptr)
+static void hash_table_erase(hash_table *ht, unsigned long addr)
+{
+    unsigned long next;
+    assert(ht != NULL);
+    for (next = (addr + 1) & ht->mask; ht->ctrl[next] != HASH_TABLE_CTRL_EMPTY && ht->dist[next]; next = (next + 1) & ht->mask) {
+        hash_table_data_copy(&ht->data[addr], &ht->data[next]);
+        hash_table_set_ctrl(ht, addr, ht->ctrl[next]);
+        ht->dist[addr] = ht->dist[next] - 1;
+        addr = next;
+    }
+    hash_table_set_ctrl(ht, addr, HASH_TABLE_CTRL_EMPTY);
+}
+#endif
+
+static void hash_table_resize(hash_table *ht, unsigned long new_capacity)
+{
+#ifndef HASH_TABLE_INCREMENTAL_REHASH
+    unsigned long i;
+#endif
+    hash_table old_table;
+#ifdef HASH_TABLE_STATS
+    double begin = hash_table_stats_now();
+#endif
+    assert(ht != NULL);
+    if (hash_table_read_only(ht))
+        return;
+    old_table = *ht;
+#ifdef HASH_TABLE_BYTE_KEYS
+    old_table.arena = NULL;
+#endif
+    ht->capacity = new_capacity;
+    ht->deleted = 0;
+    ht->mask = ht->capacity - 1;
+    ht->data = (hash_table_data_type *)malloc(ht->capacity * sizeof(hash_table_data_type));
+    assert(ht->data != NULL);
+    ht->ctrl = (hash_table_ctrl_type *)malloc((ht->capacity + HASH_TABLE_GROUP_WIDTH - 1) * sizeof(hash_table_ctrl_type));
+    assert(ht->ctrl != NULL);
+    memset(ht->ctrl, HASH_TABLE_CTRL_EMPTY, (ht->capacity + HASH_TABLE_GROUP_WIDTH - 1) * sizeof(hash_table_ctrl_type));
+#ifdef HASH_TABLE_ROBIN_HOOD
+    ht->dist = (hash_table_dist_type *)malloc(ht->capacity * sizeof(hash_table_dist_type));
+    assert(ht->dist != NULL);
+#endif
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (old_table.capacity) {
+        ht->old_table = (hash_table *)malloc(sizeof(hash_table));
+        assert(ht->old_table != NULL);
+        *ht->old_table = old_table;
+        ht->migrate_pos = 0;
+#ifdef HASH_TABLE_STATS
+        memset(&ht->old_table->stats, 0, sizeof(hash_table_stats));
+#endif
+    }
+#else
+    for (i = 0; i < old_table.capacity; ++i) {
+        if (old_table.ctrl[i] >= 0)
+            hash_table_place(ht, &old_table.data[i], hash_table_get_entry_hash(ht, &old_table.data[i].key));
+    }
+    hash_table_destroy(&old_table);
+#endif
+#ifdef HASH_TABLE_STATS
+    ++ht->stats.rehash_count;
+    ht->stats.rehash_time += hash_table_stats_now() - begin;
+#endif
+}
+
+static inline void hash_table_rehash(hash_table *ht)
+{
+    assert(ht != NULL);
+    hash_table_resize(ht, ht->capacity ? ht->capacity << 1 : hash_table_min_capacity(ht, 0));
+}
+
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+static void hash_table_migrate(hash_table *ht, unsigned long count)
+{
+    hash_table *old_table = NULL;
+#ifdef HASH_TABLE_STATS
+    double begin = hash_table_stats_now();
+#endif
+    assert(ht != NULL);
+    old_table = ht->old_table;
+    if (old_table == NULL)
+        return;
+    for (; count && ht->migrate_pos < old_table->capacity; --count, ++ht->migrate_pos) {
+        if (old_table->ctrl[ht->migrate_pos] >= 0) {
+            hash_table_place(ht, &old_table->data[ht->migrate_pos], hash_table_get_entry_hash(ht, &old_table->data[ht->migrate_pos].key));
+            hash_table_set_ctrl(old_table, ht->migrate_pos, HASH_TABLE_CTRL_DELETED);
+        }
+    }
+#ifdef HASH_TABLE_STATS
+    ht->stats.rehash_time += hash_table_stats_now() - begin;
+#endif
+    if (ht->migrate_pos == old_table->capacity) {
+#ifdef HASH_TABLE_STATS
+        hash_table_stats_merge(&ht->stats, &old_table->stats);
+#endif
+        hash_table_destroy(old_table);
+        free(old_table);
+        ht->old_table = NULL;
+    }
+}
+#endif
+
+static hash_table_data_type *hash_table_lookup(hash_table *ht, const hash_table_key_type *key_ptr, hash_table_hash_type hash, unsigned long *probe_ptr)
 {
     unsigned long addr;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_table != NULL) {
+        addr = hash_table_find_slot(ht->old_table, key_ptr, hash, probe_ptr);
+        if (addr != ht->old_table->capacity)
+            return &ht->old_table->data[addr];
+    }
+#endif
+    addr = hash_table_find_slot(ht, key_ptr, hash, probe_ptr);
+    return addr != ht->capacity ? &ht->data[addr] : NULL;
+}
+
+static void hash_table_insert_hash(hash_table *ht, const hash_table_data_type *data_ptr, hash_table_hash_type hash)
+{
+    unsigned long probe = 0;
+    hash_table_data_type *ptr = NULL;
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_data_type data;
+#endif
     assert(ht != NULL);
     assert(data_ptr != NULL);
-    if (hash_table_overload(ht))
+    ptr = hash_table_lookup(ht, &data_ptr->key, hash, &probe);
+    if (ptr != NULL) {
+        hash_table_val_copy(&ptr->val, &data_ptr->val);
+        return;
+    }
+    if (hash_table_overload(ht) || hash_table_need_grow(ht)) {
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+        hash_table_migrate(ht, ~0UL);
+#endif
         hash_table_rehash(ht);
-    addr = hash_table_get_address(ht, &data_ptr->key);
-    while (ht->occupation[addr]) {
-        if (ht->remove_flag[addr]) {
-            ht->remove_flag[addr] = 0;
-            break;
+    }
+#ifndef HASH_TABLE_ROBIN_HOOD
+    else if (hash_table_need_purge(ht)) {
+        hash_table_purge(ht);
+    }
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_data_copy(&data, data_ptr);
+    hash_table_key_store(ht, &data.key, hash);
+    data_ptr = &data;
+#endif
+    hash_table_place(ht, data_ptr, hash);
+    ++ht->size;
+}
+
+hash_table_val_type *hash_table_find(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    unsigned long probe = 0;
+    hash_table_data_type *ptr = NULL;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    hash_table_migrate(ht, HASH_TABLE_MIGRATE_STEP);
+#endif
+    ptr = hash_table_lookup(ht, key_ptr, hash_table_get_hash(ht, key_ptr), &probe);
+    HASH_TABLE_STATS_RECORD(ht->stats.find_probes, probe);
+    return ptr != NULL ? &ptr->val : NULL;
+}
+
+void hash_table_find_batch(hash_table *ht, const hash_table_key_type *keys, unsigned long n, hash_table_val_type **results)
+{
+    unsigned long i;
+    unsigned long j;
+    unsigned long block;
+    unsigned long addr;
+    unsigned long probe;
+    hash_table_hash_type hash[HASH_TABLE_BATCH_SIZE];
+    hash_table_data_type *ptr = NULL;
+    assert(ht != NULL);
+    assert(n == 0 || keys != NULL);
+    assert(n == 0 || results != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    // One step for the whole batch: a later step could finish the migration and free the old table under earlier results.
+    hash_table_migrate(ht, HASH_TABLE_MIGRATE_STEP);
+#endif
+    for (i = 0; i < n; i += block) {
+        block = n - i < HASH_TABLE_BATCH_SIZE ? n - i : HASH_TABLE_BATCH_SIZE;
+        for (j = 0; j < block; ++j) {
+            hash[j] = hash_table_get_hash(ht, &keys[i + j]);
+            if (ht->capacity) {
+                addr = hash_table_get_address(ht, hash[j]);
+                HASH_TABLE_PREFETCH(ht->ctrl + addr);
+                HASH_TABLE_PREFETCH(ht->data + addr);
+            }
+        }
+        for (j = 0; j < block; ++j) {
+            probe = 0;
+            ptr = hash_table_lookup(ht, &keys[i + j], hash[j], &probe);
+            HASH_TABLE_STATS_RECORD(ht->stats.find_probes, probe);
+            results[i + j] = ptr != NULL ? &ptr->val : NULL;
+        }
+    }
+}
+
+int hash_table_insert(hash_table *ht, const hash_table_data_type *data_ptr)
+{
+    assert(ht != NULL);
+    assert(data_ptr != NULL);
+    if (hash_table_read_only(ht))
+        return 0;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    hash_table_migrate(ht, HASH_TABLE_MIGRATE_STEP);
+#endif
+    hash_table_insert_hash(ht, data_ptr, hash_table_get_hash(ht, &data_ptr->key));
+    return 1;
+}
+
+int hash_table_insert_batch(hash_table *ht, const hash_table_data_type *data, unsigned long n)
+{
+    unsigned long i;
+    unsigned long j;
+    unsigned long block;
+    unsigned long addr;
+    hash_table_hash_type hash[HASH_TABLE_BATCH_SIZE];
+    assert(ht != NULL);
+    assert(n == 0 || data != NULL);
+    if (hash_table_read_only(ht))
+        return 0;
+    if (n == 0)
+        return 1;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    hash_table_migrate(ht, ~0UL);
+#endif
+    if ((double)(ht->size + n) > (double)ht->capacity * ht->load_factor) {
+        hash_table_resize(ht, hash_table_min_capacity(ht, ht->size + n));
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+        hash_table_migrate(ht, ~0UL);
+#endif
+    }
+    for (i = 0; i < n; i += block) {
+        block = n - i < HASH_TABLE_BATCH_SIZE ? n - i : HASH_TABLE_BATCH_SIZE;
+        for (j = 0; j < block; ++j) {
+            hash[j] = hash_table_get_hash(ht, &data[i + j].key);
+            addr = hash_table_get_address(ht, hash[j]);
+            HASH_TABLE_PREFETCH(ht->ctrl + addr);
+            HASH_TABLE_PREFETCH(ht->data + addr);
         }
-        if (hash_table_key_compare(&ht->data[addr].key, &data_ptr->key) == 0) {
+        for (j = 0; j < block; ++j)
+            hash_table_insert_hash(ht, &data[i + j], hash[j]);
+    }
+    return 1;
+}
+
+static unsigned int hash_table_threads(const hash_table *ht, unsigned int threads)
+{
+    unsigned int ret = 1;
+    assert(ht != NULL);
+    while (ret << 1 <= threads && ret << 1 <= HASH_TABLE_MAX_THREADS && ht->capacity / (ret << 1) >= HASH_TABLE_MIN_REGION)
+        ret <<= 1;
+    return ret;
+}
+
+static void hash_table_run(void *tasks, size_t task_size, unsigned int threads, void *(*worker)(void *))
+{
+    unsigned int i;
+    pthread_t thread[HASH_TABLE_MAX_THREADS];
+    assert(tasks != NULL);
+    for (i = 1; i < threads; ++i) {
+        if (pthread_create(&thread[i], NULL, worker, (char *)tasks + i * task_size) != 0)
+            assert(0);
+    }
+    worker(tasks);
+    for (i = 1; i < threads; ++i)
+        pthread_join(thread[i], NULL);
+}
+
+static void *hash_table_build_count(void *arg)
+{
+    unsigned long i;
+    hash_table_build_task *task = (hash_table_build_task *)arg;
+    assert(task != NULL);
+    for (i = task->begin; i < task->end; ++i)
+        ++task->offset[hash_table_get_address(&task->local, hash_table_get_hash(&task->local, &task->data[i].key)) >> task->shift];
+    return NULL;
+}
+
+static void *hash_table_build_scatter(void *arg)
+{
+    unsigned long i;
+    hash_table_hash_type hash;
+    hash_table_build_item *item = NULL;
+    hash_table_build_task *task = (hash_table_build_task *)arg;
+    assert(task != NULL);
+    for (i = task->begin; i < task->end; ++i) {
+        hash = hash_table_get_hash(&task->local, &task->data[i].key);
+        item = &task->items[task->offset[hash_table_get_address(&task->local, hash) >> task->shift]++];
+        item->hash = hash;
+        item->index = i;
+    }
+    return NULL;
+}
+
+static int hash_table_build_place(hash_table *ht, const hash_table_data_type *data_ptr, hash_table_hash_type hash, unsigned long end)
+{
+    unsigned long addr;
+    hash_table_ctrl_type fragment;
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_data_type data;
+#endif
+    assert(ht != NULL);
+    assert(data_ptr != NULL);
+    fragment = hash_table_get_fragment(hash);
+    for (addr = hash_table_get_address(ht, hash); addr < end && ht->ctrl[addr] != HASH_TABLE_CTRL_EMPTY; ++addr) {
+        if (ht->ctrl[addr] == fragment && hash_table_key_match(&ht->data[addr].key, &data_ptr->key, hash)) {
             hash_table_val_copy(&ht->data[addr].val, &data_ptr->val);
-            return;
+            return 1;
         }
-        addr = linear_probing(ht, addr);
     }
+    if (addr == end)
+        return 0;
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_data_copy(&data, data_ptr);
+    hash_table_key_store(ht, &data.key, hash);
+    data_ptr = &data;
+#endif
+#ifdef HASH_TABLE_ROBIN_HOOD
+    hash_table_place(ht, data_ptr, hash);
+#else
+    HASH_TABLE_STATS_RECORD(ht->stats.insert_probes, (addr - hash_table_get_address(ht, hash)) / HASH_TABLE_GROUP_WIDTH);
     hash_table_data_copy(&ht->data[addr], data_ptr);
-    ht->occupation[addr] = 1;
+    hash_table_set_ctrl(ht, addr, fragment);
+#endif
     ++ht->size;
+    return 1;
 }
 
-void hash_table_delete(hash_table *ht, const hash_table_key_type *key_ptr)
+static void *hash_table_build_fill(void *arg)
+{
+    unsigned long i;
+    hash_table_build_task *task = (hash_table_build_task *)arg;
+    assert(task != NULL);
+    task->deferred = task->region_begin;
+    for (i = task->region_begin; i < task->region_end; ++i) {
+        if (!hash_table_build_place(&task->local, &task->data[task->items[i].index], task->items[i].hash, task->slot_end))
+            task->items[task->deferred++] = task->items[i];
+    }
+    return NULL;
+}
+
+static void hash_table_build_merge(hash_table *ht, hash_table *local)
+{
+    assert(ht != NULL);
+    assert(local != NULL);
+    ht->size += local->size;
+#ifdef HASH_TABLE_STATS
+    hash_table_stats_merge(&ht->stats, &local->stats);
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_arena_splice(ht, local->arena);
+    ht->arena_size += local->arena_size;
+#endif
+}
+
+int hash_table_build_from_array(hash_table *ht, const hash_table_data_type *data, unsigned long n, unsigned int threads)
+{
+    unsigned long i;
+    unsigned long pos;
+    unsigned long tmp;
+    unsigned int t;
+    unsigned int r;
+    unsigned int shift = 0;
+    unsigned long *offset = NULL;
+    hash_table_build_item *items = NULL;
+    hash_table_build_task *tasks = NULL;
+    assert(ht != NULL);
+    assert(n == 0 || data != NULL);
+    if (hash_table_read_only(ht))
+        return 0;
+    hash_table_clear(ht);
+    if (ht->capacity < hash_table_min_capacity(ht, n)) {
+        hash_table_destroy(ht);
+        hash_table_resize(ht, hash_table_min_capacity(ht, n));
+    }
+    threads = hash_table_threads(ht, threads);
+    if (threads == 1) {
+        for (i = 0; i < n; ++i)
+            hash_table_insert_hash(ht, &data[i], hash_table_get_hash(ht, &data[i].key));
+        return 1;
+    }
+    while ((ht->capacity >> shift) > threads)
+        ++shift;
+    tasks = (hash_table_build_task *)malloc(threads * sizeof(hash_table_build_task));
+    assert(tasks != NULL);
+    offset = (unsigned long *)calloc((size_t)threads * threads, sizeof(unsigned long));
+    assert(offset != NULL);
+    items = (hash_table_build_item *)malloc(n * sizeof(hash_table_build_item));
+    assert(items != NULL);
+    for (t = 0; t < threads; ++t) {
+        tasks[t].local = *ht;
+        tasks[t].local.size = 0;
+#ifdef HASH_TABLE_STATS
+        memset(&tasks[t].local.stats, 0, sizeof(hash_table_stats));
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+        tasks[t].local.arena = NULL;
+        tasks[t].local.arena_size = tasks[t].local.arena_garbage = 0;
+#endif
+        tasks[t].data = data;
+        tasks[t].items = items;
+        tasks[t].offset = offset + (size_t)t * threads;
+        tasks[t].begin = n / threads * t;
+        tasks[t].end = t + 1 == threads ? n : n / threads * (t + 1);
+        tasks[t].slot_begin = (unsigned long)t << shift;
+        tasks[t].slot_end = (unsigned long)(t + 1) << shift;
+        tasks[t].shift = shift;
+    }
+    hash_table_run(tasks, sizeof(hash_table_build_task), threads, hash_table_build_count);
+    for (r = 0, pos = 0; r < threads; ++r) {
+        tasks[r].region_begin = pos;
+        for (t = 0; t < threads; ++t) {
+            tmp = tasks[t].offset[r];
+            tasks[t].offset[r] = pos;
+            pos += tmp;
+        }
+        tasks[r].region_end = pos;
+    }
+    hash_table_run(tasks, sizeof(hash_table_build_task), threads, hash_table_build_scatter);
+    hash_table_run(tasks, sizeof(hash_table_build_task), threads, hash_table_build_fill);
+    for (t = 0; t < threads; ++t)
+        hash_table_build_merge(ht, &tasks[t].local);
+    for (t = 0; t < threads; ++t) {
+        for (i = tasks[t].region_begin; i < tasks[t].deferred; ++i)
+            hash_table_insert_hash(ht, &data[items[i].index], items[i].hash);
+    }
+    free(items);
+    free(offset);
+    free(tasks);
+    return 1;
+}
+
+int hash_table_delete(hash_table *ht, const hash_table_key_type *key_ptr)
 {
     unsigned long addr;
+    unsigned long probe = 0;
+    hash_table_hash_type hash;
     assert(ht != NULL);
     assert(key_ptr != NULL);
-    addr = hash_table_get_address(ht, key_ptr);
-    while (ht->occupation[addr]) {
-        if (!ht->remove_flag[addr] && hash_table_key_compare(&ht->data[addr].key, key_ptr) == 0) {
-            ht->remove_flag[addr] = 1;
+    if (hash_table_read_only(ht))
+        return 0;
+    hash = hash_table_get_hash(ht, key_ptr);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    hash_table_migrate(ht, HASH_TABLE_MIGRATE_STEP);
+    if (ht->old_table != NULL) {
+        addr = hash_table_find_slot(ht->old_table, key_ptr, hash, &probe);
+        if (addr != ht->old_table->capacity) {
+#ifdef HASH_TABLE_BYTE_KEYS
+            hash_table_key_discard(ht, &ht->old_table->data[addr].key);
+#endif
+            hash_table_set_ctrl(ht->old_table, addr, HASH_TABLE_CTRL_DELETED);
             --ht->size;
-            break;
+            return 1;
         }
-        addr = linear_probing(ht, addr);
     }
+#endif
+    addr = hash_table_find_slot(ht, key_ptr, hash, &probe);
+    if (addr == ht->capacity)
+        return 1;
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_key_discard(ht, &ht->data[addr].key);
+#endif
+    hash_table_erase(ht, addr);
+    --ht->size;
+    return 1;
+}
+
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+static unsigned long hash_table_erase_if_old(hash_table *ht, hash_table_pred_func_type pred, void *arg)
+{
+    unsigned long addr;
+    unsigned long slot;
+    unsigned long ret = 0;
+    unsigned int match;
+    hash_table *old_table = NULL;
+    assert(ht != NULL);
+    assert(pred != NULL);
+    old_table = ht->old_table;
+    for (addr = 0; addr < old_table->capacity; addr += HASH_TABLE_GROUP_WIDTH) {
+        for (match = group_match_full(old_table->ctrl + addr); match; match &= match - 1) {
+            slot = addr + trailing_zeros(match);
+            if (!pred(&old_table->data[slot], arg))
+                continue;
+#ifdef HASH_TABLE_BYTE_KEYS
+            hash_table_key_discard(ht, &old_table->data[slot].key);
+#endif
+            hash_table_set_ctrl(old_table, slot, HASH_TABLE_CTRL_DELETED);
+            ++ret;
+        }
+    }
+    return ret;
+}
+#endif
+
+unsigned long hash_table_erase_if(hash_table *ht, hash_table_pred_func_type pred, void *arg)
+{
+    unsigned long i;
+    unsigned long addr;
+    unsigned long slot;
+    unsigned long start = 0;
+    unsigned long ret = 0;
+    unsigned int bit;
+    unsigned int match;
+    assert(ht != NULL);
+    assert(pred != NULL);
+    if (hash_table_read_only(ht))
+        return 0;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_table != NULL)
+        ret += hash_table_erase_if_old(ht, pred, arg);
+#endif
+#ifdef HASH_TABLE_ROBIN_HOOD
+    while (start < ht->capacity && ht->ctrl[start] != HASH_TABLE_CTRL_EMPTY)
+        ++start;
+#endif
+    for (i = 0; i < ht->capacity; i += HASH_TABLE_GROUP_WIDTH) {
+        addr = (start + i) & ht->mask;
+        match = group_match_full(ht->ctrl + addr);
+        while (match) {
+            bit = trailing_zeros(match);
+            slot = (addr + bit) & ht->mask;
+            if (!pred(&ht->data[slot], arg)) {
+                match &= match - 1;
+                continue;
+            }
+#ifdef HASH_TABLE_BYTE_KEYS
+            hash_table_key_discard(ht, &ht->data[slot].key);
+#endif
+            hash_table_erase(ht, slot);
+            ++ret;
+            match = group_match_full(ht->ctrl + addr) & (~0u << bit);
+        }
+    }
+    ht->size -= ret;
+    return ret;
+}
+
+static inline unsigned int hash_table_iterator_load(const hash_table_iterator *it)
+{
+    assert(it != NULL);
+    return it->addr < it->table->capacity ? group_match_full(it->table->ctrl + it->addr) : 0;
+}
+
+void hash_table_iterator_init(hash_table_iterator *it, hash_table *ht)
+{
+    assert(it != NULL);
+    assert(ht != NULL);
+    it->ht = ht;
+    it->table = ht;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_table != NULL)
+        it->table = ht->old_table;
+#endif
+    it->addr = 0;
+    it->match = hash_table_iterator_load(it);
+}
+
+hash_table_data_type *hash_table_iterator_next(hash_table_iterator *it)
+{
+    unsigned long slot;
+    assert(it != NULL);
+    while (it->match == 0) {
+        if (it->addr >= it->table->capacity) {
+            if (it->table == it->ht)
+                return NULL;
+            it->table = it->ht;
+            it->addr = 0;
+        } else {
+            it->addr += HASH_TABLE_GROUP_WIDTH;
+        }
+        it->match = hash_table_iterator_load(it);
+    }
+    slot = it->addr + trailing_zeros(it->match);
+    it->match &= it->match - 1;
+    return &it->table->data[slot];
+}
+
+static void hash_table_scan(hash_table *table, unsigned long begin, unsigned long end, hash_table_visit_func_type func, void *arg)
+{
+    unsigned long addr;
+    unsigned int match;
+    assert(table != NULL);
+    assert(func != NULL);
+    for (addr = begin; addr < end; addr += HASH_TABLE_GROUP_WIDTH) {
+        for (match = group_match_full(table->ctrl + addr); match; match &= match - 1)
+            func(&table->data[addr + trailing_zeros(match)], arg);
+    }
+}
+
+static inline void hash_table_scan_part(hash_table *table, unsigned int index, unsigned int parts, hash_table_visit_func_type func, void *arg)
+{
+    unsigned long groups;
+    assert(table != NULL);
+    groups = table->capacity / HASH_TABLE_GROUP_WIDTH;
+    hash_table_scan(table, groups * index / parts * HASH_TABLE_GROUP_WIDTH, groups * (index + 1) / parts * HASH_TABLE_GROUP_WIDTH, func, arg);
+}
+
+static void *hash_table_scan_worker(void *arg)
+{
+    hash_table_scan_task *task = (hash_table_scan_task *)arg;
+    assert(task != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (task->ht->old_table != NULL)
+        hash_table_scan_part(task->ht->old_table, task->index, task->threads, task->func, task->arg);
+#endif
+    hash_table_scan_part(task->ht, task->index, task->threads, task->func, task->arg);
+    return NULL;
+}
+
+void hash_table_for_each(hash_table *ht, hash_table_visit_func_type func, void *arg)
+{
+    assert(ht != NULL);
+    assert(func != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_table != NULL)
+        hash_table_scan(ht->old_table, 0, ht->old_table->capacity, func, arg);
+#endif
+    hash_table_scan(ht, 0, ht->capacity, func, arg);
+}
+
+void hash_table_parallel_for_each(hash_table *ht, hash_table_visit_func_type func, void *arg, unsigned int threads)
+{
+    unsigned int t;
+    hash_table_scan_task tasks[HASH_TABLE_MAX_THREADS];
+    assert(ht != NULL);
+    assert(func != NULL);
+    threads = hash_table_threads(ht, threads);
+    for (t = 0; t < threads; ++t) {
+        tasks[t].ht = ht;
+        tasks[t].func = func;
+        tasks[t].arg = arg;
+        tasks[t].index = t;
+        tasks[t].threads = threads;
+    }
+    hash_table_run(tasks, sizeof(hash_table_scan_task), threads, hash_table_scan_worker);
 }
 
 inline void hash_table_clear(hash_table *ht)
 {
     assert(ht != NULL);
-    memset(ht->occupation, 0, ht->capacity * sizeof(hash_table_bool_type));
-    memset(ht->remove_flag, 0, ht->capacity * sizeof(hash_table_bool_type));
-    ht->size = 0;
+    if (hash_table_read_only(ht))
+        return;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_table != NULL) {
+        hash_table_destroy(ht->old_table);
+        free(ht->old_table);
+        ht->old_table = NULL;
+    }
+#endif
+    if (ht->capacity)
+        memset(ht->ctrl, HASH_TABLE_CTRL_EMPTY, (ht->capacity + HASH_TABLE_GROUP_WIDTH - 1) * sizeof(hash_table_ctrl_type));
+    ht->size = ht->deleted = 0;
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_arena_release(ht->arena);
+    ht->arena = NULL;
+    ht->arena_size = ht->arena_garbage = 0;
+#endif
+}
+
+void hash_table_shrink_to_fit(hash_table *ht)
+{
+    unsigned long new_capacity;
+    assert(ht != NULL);
+    if (hash_table_read_only(ht))
+        return;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    hash_table_migrate(ht, ~0UL);
+#endif
+    if (ht->size == 0) {
+        hash_table_destroy(ht);
+        return;
+    }
+    new_capacity = hash_table_min_capacity(ht, ht->size);
+    if (new_capacity < ht->capacity) {
+        hash_table_resize(ht, new_capacity);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+        hash_table_migrate(ht, ~0UL);
+#endif
+    }
+#ifndef HASH_TABLE_ROBIN_HOOD
+    else if (ht->deleted) {
+        hash_table_purge(ht);
+    }
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+    if (ht->arena_garbage)
+        hash_table_arena_compact(ht);
+#endif
 }
 
 inline void hash_table_destroy(hash_table *ht)
 {
     assert(ht != NULL);
+#ifndef HASH_TABLE_BYTE_KEYS
+    if (ht->snapshot != NULL)
+        hash_table_snapshot_unmap(ht);
+#endif
     free(ht->data);
-    free(ht->occupation);
-    free(ht->remove_flag);
-    ht->size = ht->capacity = 0;
+    free(ht->ctrl);
+    ht->data = NULL;
+    ht->ctrl = NULL;
+#ifdef HASH_TABLE_ROBIN_HOOD
+    free(ht->dist);
+    ht->dist = NULL;
+#endif
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_table != NULL) {
+        hash_table_destroy(ht->old_table);
+        free(ht->old_table);
+        ht->old_table = NULL;
+    }
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_arena_release(ht->arena);
+    ht->arena = NULL;
+    ht->arena_size = ht->arena_garbage = 0;
+#endif
+    ht->size = ht->deleted = ht->capacity = 0;
+}
+
+#ifndef HASH_TABLE_BYTE_KEYS
+static inline unsigned long long hash_table_snapshot_align(unsigned long long offset)
+{
+    return (offset + HASH_TABLE_SNAPSHOT_ALIGN - 1) & ~(unsigned long long)(HASH_TABLE_SNAPSHOT_ALIGN - 1);
+}
+
+static inline unsigned int hash_table_snapshot_flags(void)
+{
+#ifdef HASH_TABLE_ROBIN_HOOD
+    return HASH_TABLE_SNAPSHOT_ROBIN_HOOD;
+#else
+    return 0;
+#endif
+}
+
+static void hash_table_snapshot_layout(hash_table_snapshot_header *header, unsigned long long capacity)
+{
+    assert(header != NULL);
+    memset(header, 0, sizeof(hash_table_snapshot_header));
+    memcpy(header->magic, HASH_TABLE_SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->version = HASH_TABLE_SNAPSHOT_VERSION;
+    header->flags = hash_table_snapshot_flags();
+    header->group_width = HASH_TABLE_GROUP_WIDTH;
+    header->data_size = sizeof(hash_table_data_type);
+    header->capacity = capacity;
+    header->ctrl_offset = hash_table_snapshot_align(sizeof(hash_table_snapshot_header));
+    header->dist_offset = hash_table_snapshot_align(header->ctrl_offset + (capacity ? capacity + HASH_TABLE_GROUP_WIDTH - 1 : 0) * sizeof(hash_table_ctrl_type));
+    header->data_offset = header->dist_offset;
+#ifdef HASH_TABLE_ROBIN_HOOD
+    header->data_offset = hash_table_snapshot_align(header->dist_offset + capacity * sizeof(hash_table_dist_type));
+#endif
+    header->file_size = header->data_offset + capacity * sizeof(hash_table_data_type);
+}
+
+static int hash_table_write_padding(FILE *file, unsigned long long offset, unsigned long long target)
+{
+    static const char zero[HASH_TABLE_SNAPSHOT_ALIGN];
+    assert(file != NULL);
+    assert(offset <= target && target - offset <= HASH_TABLE_SNAPSHOT_ALIGN);
+    return fwrite(zero, 1, (size_t)(target - offset), file) == (size_t)(target - offset);
+}
+
+static void *hash_table_map_file(const char *path, unsigned long long *size_ptr)
+{
+    void *ret = NULL;
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+    LARGE_INTEGER size;
+    assert(path != NULL);
+    assert(size_ptr != NULL);
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+        return NULL;
+    ret = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    *size_ptr = (unsigned long long)size.QuadPart;
+#else
+    int fd;
+    struct stat st;
+    assert(path != NULL);
+    assert(size_ptr != NULL);
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    ret = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ret == MAP_FAILED)
+        return NULL;
+    *size_ptr = (unsigned long long)st.st_size;
+#endif
+    return ret;
+}
+
+static void hash_table_unmap_file(void *base, unsigned long long size)
+{
+    assert(base != NULL);
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(base);
+#else
+    munmap(base, (size_t)size);
+#endif
+}
+
+static void hash_table_snapshot_unmap(hash_table *ht)
+{
+    assert(ht != NULL);
+    assert(ht->snapshot != NULL);
+    hash_table_unmap_file(ht->snapshot, ht->snapshot_size);
+    ht->snapshot = NULL;
+    ht->snapshot_size = 0;
+    ht->data = NULL;
+    ht->ctrl = NULL;
+#ifdef HASH_TABLE_ROBIN_HOOD
+    ht->dist = NULL;
+#endif
+}
+
+int hash_table_save(hash_table *ht, const char *path)
+{
+    unsigned long i;
+    int ok;
+    FILE *file = NULL;
+    hash_table_snapshot_header header;
+    hash_table_data_type empty;
+    assert(ht != NULL);
+    assert(path != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    hash_table_migrate(ht, ~0UL);
+#endif
+    hash_table_snapshot_layout(&header, ht->capacity);
+    header.size = ht->size;
+    header.deleted = ht->deleted;
+    header.seed = ht->seed;
+    file = fopen(path, "wb");
+    if (file == NULL)
+        return 0;
+    memset(&empty, 0, sizeof(hash_table_data_type));
+    ok = fwrite(&header, sizeof(hash_table_snapshot_header), 1, file) == 1;
+    ok = ok && hash_table_write_padding(file, sizeof(hash_table_snapshot_header), header.ctrl_offset);
+    if (ht->capacity) {
+        ok = ok && fwrite(ht->ctrl, sizeof(hash_table_ctrl_type), ht->capacity + HASH_TABLE_GROUP_WIDTH - 1, file) == ht->capacity + HASH_TABLE_GROUP_WIDTH - 1;
+        ok = ok && hash_table_write_padding(file, header.ctrl_offset + (ht->capacity + HASH_TABLE_GROUP_WIDTH - 1) * sizeof(hash_table_ctrl_type), header.dist_offset);
+#ifdef HASH_TABLE_ROBIN_HOOD
+        ok = ok && fwrite(ht->dist, sizeof(hash_table_dist_type), ht->capacity, file) == ht->capacity;
+        ok = ok && hash_table_write_padding(file, header.dist_offset + ht->capacity * sizeof(hash_table_dist_type), header.data_offset);
+#endif
+        for (i = 0; ok && i < ht->capacity; ++i)
+            ok = fwrite(ht->ctrl[i] >= 0 ? &ht->data[i] : &empty, sizeof(hash_table_data_type), 1, file) == 1;
+    }
+    if (fclose(file) != 0)
+        ok = 0;
+    if (!ok)
+        remove(path);
+    return ok;
+}
+
+int hash_table_open_snapshot(hash_table *ht, const char *path)
+{
+    void *base = NULL;
+    unsigned long long size;
+    hash_table_snapshot_header header;
+    hash_table_snapshot_header expected;
+    assert(ht != NULL);
+    assert(path != NULL);
+    base = hash_table_map_file(path, &size);
+    if (base == NULL)
+        return 0;
+    if (size < sizeof(hash_table_snapshot_header)) {
+        hash_table_unmap_file(base, size);
+        return 0;
+    }
+    memcpy(&header, base, sizeof(hash_table_snapshot_header));
+    hash_table_snapshot_layout(&expected, header.capacity);
+    if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version
+        || header.flags != expected.flags || header.group_width != expected.group_width || header.data_size != expected.data_size
+        || (header.capacity & (header.capacity - 1)) || (header.capacity && header.capacity < HASH_TABLE_GROUP_WIDTH)
+        || header.size > header.capacity || header.ctrl_offset != expected.ctrl_offset || header.dist_offset != expected.dist_offset
+        || header.data_offset != expected.data_offset || header.file_size != expected.file_size || size < header.file_size) {
+        hash_table_unmap_file(base, size);
+        return 0;
+    }
+    hash_table_destroy(ht);
+    ht->seed = header.seed;
+    if (header.capacity == 0) {
+        hash_table_unmap_file(base, size);
+        return 1;
+    }
+    ht->snapshot = base;
+    ht->snapshot_size = size;
+    ht->capacity = (unsigned long)header.capacity;
+    ht->size = (unsigned long)header.size;
+    ht->deleted = (unsigned long)header.deleted;
+    ht->mask = ht->capacity - 1;
+    ht->ctrl = (hash_table_ctrl_type *)((char *)base + header.ctrl_offset);
+#ifdef HASH_TABLE_ROBIN_HOOD
+    ht->dist = (hash_table_dist_type *)((char *)base + header.dist_offset);
+#endif
+    ht->data = (hash_table_data_type *)((char *)base + header.data_offset);
+    return 1;
+}
+#endif
+
+#ifdef HASH_TABLE_STATS
+// Rehash time is wall-clock time on the monotonic clock the benchmark harness uses, not CPU time.
+static double hash_table_stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static unsigned long hash_table_bytes_allocated(const hash_table *ht)
+{
+    unsigned long ret = 0;
+    assert(ht != NULL);
+    if (ht->capacity) {
+        ret += ht->capacity * sizeof(hash_table_data_type);
+        ret += (ht->capacity + HASH_TABLE_GROUP_WIDTH - 1) * sizeof(hash_table_ctrl_type);
+#ifdef HASH_TABLE_ROBIN_HOOD
+        ret += ht->capacity * sizeof(hash_table_dist_type);
+#endif
+    }
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_table != NULL)
+        ret += sizeof(hash_table) + hash_table_bytes_allocated(ht->old_table);
+#endif
+    return ret;
+}
+
+static void hash_table_stats_merge(hash_table_stats *dest, const hash_table_stats *source)
+{
+    unsigned long i;
+    assert(dest != NULL);
+    assert(source != NULL);
+    for (i = 0; i < HASH_TABLE_STATS_HISTOGRAM_SIZE; ++i) {
+        dest->find_probes[i] += source->find_probes[i];
+        dest->insert_probes[i] += source->insert_probes[i];
+    }
+}
+
+void hash_table_get_stats(const hash_table *ht, hash_table_stats *stats)
+{
+#ifdef HASH_TABLE_BYTE_KEYS
+    const hash_table_arena *arena = NULL;
+#endif
+    assert(ht != NULL);
+    assert(stats != NULL);
+    *stats = ht->stats;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_table != NULL)
+        hash_table_stats_merge(stats, &ht->old_table->stats);
+#endif
+    stats->tombstones = ht->deleted;
+    stats->bytes_allocated = hash_table_bytes_allocated(ht);
+#ifdef HASH_TABLE_BYTE_KEYS
+    for (arena = ht->arena; arena != NULL; arena = arena->next)
+        stats->bytes_allocated += sizeof(hash_table_arena) + arena->capacity;
+#endif
+}
+
+void hash_table_reset_stats(hash_table *ht)
+{
+    assert(ht != NULL);
+    memset(&ht->stats, 0, sizeof(hash_table_stats));
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_table != NULL)
+        memset(&ht->old_table->stats, 0, sizeof(hash_table_stats));
+#endif
+}
+#endif
+
+#ifdef HASH_TABLE_BYTE_KEYS
+static void hash_table_arena_grow(hash_table *ht, unsigned long size)
+{
+    unsigned long capacity = HASH_TABLE_ARENA_MIN_CAPACITY;
+    hash_table_arena *arena = NULL;
+    assert(ht != NULL);
+    if (ht->arena != NULL)
+        capacity = ht->arena->capacity < HASH_TABLE_ARENA_MAX_CAPACITY ? ht->arena->capacity << 1 : ht->arena->capacity;
+    if (capacity < size)
+        capacity = size;
+    arena = (hash_table_arena *)malloc(sizeof(hash_table_arena) + capacity);
+    assert(arena != NULL);
+    arena->next = ht->arena;
+    arena->capacity = capacity;
+    arena->used = 0;
+    ht->arena = arena;
+}
+
+static void hash_table_arena_release(hash_table_arena *arena)
+{
+    hash_table_arena *tmp = NULL;
+    while (arena != NULL) {
+        tmp = arena->next;
+        free(arena);
+        arena = tmp;
+    }
+}
+
+static const char *hash_table_arena_copy(hash_table *ht, const char *data, unsigned long size)
+{
+    char *ret = NULL;
+    assert(ht != NULL);
+    if (ht->arena == NULL || ht->arena->capacity - ht->arena->used < size)
+        hash_table_arena_grow(ht, size);
+    ret = ht->arena->data + ht->arena->used;
+    ht->arena->used += size;
+    if (size)
+        memcpy(ret, data, size);
+    return ret;
+}
+
+static void hash_table_arena_move(hash_table *ht, hash_table *table)
+{
+    unsigned long i;
+    assert(ht != NULL);
+    assert(table != NULL);
+    for (i = 0; i < table->capacity; ++i) {
+        if (table->ctrl[i] >= 0)
+            table->data[i].key.data = hash_table_arena_copy(ht, table->data[i].key.data, table->data[i].key.size);
+    }
+}
+
+static void hash_table_arena_compact(hash_table *ht)
+{
+    hash_table_arena *old_arena = NULL;
+    assert(ht != NULL);
+    old_arena = ht->arena;
+    ht->arena = NULL;
+    if (ht->arena_size)
+        hash_table_arena_grow(ht, ht->arena_size);
+    hash_table_arena_move(ht, ht);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_table != NULL)
+        hash_table_arena_move(ht, ht->old_table);
+#endif
+    hash_table_arena_release(old_arena);
+    ht->arena_garbage = 0;
+}
+
+static void hash_table_key_store(hash_table *ht, hash_table_key_type *key_ptr, hash_table_hash_type hash)
+{
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    if ((ht->arena == NULL || ht->arena->capacity - ht->arena->used < key_ptr->size) && ht->arena_garbage > ht->arena_size)
+        hash_table_arena_compact(ht);
+    key_ptr->data = hash_table_arena_copy(ht, key_ptr->data, key_ptr->size);
+    key_ptr->hash = hash;
+    ht->arena_size += key_ptr->size;
+}
+
+static inline void hash_table_key_discard(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    ht->arena_size -= key_ptr->size;
+    ht->arena_garbage += key_ptr->size;
+}
+
+static void hash_table_arena_splice(hash_table *ht, hash_table_arena *arena)
+{
+    hash_table_arena *tail = NULL;
+    assert(ht != NULL);
+    if (arena == NULL)
+        return;
+    tail = arena;
+    while (tail->next != NULL)
+        tail = tail->next;
+    tail->next = ht->arena;
+    ht->arena = arena;
 }
+#endif
\ No newline at end of file
@@ -1,33 +1,151 @@
 #ifndef __HASH_TABLE_H__
 #define __HASH_TABLE_H__
 
+// Uncomment to place entries by Robin Hood hashing; deletes then shift the cluster back instead of leaving tombstones.
+// #define HASH_TABLE_ROBIN_HOOD
+// Uncomment to spread each resize over later operations instead of moving every entry at once.
+// #define HASH_TABLE_INCREMENTAL_REHASH
+// Uncomment to record probe lengths and rehash costs, read back through hash_table_get_stats.
+// #define HASH_TABLE_STATS
+// Uncomment to key entries by byte strings; key bytes are copied into a per-table arena and each stored key caches its full hash.
+// #define HASH_TABLE_BYTE_KEYS
+
+typedef unsigned long long hash_table_hash_type;
+#ifdef HASH_TABLE_BYTE_KEYS
+typedef struct HashTableKey
+{
+    const char *data;
+    unsigned long size;
+    hash_table_hash_type hash;
+} hash_table_key_type;
+typedef struct HashTableArena
+{
+    struct HashTableArena *next;
+    unsigned long capacity;
+    unsigned long used;
+    char data[];
+} hash_table_arena;
+#else
 typedef int hash_table_key_type;
+#endif
 typedef int hash_table_val_type;
-typedef unsigned char hash_table_bool_type;
+typedef hash_table_hash_type (*hash_table_hash_func_type)(const hash_table_key_type *, hash_table_hash_type);
+typedef signed char hash_table_ctrl_type;
+#ifdef HASH_TABLE_ROBIN_HOOD
+typedef unsigned int hash_table_dist_type;
+#endif
 typedef struct HashTableDataNode
 {
     hash_table_key_type key;
     hash_table_val_type val;
 } hash_table_data_type;
+#ifdef HASH_TABLE_STATS
+// Probe histograms count the groups scanned per operation; the last bucket collects every longer probe.
+// find_probes covers the public lookups only, not the ones inside insert; rehash_time is wall-clock seconds.
+#define HASH_TABLE_STATS_HISTOGRAM_SIZE 16
+typedef struct HashTableStats
+{
+    unsigned long find_probes[HASH_TABLE_STATS_HISTOGRAM_SIZE];
+    unsigned long insert_probes[HASH_TABLE_STATS_HISTOGRAM_SIZE];
+    unsigned long tombstones;
+    unsigned long rehash_count;
+    double rehash_time;
+    unsigned long bytes_allocated;
+} hash_table_stats;
+#endif
+#ifndef HASH_TABLE_BYTE_KEYS
+// Snapshots hold this header followed by ctrl, dist and data at aligned offsets, in native byte order.
+// A table opened from a snapshot maps them read-only until hash_table_destroy. Writes are refused: insert, insert_batch,
+// delete and build_from_array return 0, erase_if removes nothing, and clear and shrink_to_fit leave the table unchanged.
+typedef struct HashTableSnapshotHeader
+{
+    char magic[8];
+    unsigned int version;
+    unsigned int flags;
+    unsigned int group_width;
+    unsigned int data_size;
+    unsigned long long capacity;
+    unsigned long long size;
+    unsigned long long deleted;
+    unsigned long long seed;
+    unsigned long long ctrl_offset;
+    unsigned long long dist_offset;
+    unsigned long long data_offset;
+    unsigned long long file_size;
+} hash_table_snapshot_header;
+#endif
 typedef struct HashTable
 {
     hash_table_data_type *data;
-    hash_table_bool_type *occupation;
-    hash_table_bool_type *remove_flag;
+    hash_table_ctrl_type *ctrl;
+#ifdef HASH_TABLE_ROBIN_HOOD
+    hash_table_dist_type *dist;
+#endif
     unsigned long capacity;
     unsigned long size;
+    unsigned long deleted;
     unsigned long mask;
     double load_factor;
+    double purge_factor;
+    hash_table_hash_func_type hash_func;
+    hash_table_hash_type seed;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    struct HashTable *old_table;
+    unsigned long migrate_pos;
+#endif
+#ifdef HASH_TABLE_STATS
+    hash_table_stats stats;
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_arena *arena;
+    unsigned long arena_size;
+    unsigned long arena_garbage;
+#else
+    void *snapshot;
+    unsigned long long snapshot_size;
+#endif
 } hash_table;
+// Iteration walks the slots in order and skips runs of empty or deleted slots a ctrl group at a time.
+// An iterator stays valid only while the table is not modified; with incremental rehash it covers the old table first.
+typedef struct HashTableIterator
+{
+    hash_table *ht;
+    hash_table *table;
+    unsigned long addr;
+    unsigned int match;
+} hash_table_iterator;
+typedef void (*hash_table_visit_func_type)(hash_table_data_type *, void *);
+typedef int (*hash_table_pred_func_type)(const hash_table_data_type *, void *);
 
+hash_table_hash_type hash_table_default_hash(const hash_table_key_type *, hash_table_hash_type);
 void hash_table_init(hash_table *, double);
+void hash_table_init_with_hash(hash_table *, double, hash_table_hash_func_type);
 unsigned long hash_table_size(const hash_table *);
 unsigned long hash_table_capacity(const hash_table *);
 int hash_table_empty(const hash_table *);
+int hash_table_read_only(const hash_table *);
+void hash_table_set_purge_factor(hash_table *, double);
+void hash_table_shrink_to_fit(hash_table *);
 hash_table_val_type *hash_table_find(hash_table *, const hash_table_key_type *);
-void hash_table_insert(hash_table *, const hash_table_data_type *);
-void hash_table_delete(hash_table *, const hash_table_key_type *);
+void hash_table_find_batch(hash_table *, const hash_table_key_type *, unsigned long, hash_table_val_type **);
+int hash_table_insert(hash_table *, const hash_table_data_type *);
+int hash_table_insert_batch(hash_table *, const hash_table_data_type *, unsigned long);
+int hash_table_build_from_array(hash_table *, const hash_table_data_type *, unsigned long, unsigned int);
+int hash_table_delete(hash_table *, const hash_table_key_type *);
+unsigned long hash_table_erase_if(hash_table *, hash_table_pred_func_type, void *);
+void hash_table_iterator_init(hash_table_iterator *, hash_table *);
+hash_table_data_type *hash_table_iterator_next(hash_table_iterator *);
+void hash_table_for_each(hash_table *, hash_table_visit_func_type, void *);
+void hash_table_parallel_for_each(hash_table *, hash_table_visit_func_type, void *, unsigned int);
 void hash_table_clear(hash_table *);
 void hash_table_destroy(hash_table *);
+#ifdef HASH_TABLE_STATS
+void hash_table_get_stats(const hash_table *, hash_table_stats *);
+void hash_table_reset_stats(hash_table *);
+#endif
+#ifndef HASH_TABLE_BYTE_KEYS
+int hash_table_save(hash_table *, const char *);
+int hash_table_open_snapshot(hash_table *, const char *);
+#endif
 
 #endif // __HASH_TABLE_H__
\ No newline at end of file
@@ -1,52 +1,193 @@
 #include "hash_table.h"
+#include "../../benchmark/benchmark.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
+#ifdef HASH_TABLE_BYTE_KEYS
+// Byte keys are the decimal text of the int keys, so the workload also exercises the key arena.
+#define MAXN (1 << 22)
+#define KEY_WIDTH 16
+#else
 #define MAXN (1 << 24)
+#endif
 #define OFFSET 5211314
+#define CHECKN 20000
 
-int main()
+hash_table *ht;
+hash_table_key_type *keys;
+#ifdef HASH_TABLE_BYTE_KEYS
+char *key_bytes;
+#endif
+
+void check(int ok, const char *what)
 {
-    int i;
-    int key;
-    int cnt = 0;
-    clock_t begin, end;
-    hash_table *ht = (hash_table *)malloc(sizeof(hash_table));
+    if (!ok) {
+        fprintf(stderr, "open_addressing: check failed: %s\n", what);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Key i of the check is stored under value i when i is even; odd keys are never inserted.
+void check_results(hash_table_val_type **results, unsigned long n, unsigned long stored)
+{
+    unsigned long i;
+    for (i = 0; i < n; ++i) {
+        if (i & 1 || i >= stored)
+            check(results[i] == NULL, "find_batch misses absent keys");
+        else
+            check(results[i] != NULL && *results[i] == (hash_table_val_type)i, "find_batch finds stored keys");
+    }
+}
+
+// Runs find_batch right after every resize and every 1024 inserts, so in the incremental rehash mode batches
+// also run while entries are still split between the old and the new table; every result is read after the call.
+void check_find_batch(void)
+{
+    unsigned long i;
+    unsigned long capacity;
+    hash_table local;
+    hash_table_key_type *check_keys = (hash_table_key_type *)malloc(sizeof(hash_table_key_type) * CHECKN);
+    hash_table_val_type **results = (hash_table_val_type **)malloc(sizeof(hash_table_val_type *) * CHECKN);
+#ifdef HASH_TABLE_BYTE_KEYS
+    char *check_bytes = (char *)malloc(KEY_WIDTH * CHECKN);
+#endif
+    check(check_keys != NULL && results != NULL, "allocation");
+#ifdef HASH_TABLE_BYTE_KEYS
+    check(check_bytes != NULL, "allocation");
+#endif
+
+    for (i = 0; i < CHECKN; ++i) {
+#ifdef HASH_TABLE_BYTE_KEYS
+        check_keys[i].data = check_bytes + i * KEY_WIDTH;
+        check_keys[i].size = (unsigned long)sprintf(check_bytes + i * KEY_WIDTH, "check:%lu", i);
+        check_keys[i].hash = 0;
+#else
+        check_keys[i] = (hash_table_key_type)i;
+#endif
+    }
+    hash_table_init(&local, 0.5);
+    for (i = 0; i < CHECKN; i += 2) {
+        capacity = hash_table_capacity(&local);
+        hash_table_insert(&local, &(hash_table_data_type){check_keys[i], (hash_table_val_type)i});
+        if (hash_table_capacity(&local) != capacity || i % 1024 == 0) {
+            hash_table_find_batch(&local, check_keys, CHECKN, results);
+            check_results(results, CHECKN, i + 1);
+        }
+    }
+    hash_table_find_batch(&local, check_keys, CHECKN, results);
+    check_results(results, CHECKN, CHECKN);
+    hash_table_destroy(&local);
+
+    free(check_keys);
+    free(results);
+#ifdef HASH_TABLE_BYTE_KEYS
+    free(check_bytes);
+#endif
+}
+
+void setup_empty(void *arg)
+{
+    (void)arg;
     hash_table_init(ht, 0.5);
+}
 
-    srand((unsigned int)time(NULL));
-    begin = clock();
+void setup_full(void *arg)
+{
+    int i;
+    setup_empty(arg);
+    for (i = 0; i < MAXN; ++i)
+        hash_table_insert(ht, &(hash_table_data_type){keys[i], i});
+}
+
+void setup_deleted(void *arg)
+{
+    int i;
+    setup_full(arg);
+    for (i = 0; i < (MAXN >> 2); ++i)
+        hash_table_delete(ht, &keys[i]);
+}
+
+void teardown(void *arg)
+{
+    (void)arg;
+    hash_table_destroy(ht);
+}
+
+void insert_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < MAXN; ++i) {
-        key = (rand() << 8) - OFFSET + (i & 1 ? i : -i);
-        hash_table_insert(ht, &(hash_table_data_type){key, i});
+        benchmark_op_begin(rec);
+        hash_table_insert(ht, &(hash_table_data_type){keys[i], i});
+        benchmark_op_end(rec);
     }
-    end = clock();
-    printf("%lldms\n", end - begin);
-    printf("%lu %lu\n", hash_table_size(ht), hash_table_capacity(ht));
-    
-    srand((unsigned int)time(NULL));
-    begin = clock();
+    rec->checksum = hash_table_size(ht);
+}
+
+void delete_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < (MAXN >> 2); ++i) {
-        key = (rand() << 8) - OFFSET + (i & 1 ? i : -i);
-        hash_table_delete(ht, &key);
+        benchmark_op_begin(rec);
+        hash_table_delete(ht, &keys[i]);
+        benchmark_op_end(rec);
     }
-    end = clock();
-    printf("%lldms\n", end - begin);
-    printf("%lu %lu\n", hash_table_size(ht), hash_table_capacity(ht));
+    rec->checksum = hash_table_size(ht);
+}
 
-    srand((unsigned int)time(NULL));
-    begin = clock();
+void find_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    int i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < (MAXN >> 1); ++i) {
+        benchmark_op_begin(rec);
+        if (hash_table_find(ht, &keys[i]) != NULL)
+            ++rec->checksum;
+        benchmark_op_end(rec);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+    int key;
+    benchmark b;
+    ht = (hash_table *)malloc(sizeof(hash_table));
+    keys = (hash_table_key_type *)malloc(sizeof(hash_table_key_type) * MAXN);
+#ifdef HASH_TABLE_BYTE_KEYS
+    key_bytes = (char *)malloc(KEY_WIDTH * MAXN);
+#endif
+
+    srand((unsigned int)time(NULL));
+    for (i = 0; i < MAXN; ++i) {
         key = (rand() << 8) - OFFSET + (i & 1 ? i : -i);
-        if (hash_table_find(ht, &key) != NULL)
-            ++cnt;
+#ifdef HASH_TABLE_BYTE_KEYS
+        keys[i].data = key_bytes + (size_t)i * KEY_WIDTH;
+        keys[i].size = (unsigned long)sprintf(key_bytes + (size_t)i * KEY_WIDTH, "key:%d", key);
+        keys[i].hash = 0;
+#else
+        keys[i] = key;
+#endif
     }
-    end = clock();
-    printf("%lldms\n", end - begin);
-    printf("%d\n", cnt);
 
-    hash_table_destroy(ht);
+    check_find_batch();
+
+    benchmark_init(&b, "open_addressing", argc, argv);
+    benchmark_run(&b, &(benchmark_case){"insert", 1, setup_empty, insert_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"delete", 1, setup_full, delete_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"find", 1, setup_deleted, find_run, teardown, NULL});
+    benchmark_finish(&b);
+
     free(ht);
+    free(keys);
+#ifdef HASH_TABLE_BYTE_KEYS
+    free(key_bytes);
+#endif
     return 0;
 }
\ No newline at end of file
@@ -1,27 +1,145 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
 #include "hash_table.h"
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+#define HASH_TABLE_MIGRATE_STEP 16
+#define HASH_TABLE_BATCH_SIZE 16
+#define HASH_TABLE_SLAB_MIN_CAPACITY 16
+#define HASH_TABLE_SLAB_MAX_CAPACITY 65536
+#define HASH_TABLE_ARENA_MIN_CAPACITY 4096
+#define HASH_TABLE_ARENA_MAX_CAPACITY (1 << 20)
+#define HASH_TABLE_MAX_THREADS 64
+#define HASH_TABLE_MIN_REGION 4096
+#define HASH_TABLE_SCAN_PREFETCH 4
+
+#if defined(__GNUC__)
+#define HASH_TABLE_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+#define HASH_TABLE_PREFETCH(ptr) ((void)(ptr))
+#endif
+
+#ifdef HASH_TABLE_STATS
+#define HASH_TABLE_STATS_RECORD(histogram, length) ++(histogram)[(length) < HASH_TABLE_STATS_HISTOGRAM_SIZE ? (length) : HASH_TABLE_STATS_HISTOGRAM_SIZE - 1]
+#else
+#define HASH_TABLE_STATS_RECORD(histogram, length)
+#endif
+
+// Bulk build splits the buckets into one range per thread; each thread fills its range through a private copy of the table header.
+typedef struct HashTableBuildItem
+{
+    hash_table_hash_type hash;
+    unsigned long index;
+} hash_table_build_item;
+typedef struct HashTableBuildTask
+{
+    hash_table local;
+    const hash_table_data_type *data;
+    hash_table_build_item *items;
+    unsigned long *offset;
+    unsigned long begin;
+    unsigned long end;
+    unsigned long region_begin;
+    unsigned long region_end;
+    unsigned int shift;
+} hash_table_build_task;
+// Parallel scans give each thread the same share of the bucket range in the old bucket array and in the current one.
+typedef struct HashTableScanTask
+{
+    hash_table *ht;
+    hash_table_visit_func_type func;
+    void *arg;
+    unsigned int index;
+    unsigned int threads;
+} hash_table_scan_task;
 
 static int hash_table_key_compare(const hash_table_key_type *, const hash_table_key_type *);
 static int hash_table_data_compare(const hash_table_data_type *, const hash_table_data_type *);
+static int hash_table_key_match(const hash_table_key_type *, const hash_table_key_type *, hash_table_hash_type);
 static void hash_table_key_copy(hash_table_key_type *, const hash_table_key_type *);
 static void hash_table_val_copy(hash_table_val_type *, const hash_table_val_type *);
 static void hash_table_data_copy(hash_table_data_type *, const hash_table_data_type *);
-static hash_table_list_node *create_hash_table_list_node(const hash_table_data_type *);
+static void hash_table_slab_grow(hash_table *);
+static void hash_table_slab_release(hash_table *);
+static hash_table_list_node *create_hash_table_list_node(hash_table *, const hash_table_data_type *);
+static void destroy_hash_table_list_node(hash_table *, hash_table_list_node *);
+static hash_table_hash_type hash_table_mix(hash_table_hash_type);
+static hash_table_hash_type hash_table_random_seed(const hash_table *);
 static int hash_table_overload(const hash_table *);
-static unsigned long hash_table_get_address(const hash_table *, const hash_table_key_type *);
+static hash_table_hash_type hash_table_get_hash(const hash_table *, const hash_table_key_type *);
+static hash_table_hash_type hash_table_get_entry_hash(const hash_table *, const hash_table_key_type *);
+static unsigned long hash_table_get_address(const hash_table *, hash_table_hash_type);
+static unsigned long hash_table_min_capacity(const hash_table *, unsigned long);
+static hash_table_list_node *hash_table_list_find(hash_table_list_node *, const hash_table_key_type *, hash_table_hash_type, unsigned long *);
+static unsigned long hash_table_list_length(const hash_table_list_node *);
+static unsigned long hash_table_list_delete(hash_table *, hash_table_list_node **, const hash_table_key_type *, hash_table_hash_type);
+static void hash_table_relink(hash_table *, hash_table_list_node *);
+static void hash_table_resize(hash_table *, unsigned long);
 static void hash_table_rehash(hash_table *);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+static unsigned long hash_table_get_old_address(const hash_table *, hash_table_hash_type);
+static void hash_table_migrate(hash_table *, unsigned long);
+#endif
+static hash_table_list_node *hash_table_lookup(hash_table *, const hash_table_key_type *, hash_table_hash_type, unsigned long *);
+static void hash_table_insert_hash(hash_table *, const hash_table_data_type *, hash_table_hash_type);
+static void hash_table_erase(hash_table *, const hash_table_key_type *, hash_table_hash_type);
+#ifdef HASH_TABLE_MULTIMAP
+static void hash_table_group_append(hash_table *, hash_table_list_node *, const hash_table_data_type *);
+#endif
+static void hash_table_slab_splice(hash_table *, hash_table *);
+static unsigned int hash_table_threads(const hash_table *, unsigned int);
+static void hash_table_run(void *, size_t, unsigned int, void *(*)(void *));
+static void *hash_table_build_count(void *);
+static void *hash_table_build_scatter(void *);
+static void *hash_table_build_fill(void *);
+static void hash_table_build_merge(hash_table *, hash_table *);
+static unsigned long hash_table_list_erase_if(hash_table *, hash_table_list_node **, hash_table_pred_func_type, void *);
+static void hash_table_scan(hash_table_list_node *const *, unsigned long, unsigned long, hash_table_visit_func_type, void *);
+static void hash_table_scan_part(hash_table_list_node *const *, unsigned long, unsigned int, unsigned int, hash_table_visit_func_type, void *);
+static void *hash_table_scan_worker(void *);
+#ifdef HASH_TABLE_STATS
+static double hash_table_stats_now(void);
+static void hash_table_stats_chains(hash_table_stats *, hash_table_list_node *const *, unsigned long);
+static void hash_table_stats_merge(hash_table_stats *, const hash_table_stats *);
+#endif
+#ifdef HASH_TABLE_CACHE
+static unsigned long hash_table_cache_charge(const hash_table *, const hash_table_data_type *);
+static void hash_table_cache_link(hash_table *, hash_table_list_node *);
+static void hash_table_cache_unlink(hash_table *, hash_table_list_node *);
+static void hash_table_cache_touch(hash_table *, hash_table_list_node *);
+static void hash_table_cache_evict(hash_table *);
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+static void hash_table_arena_grow(hash_table *, unsigned long);
+static void hash_table_arena_release(hash_table_arena *);
+static const char *hash_table_arena_copy(hash_table *, const char *, unsigned long);
+static void hash_table_arena_move(hash_table *, hash_table_list_node *const *, unsigned long);
+static void hash_table_arena_compact(hash_table *);
+static void hash_table_key_store(hash_table *, hash_table_key_type *, hash_table_hash_type);
+static void hash_table_key_discard(hash_table *, const hash_table_key_type *);
+static void hash_table_arena_splice(hash_table *, hash_table_arena *);
+#endif
 
 static inline int hash_table_key_compare(const hash_table_key_type *lhs, const hash_table_key_type *rhs)
 {
     assert(lhs != NULL);
     assert(rhs != NULL);
+#ifdef HASH_TABLE_BYTE_KEYS
+    if (lhs->size != rhs->size)
+        return lhs->size < rhs->size ? -1 : 1;
+    return lhs->size ? memcmp(lhs->data, rhs->data, lhs->size) : 0;
+#else
     if (*lhs < *rhs)
         return -1;
     if (*lhs > *rhs)
         return 1;
     return 0;
+#endif
 }
 
 static inline int hash_table_data_compare(const hash_table_data_type *lhs, const hash_table_data_type *rhs)
@@ -31,6 +149,19 @@ static inline int hash_table_data_compare(const hash_table_data_type *lhs, const
     return hash_table_key_compare(&lhs->key, &rhs->key);
 }
 
+static inline int hash_table_key_match(const hash_table_key_type *entry, const hash_table_key_type *key_ptr, hash_table_hash_type hash)
+{
+    assert(entry != NULL);
+    assert(key_ptr != NULL);
+#ifdef HASH_TABLE_BYTE_KEYS
+    if (entry->hash != hash)
+        return 0;
+#else
+    (void)hash;
+#endif
+    return hash_table_key_compare(entry, key_ptr) == 0;
+}
+
 static inline void hash_table_key_copy(hash_table_key_type *dest, const hash_table_key_type *source)
 {
     assert(dest != NULL);
@@ -53,29 +184,173 @@ static inline void hash_table_data_copy(hash_table_data_type *dest, const hash_t
     hash_table_val_copy(&dest->val, &source->val);
 }
 
-static inline hash_table_list_node *create_hash_table_list_node(const hash_table_data_type *data_ptr)
+static void hash_table_slab_grow(hash_table *ht)
+{
+    unsigned long capacity = HASH_TABLE_SLAB_MIN_CAPACITY;
+    hash_table_slab *slab = NULL;
+    assert(ht != NULL);
+    if (ht->slab != NULL)
+        capacity = ht->slab->capacity < HASH_TABLE_SLAB_MAX_CAPACITY ? ht->slab->capacity << 1 : HASH_TABLE_SLAB_MAX_CAPACITY;
+    slab = (hash_table_slab *)malloc(sizeof(hash_table_slab) + capacity * sizeof(hash_table_list_node));
+    assert(slab != NULL);
+    slab->next = ht->slab;
+    slab->capacity = capacity;
+    ht->slab = slab;
+    ht->slab_used = 0;
+}
+
+static void hash_table_slab_release(hash_table *ht)
+{
+    hash_table_slab *tmp = NULL;
+    assert(ht != NULL);
+    while (ht->slab != NULL) {
+        tmp = ht->slab->next;
+        free(ht->slab);
+        ht->slab = tmp;
+    }
+    ht->free_list = NULL;
+    ht->slab_used = 0;
+}
+
+static void hash_table_slab_splice(hash_table *ht, hash_table *local)
+{
+    hash_table_slab *tail = NULL;
+    assert(ht != NULL);
+    assert(local != NULL);
+    if (local->slab == NULL)
+        return;
+    if (ht->slab == NULL) {
+        ht->slab = local->slab;
+        ht->slab_used = local->slab_used;
+        return;
+    }
+    tail = local->slab;
+    while (tail->next != NULL)
+        tail = tail->next;
+    tail->next = ht->slab->next;
+    ht->slab->next = local->slab;
+}
+
+static inline hash_table_list_node *create_hash_table_list_node(hash_table *ht, const hash_table_data_type *data_ptr)
 {
     hash_table_list_node *ret = NULL;
+    assert(ht != NULL);
     assert(data_ptr != NULL);
-    ret = (hash_table_list_node *)malloc(sizeof(hash_table_list_node));
-    assert(ret != NULL);
+    if (ht->free_list != NULL) {
+        ret = ht->free_list;
+        ht->free_list = ret->next;
+    } else {
+        if (ht->slab == NULL || ht->slab_used == ht->slab->capacity)
+            hash_table_slab_grow(ht);
+        ret = &ht->slab->node[ht->slab_used++];
+    }
     hash_table_data_copy(&ret->data, data_ptr);
     ret->next = NULL;
+#ifdef HASH_TABLE_CACHE
+    ret->referenced = 0;
+    ht->bytes += hash_table_cache_charge(ht, &ret->data);
+    hash_table_cache_link(ht, ret);
+#endif
     return ret;
 }
 
+static inline void destroy_hash_table_list_node(hash_table *ht, hash_table_list_node *node)
+{
+    assert(ht != NULL);
+    assert(node != NULL);
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_key_discard(ht, &node->data.key);
+#endif
+#ifdef HASH_TABLE_CACHE
+    ht->bytes -= hash_table_cache_charge(ht, &node->data);
+    hash_table_cache_unlink(ht, node);
+#endif
+    node->next = ht->free_list;
+    ht->free_list = node;
+}
+
 static inline int hash_table_overload(const hash_table *ht)
 {
     assert(ht != NULL);
     return ht->capacity == 0 || (double)ht->size > (double)ht->capacity * ht->load_factor;
 }
 
+static inline hash_table_hash_type hash_table_mix(hash_table_hash_type hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static hash_table_hash_type hash_table_random_seed(const hash_table *ht)
+{
+    static hash_table_hash_type counter = 0;
+    hash_table_hash_type ret = (hash_table_hash_type)time(NULL);
+    ret ^= hash_table_mix((hash_table_hash_type)(size_t)ht + ++counter * 0x9e3779b97f4a7c15ULL);
+    ret ^= hash_table_mix((hash_table_hash_type)clock());
+    return hash_table_mix(ret);
+}
+
+hash_table_hash_type hash_table_default_hash(const hash_table_key_type *key_ptr, hash_table_hash_type seed)
+{
+#ifdef HASH_TABLE_BYTE_KEYS
+    unsigned long i;
+    hash_table_hash_type word;
+    hash_table_hash_type ret;
+    assert(key_ptr != NULL);
+    ret = seed ^ (hash_table_hash_type)key_ptr->size * 0x9e3779b97f4a7c15ULL;
+    for (i = 0; i + sizeof(word) <= key_ptr->size; i += sizeof(word)) {
+        memcpy(&word, key_ptr->data + i, sizeof(word));
+        ret = hash_table_mix(ret ^ word);
+    }
+    word = 0;
+    if (i < key_ptr->size)
+        memcpy(&word, key_ptr->data + i, key_ptr->size - i);
+    return hash_table_mix(ret ^ word);
+#else
+    assert(key_ptr != NULL);
+    return hash_table_mix((hash_table_hash_type)(unsigned int)*key_ptr ^ seed);
+#endif
+}
+
 inline void hash_table_init(hash_table *ht, double init_load_factor)
+{
+    hash_table_init_with_hash(ht, init_load_factor, hash_table_default_hash);
+}
+
+void hash_table_init_with_hash(hash_table *ht, double init_load_factor, hash_table_hash_func_type hash_func)
 {
     assert(ht != NULL);
     ht->hash_list = NULL;
     ht->capacity = ht->size = 0;
+    ht->slab = NULL;
+    ht->free_list = NULL;
+    ht->slab_used = 0;
     ht->load_factor = init_load_factor;
+    ht->hash_func = hash_func != NULL ? hash_func : hash_table_default_hash;
+    ht->seed = hash_table_random_seed(ht);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    ht->old_hash_list = NULL;
+    ht->old_capacity = ht->migrate_pos = 0;
+#endif
+#ifdef HASH_TABLE_STATS
+    memset(&ht->stats, 0, sizeof(hash_table_stats));
+#endif
+#ifdef HASH_TABLE_CACHE
+    ht->hand = NULL;
+    ht->policy = HASH_TABLE_CACHE_LRU;
+    ht->max_entries = ht->max_bytes = ht->bytes = 0;
+    ht->charge_func = NULL;
+    ht->evict_func = NULL;
+    ht->evict_arg = NULL;
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+    ht->arena = NULL;
+    ht->arena_size = ht->arena_garbage = 0;
+#endif
 }
 
 inline unsigned long hash_table_capacity(const hash_table *ht)
@@ -96,121 +371,768 @@ inline int hash_table_empty(const hash_table *ht)
     return ht->size == 0;
 }
 
-static inline unsigned long hash_table_get_address(const hash_table *ht, const hash_table_key_type *key_ptr)
+static inline hash_table_hash_type hash_table_get_hash(const hash_table *ht, const hash_table_key_type *key_ptr)
 {
     assert(ht != NULL);
     assert(key_ptr != NULL);
-    return *key_ptr & ht->mask;
+    return ht->hash_func(key_ptr, ht->seed);
 }
 
-static void hash_table_rehash(hash_table *ht)
+static inline hash_table_hash_type hash_table_get_entry_hash(const hash_table *ht, const hash_table_key_type *key_ptr)
 {
-    unsigned long i;
-    unsigned long addr;
-    unsigned long new_capacity;
-    hash_table_list_node **new_hash_list = NULL;
-    hash_table_list_node *ptr = NULL;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+#ifdef HASH_TABLE_BYTE_KEYS
+    return key_ptr->hash;
+#else
+    return hash_table_get_hash(ht, key_ptr);
+#endif
+}
+
+static inline unsigned long hash_table_get_address(const hash_table *ht, hash_table_hash_type hash)
+{
+    assert(ht != NULL);
+    return (unsigned long)hash & ht->mask;
+}
+
+static unsigned long hash_table_min_capacity(const hash_table *ht, unsigned long size)
+{
+    unsigned long ret = 1;
+    assert(ht != NULL);
+    while ((double)ret * ht->load_factor < 1 || (double)size > (double)ret * ht->load_factor)
+        ret <<= 1;
+    return ret;
+}
+
+// Adds the nodes passed over to *probe_ptr; only the public find paths record the count, so find_probes leaves out inserts.
+static hash_table_list_node *hash_table_list_find(hash_table_list_node *head, const hash_table_key_type *key_ptr, hash_table_hash_type hash, unsigned long *probe_ptr)
+{
+    assert(key_ptr != NULL);
+    assert(probe_ptr != NULL);
+    for (; head != NULL; head = head->next) {
+        if (hash_table_key_match(&head->data.key, key_ptr, hash))
+            break;
+        ++*probe_ptr;
+    }
+    return head;
+}
+
+static inline unsigned long hash_table_list_length(const hash_table_list_node *head)
+{
+    unsigned long ret = 0;
+    for (; head != NULL; head = head->next)
+        ++ret;
+    return ret;
+}
+
+static unsigned long hash_table_list_delete(hash_table *ht, hash_table_list_node **head_ptr, const hash_table_key_type *key_ptr, hash_table_hash_type hash)
+{
+    unsigned long ret = 0;
+    hash_table_list_node dummy_node;
+    hash_table_list_node *ptr = &dummy_node;
     hash_table_list_node *tmp = NULL;
     assert(ht != NULL);
-    if (ht->capacity) {
-        new_capacity = ht->capacity << 1;
-        new_hash_list = (hash_table_list_node **)calloc(new_capacity, sizeof(hash_table_list_node *));
-        assert(new_hash_list != NULL);
-        ht->mask = new_capacity - 1;
-        for (int i = 0; i < ht->capacity; ++i) {
-            ptr = ht->hash_list[i];
-            while (ptr != NULL) {
-                addr = hash_table_get_address(ht, &ptr->data.key);
-                tmp = ptr->next;
-                ptr->next = new_hash_list[addr];
-                new_hash_list[addr] = ptr;
-                ptr = tmp;
-            }
+    assert(head_ptr != NULL);
+    assert(key_ptr != NULL);
+    ptr->next = *head_ptr;
+    while (ptr->next != NULL) {
+        if (hash_table_key_match(&ptr->next->data.key, key_ptr, hash)) {
+            tmp = ptr->next;
+            ptr->next = tmp->next;
+            destroy_hash_table_list_node(ht, tmp);
+            ++ret;
+#ifndef HASH_TABLE_MULTIMAP
+            break;
+#endif
+        } else if (ret) {
+            break;
+        } else {
+            ptr = ptr->next;
         }
-        free(ht->hash_list);
-        ht->hash_list = new_hash_list;
-        ht->capacity = new_capacity;
-    } else {
-        ht->capacity = 1;
-        while ((double)ht->capacity * ht->load_factor < 1)
-            ht->capacity <<= 1;
-        ht->hash_list = (hash_table_list_node **)calloc(ht->capacity, sizeof(hash_table_list_node *));
-        assert(ht->hash_list != NULL);    
-        ht->mask = ht->capacity - 1;
     }
+    *head_ptr = dummy_node.next;
+    return ret;
 }
 
-hash_table_val_type *hash_table_find(hash_table *ht, const hash_table_key_type *key_ptr)
+static void hash_table_relink(hash_table *ht, hash_table_list_node *ptr)
 {
     unsigned long addr;
+    hash_table_list_node *tmp = NULL;
+    assert(ht != NULL);
+    while (ptr != NULL) {
+        addr = hash_table_get_address(ht, hash_table_get_entry_hash(ht, &ptr->data.key));
+        tmp = ptr->next;
+        ptr->next = ht->hash_list[addr];
+        ht->hash_list[addr] = ptr;
+        ptr = tmp;
+    }
+}
+
+static void hash_table_resize(hash_table *ht, unsigned long new_capacity)
+{
+    unsigned long old_capacity;
+    hash_table_list_node **old_hash_list = NULL;
+#ifndef HASH_TABLE_INCREMENTAL_REHASH
+    unsigned long i;
+#endif
+#ifdef HASH_TABLE_STATS
+    double begin = hash_table_stats_now();
+#endif
+    assert(ht != NULL);
+    old_capacity = ht->capacity;
+    old_hash_list = ht->hash_list;
+    ht->capacity = new_capacity;
+    ht->mask = ht->capacity - 1;
+    ht->hash_list = (hash_table_list_node **)calloc(ht->capacity, sizeof(hash_table_list_node *));
+    assert(ht->hash_list != NULL);
+    if (old_capacity == 0)
+        return;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    assert(ht->old_hash_list == NULL);
+    ht->old_hash_list = old_hash_list;
+    ht->old_capacity = old_capacity;
+    ht->migrate_pos = 0;
+#else
+    for (i = 0; i < old_capacity; ++i)
+        hash_table_relink(ht, old_hash_list[i]);
+    free(old_hash_list);
+#endif
+#ifdef HASH_TABLE_STATS
+    ++ht->stats.rehash_count;
+    ht->stats.rehash_time += hash_table_stats_now() - begin;
+#endif
+}
+
+static inline void hash_table_rehash(hash_table *ht)
+{
+    assert(ht != NULL);
+    hash_table_resize(ht, ht->capacity ? ht->capacity << 1 : hash_table_min_capacity(ht, 0));
+}
+
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+static inline unsigned long hash_table_get_old_address(const hash_table *ht, hash_table_hash_type hash)
+{
+    assert(ht != NULL);
+    return (unsigned long)hash & (ht->old_capacity - 1);
+}
+
+static void hash_table_migrate(hash_table *ht, unsigned long count)
+{
+#ifdef HASH_TABLE_STATS
+    double begin = hash_table_stats_now();
+#endif
+    assert(ht != NULL);
+    if (ht->old_hash_list == NULL)
+        return;
+    for (; count && ht->migrate_pos < ht->old_capacity; --count, ++ht->migrate_pos) {
+        hash_table_relink(ht, ht->old_hash_list[ht->migrate_pos]);
+        ht->old_hash_list[ht->migrate_pos] = NULL;
+    }
+#ifdef HASH_TABLE_STATS
+    ht->stats.rehash_time += hash_table_stats_now() - begin;
+#endif
+    if (ht->migrate_pos == ht->old_capacity) {
+        free(ht->old_hash_list);
+        ht->old_hash_list = NULL;
+        ht->old_capacity = ht->migrate_pos = 0;
+    }
+}
+#endif
+
+static hash_table_list_node *hash_table_lookup(hash_table *ht, const hash_table_key_type *key_ptr, hash_table_hash_type hash, unsigned long *probe_ptr)
+{
     hash_table_list_node *ptr = NULL;
     assert(ht != NULL);
     assert(key_ptr != NULL);
-    addr = hash_table_get_address(ht, key_ptr);
-    for (ptr = ht->hash_list[addr]; ptr != NULL; ptr = ptr->next) {
-        if (hash_table_key_compare(&ptr->data.key, key_ptr) == 0)
-            return &ptr->data.val;
+    if (ht->capacity == 0)
+        return NULL;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_hash_list != NULL) {
+        ptr = hash_table_list_find(ht->old_hash_list[hash_table_get_old_address(ht, hash)], key_ptr, hash, probe_ptr);
+        if (ptr != NULL)
+            return ptr;
     }
-    return NULL;
+#endif
+    ptr = hash_table_list_find(ht->hash_list[hash_table_get_address(ht, hash)], key_ptr, hash, probe_ptr);
+    return ptr;
 }
 
-void hash_table_insert(hash_table *ht, const hash_table_data_type *data_ptr)
+static void hash_table_insert_hash(hash_table *ht, const hash_table_data_type *data_ptr, hash_table_hash_type hash)
 {
     unsigned long addr;
+    unsigned long probe = 0;
     hash_table_list_node *ptr = NULL;
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_data_type data;
+#endif
     assert(ht != NULL);
     assert(data_ptr != NULL);
-    if (hash_table_overload(ht))
+    ptr = hash_table_lookup(ht, &data_ptr->key, hash, &probe);
+#ifndef HASH_TABLE_MULTIMAP
+    if (ptr != NULL) {
+#ifdef HASH_TABLE_CACHE
+        ht->bytes -= hash_table_cache_charge(ht, &ptr->data);
+#endif
+        hash_table_val_copy(&ptr->data.val, &data_ptr->val);
+#ifdef HASH_TABLE_CACHE
+        ht->bytes += hash_table_cache_charge(ht, &ptr->data);
+        hash_table_cache_touch(ht, ptr);
+        hash_table_cache_evict(ht);
+#endif
+        return;
+    }
+#endif
+    if (hash_table_overload(ht)) {
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+        hash_table_migrate(ht, ~0UL);
+#endif
         hash_table_rehash(ht);
-    addr = hash_table_get_address(ht, &data_ptr->key);
-    for (ptr = ht->hash_list[addr]; ptr != NULL; ptr = ptr->next) {
-        if (hash_table_key_compare(&ptr->data.key, &data_ptr->key) == 0) {
-            hash_table_val_copy(&ptr->data.val, &data_ptr->val);
-            return;
-        }
     }
-    ptr = create_hash_table_list_node(data_ptr);
+#ifdef HASH_TABLE_MULTIMAP
+    if (ptr != NULL) {
+        hash_table_group_append(ht, ptr, data_ptr);
+        return;
+    }
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_data_copy(&data, data_ptr);
+    hash_table_key_store(ht, &data.key, hash);
+    data_ptr = &data;
+#endif
+    addr = hash_table_get_address(ht, hash);
+    ptr = create_hash_table_list_node(ht, data_ptr);
     ptr->next = ht->hash_list[addr];
     ht->hash_list[addr] = ptr;
     ++ht->size;
+    HASH_TABLE_STATS_RECORD(ht->stats.insert_probes, hash_table_list_length(ptr->next));
+#ifdef HASH_TABLE_CACHE
+    hash_table_cache_evict(ht);
+#endif
 }
 
-void hash_table_delete(hash_table *ht, const hash_table_key_type *key_ptr)
+static void hash_table_erase(hash_table *ht, const hash_table_key_type *key_ptr, hash_table_hash_type hash)
+{
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    unsigned long count;
+#endif
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_hash_list != NULL) {
+        count = hash_table_list_delete(ht, &ht->old_hash_list[hash_table_get_old_address(ht, hash)], key_ptr, hash);
+        if (count) {
+            ht->size -= count;
+            return;
+        }
+    }
+#endif
+    ht->size -= hash_table_list_delete(ht, &ht->hash_list[hash_table_get_address(ht, hash)], key_ptr, hash);
+}
+
+#ifdef HASH_TABLE_MULTIMAP
+static void hash_table_group_append(hash_table *ht, hash_table_list_node *group, const hash_table_data_type *data_ptr)
+{
+    hash_table_list_node *ptr = NULL;
+    hash_table_data_type data;
+    assert(ht != NULL);
+    assert(group != NULL);
+    assert(data_ptr != NULL);
+    hash_table_key_copy(&data.key, &group->data.key);
+    hash_table_val_copy(&data.val, &data_ptr->val);
+#ifdef HASH_TABLE_BYTE_KEYS
+    ht->arena_size += data.key.size;
+#endif
+    ptr = create_hash_table_list_node(ht, &data);
+    ptr->next = group->next;
+    group->next = ptr;
+    ++ht->size;
+    HASH_TABLE_STATS_RECORD(ht->stats.insert_probes, 0);
+}
+#endif
+
+hash_table_val_type *hash_table_find(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    unsigned long probe = 0;
+    hash_table_list_node *ptr = NULL;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    hash_table_migrate(ht, HASH_TABLE_MIGRATE_STEP);
+#endif
+    ptr = hash_table_lookup(ht, key_ptr, hash_table_get_hash(ht, key_ptr), &probe);
+    HASH_TABLE_STATS_RECORD(ht->stats.find_probes, probe);
+#ifdef HASH_TABLE_CACHE
+    if (ptr != NULL)
+        hash_table_cache_touch(ht, ptr);
+#endif
+    return ptr != NULL ? &ptr->data.val : NULL;
+}
+
+#ifdef HASH_TABLE_MULTIMAP
+void hash_table_equal_range(hash_table *ht, const hash_table_key_type *key_ptr, hash_table_range *range)
 {
+    unsigned long probe = 0;
+    hash_table_hash_type hash;
+    hash_table_list_node *ptr = NULL;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    assert(range != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    hash_table_migrate(ht, HASH_TABLE_MIGRATE_STEP);
+#endif
+    hash = hash_table_get_hash(ht, key_ptr);
+    range->first = hash_table_lookup(ht, key_ptr, hash, &probe);
+    HASH_TABLE_STATS_RECORD(ht->stats.find_probes, probe);
+    range->count = 0;
+    for (ptr = range->first; ptr != NULL && hash_table_key_match(&ptr->data.key, key_ptr, hash); ptr = ptr->next)
+        ++range->count;
+}
+
+unsigned long hash_table_count(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    hash_table_range range;
+    hash_table_equal_range(ht, key_ptr, &range);
+    return range.count;
+}
+#endif
+
+void hash_table_find_batch(hash_table *ht, const hash_table_key_type *keys, unsigned long n, hash_table_val_type **results)
+{
+    unsigned long i;
+    unsigned long j;
+    unsigned long block;
+    unsigned long probe;
+    hash_table_hash_type hash[HASH_TABLE_BATCH_SIZE];
+    hash_table_list_node *ptr = NULL;
+    assert(ht != NULL);
+    assert(n == 0 || keys != NULL);
+    assert(n == 0 || results != NULL);
+    for (i = 0; i < n; i += block) {
+        block = n - i < HASH_TABLE_BATCH_SIZE ? n - i : HASH_TABLE_BATCH_SIZE;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+        hash_table_migrate(ht, HASH_TABLE_MIGRATE_STEP);
+#endif
+        for (j = 0; j < block; ++j) {
+            hash[j] = hash_table_get_hash(ht, &keys[i + j]);
+            if (ht->capacity)
+                HASH_TABLE_PREFETCH(&ht->hash_list[hash_table_get_address(ht, hash[j])]);
+        }
+        if (ht->capacity) {
+            for (j = 0; j < block; ++j)
+                HASH_TABLE_PREFETCH(ht->hash_list[hash_table_get_address(ht, hash[j])]);
+        }
+        for (j = 0; j < block; ++j) {
+            probe = 0;
+            ptr = hash_table_lookup(ht, &keys[i + j], hash[j], &probe);
+            HASH_TABLE_STATS_RECORD(ht->stats.find_probes, probe);
+#ifdef HASH_TABLE_CACHE
+            if (ptr != NULL)
+                hash_table_cache_touch(ht, ptr);
+#endif
+            results[i + j] = ptr != NULL ? &ptr->data.val : NULL;
+        }
+    }
+}
+
+void hash_table_insert(hash_table *ht, const hash_table_data_type *data_ptr)
+{
+    assert(ht != NULL);
+    assert(data_ptr != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    hash_table_migrate(ht, HASH_TABLE_MIGRATE_STEP);
+#endif
+    hash_table_insert_hash(ht, data_ptr, hash_table_get_hash(ht, &data_ptr->key));
+}
+
+void hash_table_insert_batch(hash_table *ht, const hash_table_data_type *data, unsigned long n)
+{
+    unsigned long i;
+    unsigned long j;
+    unsigned long block;
+    hash_table_hash_type hash[HASH_TABLE_BATCH_SIZE];
+    assert(ht != NULL);
+    assert(n == 0 || data != NULL);
+    if (n == 0)
+        return;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    hash_table_migrate(ht, ~0UL);
+#endif
+    if (ht->capacity == 0 || (double)(ht->size + n) > (double)ht->capacity * ht->load_factor) {
+        hash_table_resize(ht, hash_table_min_capacity(ht, ht->size + n));
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+        hash_table_migrate(ht, ~0UL);
+#endif
+    }
+    for (i = 0; i < n; i += block) {
+        block = n - i < HASH_TABLE_BATCH_SIZE ? n - i : HASH_TABLE_BATCH_SIZE;
+        for (j = 0; j < block; ++j) {
+            hash[j] = hash_table_get_hash(ht, &data[i + j].key);
+            HASH_TABLE_PREFETCH(&ht->hash_list[hash_table_get_address(ht, hash[j])]);
+        }
+        for (j = 0; j < block; ++j)
+            HASH_TABLE_PREFETCH(ht->hash_list[hash_table_get_address(ht, hash[j])]);
+        for (j = 0; j < block; ++j)
+            hash_table_insert_hash(ht, &data[i + j], hash[j]);
+    }
+}
+
+static unsigned int hash_table_threads(const hash_table *ht, unsigned int threads)
+{
+    unsigned int ret = 1;
+    assert(ht != NULL);
+    while (ret << 1 <= threads && ret << 1 <= HASH_TABLE_MAX_THREADS && ht->capacity / (ret << 1) >= HASH_TABLE_MIN_REGION)
+        ret <<= 1;
+    return ret;
+}
+
+static void hash_table_run(void *tasks, size_t task_size, unsigned int threads, void *(*worker)(void *))
+{
+    unsigned int i;
+    pthread_t thread[HASH_TABLE_MAX_THREADS];
+    assert(tasks != NULL);
+    for (i = 1; i < threads; ++i) {
+        if (pthread_create(&thread[i], NULL, worker, (char *)tasks + i * task_size) != 0)
+            assert(0);
+    }
+    worker(tasks);
+    for (i = 1; i < threads; ++i)
+        pthread_join(thread[i], NULL);
+}
+
+static void *hash_table_build_count(void *arg)
+{
+    unsigned long i;
+    hash_table_build_task *task = (hash_table_build_task *)arg;
+    assert(task != NULL);
+    for (i = task->begin; i < task->end; ++i)
+        ++task->offset[hash_table_get_address(&task->local, hash_table_get_hash(&task->local, &task->data[i].key)) >> task->shift];
+    return NULL;
+}
+
+static void *hash_table_build_scatter(void *arg)
+{
+    unsigned long i;
+    hash_table_hash_type hash;
+    hash_table_build_item *item = NULL;
+    hash_table_build_task *task = (hash_table_build_task *)arg;
+    assert(task != NULL);
+    for (i = task->begin; i < task->end; ++i) {
+        hash = hash_table_get_hash(&task->local, &task->data[i].key);
+        item = &task->items[task->offset[hash_table_get_address(&task->local, hash) >> task->shift]++];
+        item->hash = hash;
+        item->index = i;
+    }
+    return NULL;
+}
+
+static void *hash_table_build_fill(void *arg)
+{
+    unsigned long i;
     unsigned long addr;
+    unsigned long probe;
+    hash_table *ht = NULL;
+    hash_table_list_node *ptr = NULL;
+    const hash_table_data_type *data_ptr = NULL;
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_data_type data;
+#endif
+    hash_table_build_task *task = (hash_table_build_task *)arg;
+    assert(task != NULL);
+    ht = &task->local;
+    for (i = task->region_begin; i < task->region_end; ++i) {
+        data_ptr = &task->data[task->items[i].index];
+        addr = hash_table_get_address(ht, task->items[i].hash);
+        probe = 0;
+        ptr = hash_table_list_find(ht->hash_list[addr], &data_ptr->key, task->items[i].hash, &probe);
+        if (ptr != NULL) {
+#ifdef HASH_TABLE_MULTIMAP
+            hash_table_group_append(ht, ptr, data_ptr);
+#else
+            hash_table_val_copy(&ptr->data.val, &data_ptr->val);
+#endif
+            continue;
+        }
+#ifdef HASH_TABLE_BYTE_KEYS
+        hash_table_data_copy(&data, data_ptr);
+        hash_table_key_store(ht, &data.key, task->items[i].hash);
+        data_ptr = &data;
+#endif
+        ptr = create_hash_table_list_node(ht, data_ptr);
+        ptr->next = ht->hash_list[addr];
+        ht->hash_list[addr] = ptr;
+        ++ht->size;
+        HASH_TABLE_STATS_RECORD(ht->stats.insert_probes, hash_table_list_length(ptr->next));
+    }
+    return NULL;
+}
+
+static void hash_table_build_merge(hash_table *ht, hash_table *local)
+{
+    assert(ht != NULL);
+    assert(local != NULL);
+    ht->size += local->size;
+    hash_table_slab_splice(ht, local);
+#ifdef HASH_TABLE_STATS
+    hash_table_stats_merge(&ht->stats, &local->stats);
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_arena_splice(ht, local->arena);
+    ht->arena_size += local->arena_size;
+#endif
+}
+
+void hash_table_build_from_array(hash_table *ht, const hash_table_data_type *data, unsigned long n, unsigned int threads)
+{
+    unsigned long i;
+    unsigned long pos;
+    unsigned long tmp;
+    unsigned int t;
+    unsigned int r;
+    unsigned int shift = 0;
+    unsigned long *offset = NULL;
+    hash_table_build_item *items = NULL;
+    hash_table_build_task *tasks = NULL;
+    assert(ht != NULL);
+    assert(n == 0 || data != NULL);
+    hash_table_clear(ht);
+    if (ht->capacity == 0 || (double)n > (double)ht->capacity * ht->load_factor) {
+        hash_table_resize(ht, hash_table_min_capacity(ht, n));
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+        hash_table_migrate(ht, ~0UL);
+#endif
+    }
+#ifdef HASH_TABLE_CACHE
+    threads = 1;
+#else
+    threads = hash_table_threads(ht, threads);
+#endif
+    if (threads == 1) {
+        for (i = 0; i < n; ++i)
+            hash_table_insert_hash(ht, &data[i], hash_table_get_hash(ht, &data[i].key));
+        return;
+    }
+    while ((ht->capacity >> shift) > threads)
+        ++shift;
+    tasks = (hash_table_build_task *)malloc(threads * sizeof(hash_table_build_task));
+    assert(tasks != NULL);
+    offset = (unsigned long *)calloc((size_t)threads * threads, sizeof(unsigned long));
+    assert(offset != NULL);
+    items = (hash_table_build_item *)malloc(n * sizeof(hash_table_build_item));
+    assert(items != NULL);
+    for (t = 0; t < threads; ++t) {
+        tasks[t].local = *ht;
+        tasks[t].local.size = 0;
+        tasks[t].local.slab = NULL;
+        tasks[t].local.free_list = NULL;
+        tasks[t].local.slab_used = 0;
+#ifdef HASH_TABLE_STATS
+        memset(&tasks[t].local.stats, 0, sizeof(hash_table_stats));
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+        tasks[t].local.arena = NULL;
+        tasks[t].local.arena_size = tasks[t].local.arena_garbage = 0;
+#endif
+        tasks[t].data = data;
+        tasks[t].items = items;
+        tasks[t].offset = offset + (size_t)t * threads;
+        tasks[t].begin = n / threads * t;
+        tasks[t].end = t + 1 == threads ? n : n / threads * (t + 1);
+        tasks[t].shift = shift;
+    }
+    hash_table_run(tasks, sizeof(hash_table_build_task), threads, hash_table_build_count);
+    for (r = 0, pos = 0; r < threads; ++r) {
+        tasks[r].region_begin = pos;
+        for (t = 0; t < threads; ++t) {
+            tmp = tasks[t].offset[r];
+            tasks[t].offset[r] = pos;
+            pos += tmp;
+        }
+        tasks[r].region_end = pos;
+    }
+    hash_table_run(tasks, sizeof(hash_table_build_task), threads, hash_table_build_scatter);
+    hash_table_run(tasks, sizeof(hash_table_build_task), threads, hash_table_build_fill);
+    for (t = 0; t < threads; ++t)
+        hash_table_build_merge(ht, &tasks[t].local);
+    free(items);
+    free(offset);
+    free(tasks);
+}
+
+void hash_table_delete(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    hash_table_hash_type hash;
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    if (ht->capacity == 0)
+        return;
+    hash = hash_table_get_hash(ht, key_ptr);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    hash_table_migrate(ht, HASH_TABLE_MIGRATE_STEP);
+#endif
+    hash_table_erase(ht, key_ptr, hash);
+}
+
+static unsigned long hash_table_list_erase_if(hash_table *ht, hash_table_list_node **head_ptr, hash_table_pred_func_type pred, void *arg)
+{
+    unsigned long ret = 0;
     hash_table_list_node dummy_node;
     hash_table_list_node *ptr = &dummy_node;
     hash_table_list_node *tmp = NULL;
     assert(ht != NULL);
-    assert(key_ptr != NULL);
-    addr = hash_table_get_address(ht, key_ptr);
-    ptr->next = ht->hash_list[addr];
+    assert(head_ptr != NULL);
+    assert(pred != NULL);
+    ptr->next = *head_ptr;
     while (ptr->next != NULL) {
-        if (hash_table_key_compare(&ptr->next->data.key, key_ptr) == 0) {
+        if (pred(&ptr->next->data, arg)) {
             tmp = ptr->next;
             ptr->next = tmp->next;
-            free(tmp);
-            ht->hash_list[addr] = dummy_node.next;
-            --ht->size;
-            break;
+            destroy_hash_table_list_node(ht, tmp);
+            ++ret;
+        } else {
+            ptr = ptr->next;
         }
-        ptr = ptr->next;
     }
+    *head_ptr = dummy_node.next;
+    return ret;
 }
 
-void hash_table_clear(hash_table *ht)
+unsigned long hash_table_erase_if(hash_table *ht, hash_table_pred_func_type pred, void *arg)
 {
     unsigned long i;
-    hash_table_list_node *tmp = NULL;
+    unsigned long ret = 0;
     assert(ht != NULL);
+    assert(pred != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    for (i = ht->migrate_pos; ht->old_hash_list != NULL && i < ht->old_capacity; ++i) {
+        if (ht->old_hash_list[i] != NULL)
+            ret += hash_table_list_erase_if(ht, &ht->old_hash_list[i], pred, arg);
+    }
+#endif
     for (i = 0; i < ht->capacity; ++i) {
-        while (ht->hash_list[i] != NULL) {
-            tmp = ht->hash_list[i]->next;
-            free(ht->hash_list[i]);
-            ht->hash_list[i] = tmp;
+        if (ht->hash_list[i] != NULL)
+            ret += hash_table_list_erase_if(ht, &ht->hash_list[i], pred, arg);
+    }
+    ht->size -= ret;
+    return ret;
+}
+
+void hash_table_iterator_init(hash_table_iterator *it, hash_table *ht)
+{
+    assert(it != NULL);
+    assert(ht != NULL);
+    it->ht = ht;
+    it->hash_list = ht->hash_list;
+    it->capacity = ht->capacity;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_hash_list != NULL) {
+        it->hash_list = ht->old_hash_list;
+        it->capacity = ht->old_capacity;
+    }
+#endif
+    it->addr = 0;
+    it->node = it->capacity ? it->hash_list[0] : NULL;
+}
+
+hash_table_data_type *hash_table_iterator_next(hash_table_iterator *it)
+{
+    hash_table_list_node *ret = NULL;
+    assert(it != NULL);
+    while (it->node == NULL) {
+        if (it->addr + 1 < it->capacity) {
+            it->node = it->hash_list[++it->addr];
+        } else if (it->hash_list != it->ht->hash_list) {
+            it->hash_list = it->ht->hash_list;
+            it->capacity = it->ht->capacity;
+            it->addr = 0;
+            it->node = it->capacity ? it->hash_list[0] : NULL;
+        } else {
+            return NULL;
         }
     }
+    ret = it->node;
+    it->node = ret->next;
+    return &ret->data;
+}
+
+static void hash_table_scan(hash_table_list_node *const *hash_list, unsigned long begin, unsigned long end, hash_table_visit_func_type func, void *arg)
+{
+    unsigned long addr;
+    hash_table_list_node *ptr = NULL;
+    assert(func != NULL);
+    for (addr = begin; addr < end; ++addr) {
+        if (addr + HASH_TABLE_SCAN_PREFETCH < end)
+            HASH_TABLE_PREFETCH(hash_list[addr + HASH_TABLE_SCAN_PREFETCH]);
+        for (ptr = hash_list[addr]; ptr != NULL; ptr = ptr->next)
+            func(&ptr->data, arg);
+    }
+}
+
+static inline void hash_table_scan_part(hash_table_list_node *const *hash_list, unsigned long capacity, unsigned int index, unsigned int parts, hash_table_visit_func_type func, void *arg)
+{
+    hash_table_scan(hash_list, capacity * index / parts, capacity * (index + 1) / parts, func, arg);
+}
+
+static void *hash_table_scan_worker(void *arg)
+{
+    hash_table_scan_task *task = (hash_table_scan_task *)arg;
+    assert(task != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (task->ht->old_hash_list != NULL)
+        hash_table_scan_part(task->ht->old_hash_list, task->ht->old_capacity, task->index, task->threads, task->func, task->arg);
+#endif
+    hash_table_scan_part(task->ht->hash_list, task->ht->capacity, task->index, task->threads, task->func, task->arg);
+    return NULL;
+}
+
+void hash_table_for_each(hash_table *ht, hash_table_visit_func_type func, void *arg)
+{
+    assert(ht != NULL);
+    assert(func != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_hash_list != NULL)
+        hash_table_scan(ht->old_hash_list, ht->migrate_pos, ht->old_capacity, func, arg);
+#endif
+    hash_table_scan(ht->hash_list, 0, ht->capacity, func, arg);
+}
+
+void hash_table_parallel_for_each(hash_table *ht, hash_table_visit_func_type func, void *arg, unsigned int threads)
+{
+    unsigned int t;
+    hash_table_scan_task tasks[HASH_TABLE_MAX_THREADS];
+    assert(ht != NULL);
+    assert(func != NULL);
+    threads = hash_table_threads(ht, threads);
+    for (t = 0; t < threads; ++t) {
+        tasks[t].ht = ht;
+        tasks[t].func = func;
+        tasks[t].arg = arg;
+        tasks[t].index = t;
+        tasks[t].threads = threads;
+    }
+    hash_table_run(tasks, sizeof(hash_table_scan_task), threads, hash_table_scan_worker);
+}
+
+void hash_table_clear(hash_table *ht)
+{
+    assert(ht != NULL);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    free(ht->old_hash_list);
+    ht->old_hash_list = NULL;
+    ht->old_capacity = ht->migrate_pos = 0;
+#endif
+    if (ht->capacity)
+        memset(ht->hash_list, 0, ht->capacity * sizeof(hash_table_list_node *));
+    hash_table_slab_release(ht);
     ht->size = 0;
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_arena_release(ht->arena);
+    ht->arena = NULL;
+    ht->arena_size = ht->arena_garbage = 0;
+#endif
+#ifdef HASH_TABLE_CACHE
+    ht->hand = NULL;
+    ht->bytes = 0;
+#endif
 }
 
 inline void hash_table_destroy(hash_table *ht)
@@ -220,4 +1142,284 @@ inline void hash_table_destroy(hash_table *ht)
     free(ht->hash_list);
     ht->hash_list = NULL;
     ht->capacity = 0;
-}
\ No newline at end of file
+}
+
+#ifdef HASH_TABLE_STATS
+// Rehash time is wall-clock time on the monotonic clock the benchmark harness uses, not CPU time.
+static double hash_table_stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void hash_table_stats_chains(hash_table_stats *stats, hash_table_list_node *const *hash_list, unsigned long capacity)
+{
+    unsigned long i;
+    assert(stats != NULL);
+    for (i = 0; i < capacity; ++i)
+        HASH_TABLE_STATS_RECORD(stats->chain_length, hash_table_list_length(hash_list[i]));
+}
+
+static void hash_table_stats_merge(hash_table_stats *dest, const hash_table_stats *source)
+{
+    unsigned long i;
+    assert(dest != NULL);
+    assert(source != NULL);
+    for (i = 0; i < HASH_TABLE_STATS_HISTOGRAM_SIZE; ++i) {
+        dest->find_probes[i] += source->find_probes[i];
+        dest->insert_probes[i] += source->insert_probes[i];
+    }
+}
+
+void hash_table_get_stats(const hash_table *ht, hash_table_stats *stats)
+{
+    const hash_table_slab *slab = NULL;
+#ifdef HASH_TABLE_BYTE_KEYS
+    const hash_table_arena *arena = NULL;
+#endif
+    assert(ht != NULL);
+    assert(stats != NULL);
+    *stats = ht->stats;
+    memset(stats->chain_length, 0, sizeof(stats->chain_length));
+    hash_table_stats_chains(stats, ht->hash_list, ht->capacity);
+    stats->bytes_allocated = ht->capacity * sizeof(hash_table_list_node *);
+    for (slab = ht->slab; slab != NULL; slab = slab->next)
+        stats->bytes_allocated += sizeof(hash_table_slab) + slab->capacity * sizeof(hash_table_list_node);
+#ifdef HASH_TABLE_BYTE_KEYS
+    for (arena = ht->arena; arena != NULL; arena = arena->next)
+        stats->bytes_allocated += sizeof(hash_table_arena) + arena->capacity;
+#endif
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_hash_list != NULL) {
+        hash_table_stats_chains(stats, ht->old_hash_list + ht->migrate_pos, ht->old_capacity - ht->migrate_pos);
+        stats->bytes_allocated += ht->old_capacity * sizeof(hash_table_list_node *);
+    }
+#endif
+}
+
+void hash_table_reset_stats(hash_table *ht)
+{
+    assert(ht != NULL);
+    memset(&ht->stats, 0, sizeof(hash_table_stats));
+}
+#endif
+
+#ifdef HASH_TABLE_CACHE
+static inline unsigned long hash_table_cache_charge(const hash_table *ht, const hash_table_data_type *data_ptr)
+{
+    assert(ht != NULL);
+    assert(data_ptr != NULL);
+    return ht->charge_func != NULL ? ht->charge_func(data_ptr) : sizeof(hash_table_list_node);
+}
+
+static void hash_table_cache_link(hash_table *ht, hash_table_list_node *node)
+{
+    assert(ht != NULL);
+    assert(node != NULL);
+    if (ht->hand == NULL) {
+        node->lru_prev = node->lru_next = node;
+        ht->hand = node;
+        return;
+    }
+    node->lru_next = ht->hand;
+    node->lru_prev = ht->hand->lru_prev;
+    node->lru_prev->lru_next = node;
+    ht->hand->lru_prev = node;
+}
+
+static void hash_table_cache_unlink(hash_table *ht, hash_table_list_node *node)
+{
+    assert(ht != NULL);
+    assert(node != NULL);
+    if (node->lru_next == node) {
+        ht->hand = NULL;
+        return;
+    }
+    if (ht->hand == node)
+        ht->hand = node->lru_next;
+    node->lru_prev->lru_next = node->lru_next;
+    node->lru_next->lru_prev = node->lru_prev;
+}
+
+static void hash_table_cache_touch(hash_table *ht, hash_table_list_node *node)
+{
+    assert(ht != NULL);
+    assert(node != NULL);
+    if (ht->policy == HASH_TABLE_CACHE_CLOCK) {
+        node->referenced = 1;
+        return;
+    }
+    if (ht->hand == node) {
+        ht->hand = node->lru_next;
+        return;
+    }
+    hash_table_cache_unlink(ht, node);
+    hash_table_cache_link(ht, node);
+}
+
+static void hash_table_cache_evict(hash_table *ht)
+{
+    hash_table_key_type key;
+    assert(ht != NULL);
+    while (ht->hand != NULL && ((ht->max_entries && ht->size > ht->max_entries) || (ht->max_bytes && ht->bytes > ht->max_bytes))) {
+        if (ht->policy == HASH_TABLE_CACHE_CLOCK) {
+            while (ht->hand->referenced) {
+                ht->hand->referenced = 0;
+                ht->hand = ht->hand->lru_next;
+            }
+        }
+        if (ht->evict_func != NULL)
+            ht->evict_func(&ht->hand->data, ht->evict_arg);
+        hash_table_key_copy(&key, &ht->hand->data.key);
+        hash_table_erase(ht, &key, hash_table_get_entry_hash(ht, &key));
+    }
+}
+
+void hash_table_set_cache_policy(hash_table *ht, hash_table_cache_policy policy)
+{
+    hash_table_list_node *ptr = NULL;
+    assert(ht != NULL);
+    ht->policy = policy;
+    if (ht->hand == NULL)
+        return;
+    ptr = ht->hand;
+    do {
+        ptr->referenced = 0;
+        ptr = ptr->lru_next;
+    } while (ptr != ht->hand);
+}
+
+void hash_table_set_cache_limit(hash_table *ht, unsigned long max_entries, unsigned long max_bytes, hash_table_charge_func_type charge_func)
+{
+    hash_table_list_node *ptr = NULL;
+    assert(ht != NULL);
+    ht->max_entries = max_entries;
+    ht->max_bytes = max_bytes;
+    ht->charge_func = charge_func;
+    ht->bytes = 0;
+    if (ht->hand != NULL) {
+        ptr = ht->hand;
+        do {
+            ht->bytes += hash_table_cache_charge(ht, &ptr->data);
+            ptr = ptr->lru_next;
+        } while (ptr != ht->hand);
+    }
+    hash_table_cache_evict(ht);
+}
+
+inline void hash_table_set_evict_callback(hash_table *ht, hash_table_evict_func_type evict_func, void *arg)
+{
+    assert(ht != NULL);
+    ht->evict_func = evict_func;
+    ht->evict_arg = arg;
+}
+
+inline unsigned long hash_table_cache_bytes(const hash_table *ht)
+{
+    assert(ht != NULL);
+    return ht->bytes;
+}
+#endif
+
+#ifdef HASH_TABLE_BYTE_KEYS
+static void hash_table_arena_grow(hash_table *ht, unsigned long size)
+{
+    unsigned long capacity = HASH_TABLE_ARENA_MIN_CAPACITY;
+    hash_table_arena *arena = NULL;
+    assert(ht != NULL);
+    if (ht->arena != NULL)
+        capacity = ht->arena->capacity < HASH_TABLE_ARENA_MAX_CAPACITY ? ht->arena->capacity << 1 : ht->arena->capacity;
+    if (capacity < size)
+        capacity = size;
+    arena = (hash_table_arena *)malloc(sizeof(hash_table_arena) + capacity);
+    assert(arena != NULL);
+    arena->next = ht->arena;
+    arena->capacity = capacity;
+    arena->used = 0;
+    ht->arena = arena;
+}
+
+static void hash_table_arena_release(hash_table_arena *arena)
+{
+    hash_table_arena *tmp = NULL;
+    while (arena != NULL) {
+        tmp = arena->next;
+        free(arena);
+        arena = tmp;
+    }
+}
+
+static const char *hash_table_arena_copy(hash_table *ht, const char *data, unsigned long size)
+{
+    char *ret = NULL;
+    assert(ht != NULL);
+    if (ht->arena == NULL || ht->arena->capacity - ht->arena->used < size)
+        hash_table_arena_grow(ht, size);
+    ret = ht->arena->data + ht->arena->used;
+    ht->arena->used += size;
+    if (size)
+        memcpy(ret, data, size);
+    return ret;
+}
+
+static void hash_table_arena_move(hash_table *ht, hash_table_list_node *const *hash_list, unsigned long capacity)
+{
+    unsigned long i;
+    hash_table_list_node *ptr = NULL;
+    assert(ht != NULL);
+    for (i = 0; i < capacity; ++i) {
+        for (ptr = hash_list[i]; ptr != NULL; ptr = ptr->next)
+            ptr->data.key.data = hash_table_arena_copy(ht, ptr->data.key.data, ptr->data.key.size);
+    }
+}
+
+static void hash_table_arena_compact(hash_table *ht)
+{
+    hash_table_arena *old_arena = NULL;
+    assert(ht != NULL);
+    old_arena = ht->arena;
+    ht->arena = NULL;
+    if (ht->arena_size)
+        hash_table_arena_grow(ht, ht->arena_size);
+    hash_table_arena_move(ht, ht->hash_list, ht->capacity);
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    if (ht->old_hash_list != NULL)
+        hash_table_arena_move(ht, ht->old_hash_list + ht->migrate_pos, ht->old_capacity - ht->migrate_pos);
+#endif
+    hash_table_arena_release(old_arena);
+    ht->arena_garbage = 0;
+}
+
+static void hash_table_key_store(hash_table *ht, hash_table_key_type *key_ptr, hash_table_hash_type hash)
+{
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    if ((ht->arena == NULL || ht->arena->capacity - ht->arena->used < key_ptr->size) && ht->arena_garbage > ht->arena_size)
+        hash_table_arena_compact(ht);
+    key_ptr->data = hash_table_arena_copy(ht, key_ptr->data, key_ptr->size);
+    key_ptr->hash = hash;
+    ht->arena_size += key_ptr->size;
+}
+
+static inline void hash_table_key_discard(hash_table *ht, const hash_table_key_type *key_ptr)
+{
+    assert(ht != NULL);
+    assert(key_ptr != NULL);
+    ht->arena_size -= key_ptr->size;
+    ht->arena_garbage += key_ptr->size;
+}
+
+static void hash_table_arena_splice(hash_table *ht, hash_table_arena *arena)
+{
+    hash_table_arena *tail = NULL;
+    assert(ht != NULL);
+    if (arena == NULL)
+        return;
+    tail = arena;
+    while (tail->next != NULL)
+        tail = tail->next;
+    tail->next = ht->arena;
+    ht->arena = arena;
+}
+#endif
\ No newline at end of file
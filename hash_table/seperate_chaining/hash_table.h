@@ -1,8 +1,41 @@
 #ifndef __HASH_TABLE_H__
 #define __HASH_TABLE_H__
 
+// Uncomment to spread each resize over later operations instead of moving every chain at once.
+// #define HASH_TABLE_INCREMENTAL_REHASH
+// Uncomment to record probe lengths and rehash costs, read back through hash_table_get_stats.
+// #define HASH_TABLE_STATS
+// Uncomment to use the table as a bounded cache that evicts by LRU or CLOCK once an entry or byte limit is exceeded.
+// #define HASH_TABLE_CACHE
+// Uncomment to key entries by byte strings; key bytes are copied into a per-table arena and each stored key caches its full hash.
+// #define HASH_TABLE_BYTE_KEYS
+// Uncomment to keep every value inserted under a key; equal keys sit next to each other in one chain and are deleted together.
+// #define HASH_TABLE_MULTIMAP
+
+#if defined(HASH_TABLE_MULTIMAP) && defined(HASH_TABLE_CACHE)
+#error "HASH_TABLE_CACHE evicts single entries by key and cannot be combined with HASH_TABLE_MULTIMAP"
+#endif
+
+typedef unsigned long long hash_table_hash_type;
+#ifdef HASH_TABLE_BYTE_KEYS
+typedef struct HashTableKey
+{
+    const char *data;
+    unsigned long size;
+    hash_table_hash_type hash;
+} hash_table_key_type;
+typedef struct HashTableArena
+{
+    struct HashTableArena *next;
+    unsigned long capacity;
+    unsigned long used;
+    char data[];
+} hash_table_arena;
+#else
 typedef int hash_table_key_type;
+#endif
 typedef int hash_table_val_type;
+typedef hash_table_hash_type (*hash_table_hash_func_type)(const hash_table_key_type *, hash_table_hash_type);
 typedef struct HashTableDataNode
 {
     hash_table_key_type key;
@@ -12,24 +45,130 @@ typedef struct HashTableListNode
 {
     hash_table_data_type data;
     struct HashTableListNode *next;
+#ifdef HASH_TABLE_CACHE
+    struct HashTableListNode *lru_prev;
+    struct HashTableListNode *lru_next;
+    int referenced;
+#endif
 } hash_table_list_node;
+#ifdef HASH_TABLE_MULTIMAP
+// The values of a key are the count nodes linked from first; a range stays valid until the next call on the table.
+typedef struct HashTableRange
+{
+    hash_table_list_node *first;
+    unsigned long count;
+} hash_table_range;
+#endif
+typedef struct HashTableSlab
+{
+    struct HashTableSlab *next;
+    unsigned long capacity;
+    hash_table_list_node node[];
+} hash_table_slab;
+#ifdef HASH_TABLE_STATS
+// Histograms count list nodes per probe or per bucket; the last bucket collects every longer one.
+// find_probes covers the public lookups only, not the ones inside insert; rehash_time is wall-clock seconds.
+#define HASH_TABLE_STATS_HISTOGRAM_SIZE 16
+typedef struct HashTableStats
+{
+    unsigned long find_probes[HASH_TABLE_STATS_HISTOGRAM_SIZE];
+    unsigned long insert_probes[HASH_TABLE_STATS_HISTOGRAM_SIZE];
+    unsigned long chain_length[HASH_TABLE_STATS_HISTOGRAM_SIZE];
+    unsigned long rehash_count;
+    double rehash_time;
+    unsigned long bytes_allocated;
+} hash_table_stats;
+#endif
+#ifdef HASH_TABLE_CACHE
+typedef enum HashTableCachePolicy
+{
+    HASH_TABLE_CACHE_LRU,
+    HASH_TABLE_CACHE_CLOCK
+} hash_table_cache_policy;
+typedef unsigned long (*hash_table_charge_func_type)(const hash_table_data_type *);
+typedef void (*hash_table_evict_func_type)(const hash_table_data_type *, void *);
+#endif
 typedef struct HashTable
 {
     hash_table_list_node **hash_list;
+    hash_table_slab *slab;
+    hash_table_list_node *free_list;
+    unsigned long slab_used;
     unsigned long size;
     unsigned long capacity;
     unsigned long mask;
     double load_factor;
+    hash_table_hash_func_type hash_func;
+    hash_table_hash_type seed;
+#ifdef HASH_TABLE_INCREMENTAL_REHASH
+    hash_table_list_node **old_hash_list;
+    unsigned long old_capacity;
+    unsigned long migrate_pos;
+#endif
+#ifdef HASH_TABLE_STATS
+    hash_table_stats stats;
+#endif
+#ifdef HASH_TABLE_CACHE
+    hash_table_list_node *hand;
+    hash_table_cache_policy policy;
+    unsigned long max_entries;
+    unsigned long max_bytes;
+    unsigned long bytes;
+    hash_table_charge_func_type charge_func;
+    hash_table_evict_func_type evict_func;
+    void *evict_arg;
+#endif
+#ifdef HASH_TABLE_BYTE_KEYS
+    hash_table_arena *arena;
+    unsigned long arena_size;
+    unsigned long arena_garbage;
+#endif
 } hash_table;
+// Iteration walks the buckets in order and follows each chain; an iterator stays valid only while the table is not modified.
+// With incremental rehash the buckets not yet migrated are covered first.
+typedef struct HashTableIterator
+{
+    hash_table *ht;
+    hash_table_list_node **hash_list;
+    unsigned long capacity;
+    unsigned long addr;
+    hash_table_list_node *node;
+} hash_table_iterator;
+typedef void (*hash_table_visit_func_type)(hash_table_data_type *, void *);
+typedef int (*hash_table_pred_func_type)(const hash_table_data_type *, void *);
 
+hash_table_hash_type hash_table_default_hash(const hash_table_key_type *, hash_table_hash_type);
 void hash_table_init(hash_table *, double);
+void hash_table_init_with_hash(hash_table *, double, hash_table_hash_func_type);
 unsigned long hash_table_size(const hash_table *);
 unsigned long hash_table_capacity(const hash_table *);
 int hash_table_empty(const hash_table *);
 hash_table_val_type *hash_table_find(hash_table *, const hash_table_key_type *);
+void hash_table_find_batch(hash_table *, const hash_table_key_type *, unsigned long, hash_table_val_type **);
+#ifdef HASH_TABLE_MULTIMAP
+void hash_table_equal_range(hash_table *, const hash_table_key_type *, hash_table_range *);
+unsigned long hash_table_count(hash_table *, const hash_table_key_type *);
+#endif
 void hash_table_insert(hash_table *, const hash_table_data_type *);
+void hash_table_insert_batch(hash_table *, const hash_table_data_type *, unsigned long);
+void hash_table_build_from_array(hash_table *, const hash_table_data_type *, unsigned long, unsigned int);
 void hash_table_delete(hash_table *, const hash_table_key_type *);
+unsigned long hash_table_erase_if(hash_table *, hash_table_pred_func_type, void *);
+void hash_table_iterator_init(hash_table_iterator *, hash_table *);
+hash_table_data_type *hash_table_iterator_next(hash_table_iterator *);
+void hash_table_for_each(hash_table *, hash_table_visit_func_type, void *);
+void hash_table_parallel_for_each(hash_table *, hash_table_visit_func_type, void *, unsigned int);
 void hash_table_clear(hash_table *);
 void hash_table_destroy(hash_table *);
+#ifdef HASH_TABLE_STATS
+void hash_table_get_stats(const hash_table *, hash_table_stats *);
+void hash_table_reset_stats(hash_table *);
+#endif
+#ifdef HASH_TABLE_CACHE
+void hash_table_set_cache_policy(hash_table *, hash_table_cache_policy);
+void hash_table_set_cache_limit(hash_table *, unsigned long, unsigned long, hash_table_charge_func_type);
+void hash_table_set_evict_callback(hash_table *, hash_table_evict_func_type, void *);
+unsigned long hash_table_cache_bytes(const hash_table *);
+#endif
 
 #endif // __HASH_TABLE_H__
\ No newline at end of file
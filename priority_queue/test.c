@@ -1,4 +1,5 @@
 #include "priority_queue.h"
+#include "../benchmark/benchmark.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -6,37 +7,72 @@
 #define MAXN (1 << 22 | 521)
 #define OFFSET 5211314
 
-int main(void)
+priority_queue *que;
+int *keys;
+
+void setup_empty(void *arg)
 {
-    unsigned long i;
-    int key;
-    int cnt = 0;
-    clock_t begin, end;
-    priority_queue_data_type data;
-    priority_queue *que = (priority_queue *)malloc(sizeof(priority_queue));
+    (void)arg;
     priority_queue_init(que);
+}
 
-    srand((unsigned int)time(NULL));
-    begin = clock();
+void setup_full(void *arg)
+{
+    unsigned long i;
+    setup_empty(arg);
+    for (i = 0; i < MAXN; ++i)
+        priority_queue_push(que, &(priority_queue_data_type){keys[i], keys[i]});
+}
+
+void teardown(void *arg)
+{
+    (void)arg;
+    priority_queue_destroy(que);
+}
+
+void push_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    unsigned long i;
+    (void)thread;
+    (void)arg;
     for (i = 0; i < MAXN; ++i) {
-        key = (rand() << 8) - OFFSET + i;
-        priority_queue_push(que, &(priority_queue_data_type){key, key});
+        benchmark_op_begin(rec);
+        priority_queue_push(que, &(priority_queue_data_type){keys[i], keys[i]});
+        benchmark_op_end(rec);
     }
-    end = clock();
-    printf("\n%lldms\n", end - begin);
-    printf("%u %u\n", priority_queue_size(que), priority_queue_capacity(que));
+    rec->checksum = priority_queue_size(que);
+}
 
-    begin = clock();
+void pop_run(benchmark_recorder *rec, unsigned int thread, void *arg)
+{
+    (void)thread;
+    (void)arg;
     while (!priority_queue_empty(que)) {
+        benchmark_op_begin(rec);
         if (priority_queue_top(que).val > 0)
-            ++cnt;
+            ++rec->checksum;
         priority_queue_pop(que);
+        benchmark_op_end(rec);
     }
-    end = clock();
-    printf("\n%lldms\n", end - begin);
-    printf("%d\n", cnt);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long i;
+    benchmark b;
+    que = (priority_queue *)malloc(sizeof(priority_queue));
+    keys = (int *)malloc(sizeof(int) * MAXN);
+
+    srand((unsigned int)time(NULL));
+    for (i = 0; i < MAXN; ++i)
+        keys[i] = (rand() << 8) - OFFSET + i;
+
+    benchmark_init(&b, "priority_queue", argc, argv);
+    benchmark_run(&b, &(benchmark_case){"push", 1, setup_empty, push_run, teardown, NULL});
+    benchmark_run(&b, &(benchmark_case){"pop", 1, setup_full, pop_run, teardown, NULL});
+    benchmark_finish(&b);
 
-    priority_queue_destroy(que);
     free(que);
+    free(keys);
     return 0;
 }
\ No newline at end of file